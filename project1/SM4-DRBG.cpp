@@ -0,0 +1,879 @@
+// SM4-CTR_DRBGHMAC-SM3 DRBGNIST SP 800-90Aȡgetrandom()
+// HMAC-SM3project4SM3ʵ֣ܾͬ·ΣSM2.cppPaillier.cppúֹظ
+#ifndef SM4_DRBG_INCLUDED
+#define SM4_DRBG_INCLUDED
+#define SM3_NO_MAIN
+#include "../project4/SM3.cpp"
+
+#include <cerrno>
+#include <stdexcept>
+#include <wmmintrin.h>
+#include <sys/random.h>
+#include <sys/wait.h>
+
+// SM4 S
+alignas(16) constexpr uint8_t SM4_SBOX[256] = {
+    0xd6, 0x90, 0xe9, 0xfe, 0xcc, 0xe1, 0x3d, 0xb7, 0x16, 0xb6, 0x14, 0xc2, 0x28, 0xfb, 0x2c, 0x05,
+    0x2b, 0x67, 0x9a, 0x76, 0x2a, 0xbe, 0x04, 0xc3, 0xaa, 0x44, 0x13, 0x26, 0x49, 0x86, 0x06, 0x99,
+    0x9c, 0x42, 0x50, 0xf4, 0x91, 0xef, 0x98, 0x7a, 0x33, 0x54, 0x0b, 0x43, 0xed, 0xcf, 0xac, 0x62,
+    0xe4, 0xb3, 0x1c, 0xa9, 0xc9, 0x08, 0xe8, 0x95, 0x80, 0xdf, 0x94, 0xfa, 0x75, 0x8f, 0x3f, 0xa6,
+    0x47, 0x07, 0xa7, 0xfc, 0xf3, 0x73, 0x17, 0xba, 0x83, 0x59, 0x3c, 0x19, 0xe6, 0x85, 0x4f, 0xa8,
+    0x68, 0x6b, 0x81, 0xb2, 0x71, 0x64, 0xda, 0x8b, 0xf8, 0xeb, 0x0f, 0x4b, 0x70, 0x56, 0x9d, 0x35,
+    0x1e, 0x24, 0x0e, 0x5e, 0x63, 0x58, 0xd1, 0xa2, 0x25, 0x22, 0x7c, 0x3b, 0x01, 0x21, 0x78, 0x87,
+    0xd4, 0x00, 0x46, 0x57, 0x9f, 0xd3, 0x27, 0x52, 0x4c, 0x36, 0x02, 0xe7, 0xa0, 0xc4, 0xc8, 0x9e,
+    0xea, 0xbf, 0x8a, 0xd2, 0x40, 0xc7, 0x38, 0xb5, 0xa3, 0xf7, 0xf2, 0xce, 0xf9, 0x61, 0x15, 0xa1,
+    0xe0, 0xae, 0x5d, 0xa4, 0x9b, 0x34, 0x1a, 0x55, 0xad, 0x93, 0x32, 0x30, 0xf5, 0x8c, 0xb1, 0xe3,
+    0x1d, 0xf6, 0xe2, 0x2e, 0x82, 0x66, 0xca, 0x60, 0xc0, 0x29, 0x23, 0xab, 0x0d, 0x53, 0x4e, 0x6f,
+    0xd5, 0xdb, 0x37, 0x45, 0xde, 0xfd, 0x8e, 0x2f, 0x03, 0xff, 0x6a, 0x72, 0x6d, 0x6c, 0x5b, 0x51,
+    0x8d, 0x1b, 0xaf, 0x92, 0xbb, 0xdd, 0xbc, 0x7f, 0x11, 0xd9, 0x5c, 0x41, 0x1f, 0x10, 0x5a, 0xd8,
+    0x0a, 0xc1, 0x31, 0x88, 0xa5, 0xcd, 0x7b, 0xbd, 0x2d, 0x74, 0xd0, 0x12, 0xb8, 0xe5, 0xb4, 0xb0,
+    0x89, 0x69, 0x97, 0x4a, 0x0c, 0x96, 0x77, 0x7e, 0x65, 0xb9, 0xf1, 0x09, 0xc5, 0x6e, 0xc6, 0x84,
+    0x18, 0xf0, 0x7d, 0xec, 0x3a, 0xdc, 0x4d, 0x20, 0x79, 0xee, 0x5f, 0x3e, 0xd7, 0xcb, 0x39, 0x48
+};
+
+// ϵͳFK̶CK
+constexpr uint32_t SM4_FK[4] = {
+    0xa3b1bac6, 0x56aa3350, 0x677d9197, 0xb27022dc
+};
+
+constexpr uint32_t SM4_CK[32] = {
+    0x00070e15, 0x1c232a31, 0x383f464d, 0x545b6269,
+    0x70777e85, 0x8c939aa1, 0xa8afb6bd, 0xc4cbd2d9,
+    0xe0e7eef5, 0xfc030a11, 0x181f262d, 0x343b4249,
+    0x50575e65, 0x6c737a81, 0x888f969d, 0xa4abb2b9,
+    0xc0c7ced5, 0xdce3eaf1, 0xf8ff060d, 0x141b2229,
+    0x30373e45, 0x4c535a61, 0x686f767d, 0x848b9299,
+    0xa0a7aeb5, 0xbcc3cad1, 0xd8dfe6ed, 0xf4fb0209,
+    0x10171e25, 0x2c333a41, 0x484f565d, 0x646b7279
+};
+
+inline uint32_t sm4Rotl(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+// Ħӣʵַ룬лʱй¶ֻڲԶգDRBGʹSM4_MB::tau
+inline uint32_t sm4TauTable(uint32_t x) {
+    return ((uint32_t)SM4_SBOX[x >> 24] << 24) | ((uint32_t)SM4_SBOX[(x >> 16) & 0xFF] << 16) |
+        ((uint32_t)SM4_SBOX[(x >> 8) & 0xFF] << 8) | SM4_SBOX[x & 0xFF];
+}
+
+inline uint32_t loadBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+inline void storeBE32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// Կչrk[i] = K[i+4] = K[i] ^ T'(K[i+1] ^ K[i+2] ^ K[i+3] ^ CK[i])TauΪõSʵ
+template <uint32_t (*Tau)(uint32_t)>
+void sm4KeyExpansionWith(const uint8_t key[16], uint32_t rk[32]) {
+    uint32_t k[4];
+    for (int i = 0; i < 4; ++i) {
+        k[i] = loadBE32(key + 4 * i) ^ SM4_FK[i];
+    }
+    for (int i = 0; i < 32; ++i) {
+        uint32_t t = Tau(k[(i + 1) % 4] ^ k[(i + 2) % 4] ^ k[(i + 3) % 4] ^ SM4_CK[i]);
+        k[i % 4] ^= t ^ sm4Rotl(t, 13) ^ sm4Rotl(t, 23);
+        rk[i] = k[i % 4];
+    }
+}
+
+// ܣʵ֣
+template <uint32_t (*Tau)(uint32_t)>
+void sm4EncryptBlockWith(const uint32_t rk[32], const uint8_t in[16], uint8_t out[16]) {
+    uint32_t x[4];
+    for (int i = 0; i < 4; ++i) {
+        x[i] = loadBE32(in + 4 * i);
+    }
+    for (int i = 0; i < 32; ++i) {
+        uint32_t t = Tau(x[(i + 1) % 4] ^ x[(i + 2) % 4] ^ x[(i + 3) % 4] ^ rk[i]);
+        x[i % 4] ^= t ^ sm4Rotl(t, 2) ^ sm4Rotl(t, 10) ^ sm4Rotl(t, 18) ^ sm4Rotl(t, 24);
+    }
+    for (int i = 0; i < 4; ++i) {
+        storeBE32(out + 4 * i, x[3 - i]);
+    }
+}
+
+// SM4ںˣ16鰴תõAVX2ĴУÿĴ8ͬһ֣齻
+// SнAES-NISM4AESSжӷ任ͬ
+// Ȱӳ䵽AESʾaesenclastԿΪ0棬ٷӳSM4S
+// η任ɸߵͰֽpshufbSƵtestSM4ֽں˶ȫ256
+class SM4_MB {
+public:
+    static constexpr int LANES = 16;
+
+    static void encrypt(const uint32_t rk[32], const uint8_t in[LANES * 16], uint8_t out[LANES * 16]) {
+        __m256i a[4], b[4];
+        load(in, a);
+        load(in + 128, b);
+        for (int i = 0; i < 32; i += 4) {
+            round(a[0], a[1], a[2], a[3], b[0], b[1], b[2], b[3], rk[i]);
+            round(a[1], a[2], a[3], a[0], b[1], b[2], b[3], b[0], rk[i + 1]);
+            round(a[2], a[3], a[0], a[1], b[2], b[3], b[0], b[1], rk[i + 2]);
+            round(a[3], a[0], a[1], a[2], b[3], b[0], b[1], b[2], rk[i + 3]);
+        }
+        // (X35, X34, X33, X32)
+        std::swap(a[0], a[3]);
+        std::swap(a[1], a[2]);
+        std::swap(b[0], b[3]);
+        std::swap(b[1], b[2]);
+        store(a, out);
+        store(b, out + 128);
+    }
+
+    // ֵĦӣں˹óʱS
+    static uint32_t tau(uint32_t x) {
+        return (uint32_t)_mm256_cvtsi256_si32(sbox(_mm256_set1_epi32((int)x)));
+    }
+
+private:
+    // 8飺ÿ32λתΪ44תãתǶԺϵģ洢ʱͬĲɻԭ
+    static void load(const uint8_t* in, __m256i w[4]) {
+        const __m256i bswap = byteSwapMask();
+        for (int i = 0; i < 4; ++i) {
+            w[i] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(in + 32 * i)), bswap);
+        }
+        transpose(w);
+    }
+
+    static void store(__m256i w[4], uint8_t* out) {
+        const __m256i bswap = byteSwapMask();
+        transpose(w);
+        for (int i = 0; i < 4; ++i) {
+            _mm256_storeu_si256((__m256i*)(out + 32 * i), _mm256_shuffle_epi8(w[i], bswap));
+        }
+    }
+
+    static void transpose(__m256i w[4]) {
+        __m256i t0 = _mm256_unpacklo_epi32(w[0], w[1]);
+        __m256i t1 = _mm256_unpackhi_epi32(w[0], w[1]);
+        __m256i t2 = _mm256_unpacklo_epi32(w[2], w[3]);
+        __m256i t3 = _mm256_unpackhi_epi32(w[2], w[3]);
+        w[0] = _mm256_unpacklo_epi64(t0, t2);
+        w[1] = _mm256_unpackhi_epi64(t0, t2);
+        w[2] = _mm256_unpacklo_epi64(t1, t3);
+        w[3] = _mm256_unpackhi_epi64(t1, t3);
+    }
+
+    static __m256i byteSwapMask() {
+        return _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    }
+
+    // ߵͰֽڲķ任
+    static __m256i affine(__m256i x, __m256i lo, __m256i hi) {
+        const __m256i mask = _mm256_set1_epi8(0x0F);
+        __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(x, mask));
+        __m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+        return _mm256_xor_si256(l, h);
+    }
+
+    static __m256i sbox(__m256i x) {
+#ifdef __GFNI__
+        // GFNIʱָɣӳ䵽AESʾ沢ӳ
+        x = _mm256_gf2p8affine_epi64_epi8(x, _mm256_set1_epi64x(0x4c287db91a22505dLL), 0x3e);
+        return _mm256_gf2p8affineinv_epi64_epi8(x, _mm256_set1_epi64x((long long)0xf3ab34a974a6b589ULL), 0xd3);
+#else
+        const __m256i preLo = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+            0x3e, (char)0xb2, 0x0e, (char)0x82, (char)0xbb, 0x37, (char)0x8b, 0x07,
+            (char)0xa1, 0x2d, (char)0x91, 0x1d, 0x24, (char)0xa8, 0x14, (char)0x98));
+        const __m256i preHi = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+            0x00, (char)0xdc, 0x2e, (char)0xf2, (char)0xc5, 0x19, (char)0xeb, 0x37,
+            0x08, (char)0xd4, 0x26, (char)0xfa, (char)0xcd, 0x11, (char)0xe3, 0x3f));
+        const __m256i postLo = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+            0x6c, (char)0xd4, (char)0xa6, 0x1e, 0x52, (char)0xea, (char)0x98, 0x20,
+            0x0b, (char)0xb3, (char)0xc1, 0x79, 0x35, (char)0x8d, (char)0xff, 0x47));
+        const __m256i postHi = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+            0x00, (char)0xe0, 0x50, (char)0xb0, (char)0x9d, 0x7d, (char)0xcd, 0x2d,
+            (char)0xc0, 0x20, (char)0x90, 0x70, 0x5d, (char)0xbd, 0x0d, (char)0xed));
+        // λaesenclastеλֻֽڴ
+        const __m256i invShiftRows = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+            0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3));
+        x = _mm256_shuffle_epi8(affine(x, preLo, preHi), invShiftRows);
+        const __m128i zero = _mm_setzero_si128();
+        __m128i lo = _mm_aesenclast_si128(_mm256_castsi256_si128(x), zero);
+        __m128i hi = _mm_aesenclast_si128(_mm256_extracti128_si256(x, 1), zero);
+        return affine(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), postLo, postHi);
+#endif
+    }
+
+    static __m256i rotl(__m256i x, int n) {
+        return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+    }
+
+    // L(t) = t ^ (t <<< 2) ^ (t <<< 10) ^ (t <<< 18) ^ (t <<< 24)
+    //      = t ^ (t <<< 24) ^ ((t ^ (t <<< 8) ^ (t <<< 16)) <<< 2)8ıѭλֽ
+    static __m256i linear(__m256i t) {
+        const __m256i r8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+            3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+        const __m256i r16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+            2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+        const __m256i r24 = _mm256_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+            1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+        __m256i u = _mm256_xor_si256(t, _mm256_xor_si256(_mm256_shuffle_epi8(t, r8), _mm256_shuffle_epi8(t, r16)));
+        return _mm256_xor_si256(_mm256_xor_si256(t, _mm256_shuffle_epi8(t, r24)), rotl(u, 2));
+    }
+
+    // һ֣X0 ^= L((X1 ^ X2 ^ X3 ^ rk))齻ˮ
+    static inline __attribute__((always_inline)) void round(__m256i& a0, const __m256i& a1, const __m256i& a2,
+        const __m256i& a3, __m256i& b0, const __m256i& b1, const __m256i& b2, const __m256i& b3, uint32_t rk) {
+        const __m256i k = _mm256_set1_epi32((int)rk);
+        __m256i ta = _mm256_xor_si256(_mm256_xor_si256(a1, a2), _mm256_xor_si256(a3, k));
+        __m256i tb = _mm256_xor_si256(_mm256_xor_si256(b1, b2), _mm256_xor_si256(b3, k));
+        a0 = _mm256_xor_si256(a0, linear(sbox(ta)));
+        b0 = _mm256_xor_si256(b0, linear(sbox(tb)));
+    }
+};
+
+// Կչ뵥ܣDRBGÿgenerate()ܵKV״̬£Sбǳʱ
+inline void sm4KeyExpansion(const uint8_t key[16], uint32_t rk[32]) {
+    sm4KeyExpansionWith<SM4_MB::tau>(key, rk);
+}
+
+inline void sm4EncryptBlock(const uint32_t rk[32], const uint8_t in[16], uint8_t out[16]) {
+    sm4EncryptBlockWith<SM4_MB::tau>(rk, in, out);
+}
+
+// ʵֻ֣ڲԶ
+inline void sm4KeyExpansionTable(const uint8_t key[16], uint32_t rk[32]) {
+    sm4KeyExpansionWith<sm4TauTable>(key, rk);
+}
+
+inline void sm4EncryptBlockTable(const uint32_t rk[32], const uint8_t in[16], uint8_t out[16]) {
+    sm4EncryptBlockWith<sm4TauTable>(rk, in, out);
+}
+
+// getrandom()lenֽ
+void getEntropy(uint8_t* out, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = getrandom(out + got, len - got, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("getrandom failed");
+        }
+        got += (size_t)n;
+    }
+}
+
+// SM4-CTR_DRBGSP 800-90A 10.2ʹ״̬Ϊ16ֽԿK16ֽڼVseedlen = 32ֽ
+// ֱȡgetrandom()Ϊأ32ֽڵĸԻSM3ѹ32ֽ
+// ÿ64KB2^19λgenerate()ڲɶ֮״̬
+// ʱÿ16SM4_MBܣforkӽ״ǰԶ²֣ӽͬ
+class SM4_CtrDrbg {
+public:
+    static constexpr size_t SEED_LEN = 32;
+    static constexpr size_t MAX_REQUEST = 1 << 16;
+    static constexpr uint64_t RESEED_INTERVAL = 1ull << 48;
+
+    explicit SM4_CtrDrbg(const uint8_t* personalization = nullptr, size_t len = 0) {
+        uint8_t entropy[SEED_LEN];
+        getEntropy(entropy, sizeof(entropy));
+        instantiate(entropy, personalization, len);
+        memset(entropy, 0, sizeof(entropy));
+    }
+
+    ~SM4_CtrDrbg() {
+        memset(buffer, 0, sizeof(buffer));
+        memset(key, 0, sizeof(key));
+        memset(rk, 0, sizeof(rk));
+        memset(v, 0, sizeof(v));
+    }
+
+    // øʵãʹù캯getrandom()ȡأ
+    void instantiate(const uint8_t entropy[SEED_LEN], const uint8_t* personalization, size_t len) {
+        uint8_t seed[SEED_LEN];
+        compress(personalization, len, seed);
+        for (size_t i = 0; i < SEED_LEN; ++i) {
+            seed[i] ^= entropy[i];
+        }
+        memset(key, 0, sizeof(key));
+        memset(v, 0, sizeof(v));
+        sm4KeyExpansion(key, rk);
+        update(seed);
+        memset(seed, 0, sizeof(seed));
+        reseedCounter = 1;
+        pid = getpid();
+    }
+
+    void reseed(const uint8_t* additional = nullptr, size_t len = 0) {
+        uint8_t entropy[SEED_LEN];
+        getEntropy(entropy, sizeof(entropy));
+        reseed(entropy, additional, len);
+        memset(entropy, 0, sizeof(entropy));
+    }
+
+    void reseed(const uint8_t entropy[SEED_LEN], const uint8_t* additional, size_t len) {
+        uint8_t seed[SEED_LEN];
+        compress(additional, len, seed);
+        for (size_t i = 0; i < SEED_LEN; ++i) {
+            seed[i] ^= entropy[i];
+        }
+        update(seed);
+        memset(seed, 0, sizeof(seed));
+        reseedCounter = 1;
+        pid = getpid();
+    }
+
+    void generate(uint8_t* out, size_t len, const uint8_t* additional = nullptr, size_t addLen = 0) {
+        uint8_t extra[SEED_LEN];
+        compress(additional, addLen, extra);
+        bool hasExtra = additional && addLen;
+        do {
+            if (reseedCounter > RESEED_INTERVAL || getpid() != pid) {
+                reseed(additional, addLen);
+                hasExtra = false;
+                memset(extra, 0, sizeof(extra));
+            }
+            if (hasExtra) {
+                update(extra);
+            }
+            size_t n = std::min(len, MAX_REQUEST);
+            keystream(out, n);
+            update(extra);
+            ++reseedCounter;
+            out += n;
+            len -= n;
+        } while (len > 0);
+        memset(extra, 0, sizeof(extra));
+    }
+
+    // СǩIV4KBȡһgenerate()ȡߵֽ㣻
+    // ÿgenerate()Ҫ״̬ηһԿչ32ֽʱⲿռ˴ʱ
+    void read(uint8_t* out, size_t len) {
+        if (getpid() != pid) {
+            memset(buffer, 0, sizeof(buffer));
+            buffered = 0;
+        }
+        if (len >= sizeof(buffer)) {
+            generate(out, len);
+            return;
+        }
+        while (len > 0) {
+            if (buffered == 0) {
+                generate(buffer, sizeof(buffer));
+                buffered = sizeof(buffer);
+            }
+            size_t n = std::min(len, buffered);
+            uint8_t* src = buffer + sizeof(buffer) - buffered;
+            memcpy(out, src, n);
+            memset(src, 0, n);
+            buffered -= n;
+            out += n;
+            len -= n;
+        }
+    }
+
+    uint64_t reseedCount() const {
+        return reseedCounter;
+    }
+
+private:
+    uint8_t key[16];
+    uint32_t rk[32];
+    uint8_t v[16];
+    uint64_t reseedCounter;
+    pid_t pid;
+    uint8_t buffer[4096];
+    size_t buffered = 0;
+
+    // Ȳ32ֽڵ벹㣬SM3ѹ
+    static void compress(const uint8_t* data, size_t len, uint8_t out[SEED_LEN]) {
+        memset(out, 0, SEED_LEN);
+        if (!data || len == 0) {
+            return;
+        }
+        if (len <= SEED_LEN) {
+            memcpy(out, data, len);
+            return;
+        }
+        SM3_Optimized sm3;
+        sm3.update(data, len);
+        sm3.final(out);
+    }
+
+    // V = (V + 1) mod 2^128
+    void increment() {
+        for (int i = 15; i >= 0 && ++v[i] == 0; --i) {
+        }
+    }
+
+    // CTR_DRBG_Updatetemp = E(K, V+1) || E(K, V+2)providedǰ16ֽΪK16ֽΪV
+    void update(const uint8_t provided[SEED_LEN]) {
+        uint8_t temp[SEED_LEN];
+        increment();
+        sm4EncryptBlock(rk, v, temp);
+        increment();
+        sm4EncryptBlock(rk, v, temp + 16);
+        for (size_t i = 0; i < SEED_LEN; ++i) {
+            temp[i] ^= provided[i];
+        }
+        memcpy(key, temp, 16);
+        memcpy(v, temp + 16, 16);
+        sm4KeyExpansion(key, rk);
+        memset(temp, 0, sizeof(temp));
+    }
+
+    // E(K, V+1) || E(K, V+2) || ...ǰlenֽڣ16ֱд÷
+    // V64λͣһļ
+    void keystream(uint8_t* out, size_t len) {
+        alignas(32) uint8_t counters[SM4_MB::LANES * 16];
+        alignas(32) uint8_t tail[SM4_MB::LANES * 16];
+        uint64_t hi, lo;
+        memcpy(&hi, v, 8);
+        memcpy(&lo, v + 8, 8);
+        hi = __builtin_bswap64(hi);
+        lo = __builtin_bswap64(lo);
+        while (len > 0) {
+            size_t n = std::min(len, sizeof(counters));
+            size_t blocks = (n + 15) / 16;
+            for (size_t i = 0; i < blocks; ++i) {
+                hi += ++lo == 0;
+                uint64_t be[2] = { __builtin_bswap64(hi), __builtin_bswap64(lo) };
+                memcpy(counters + 16 * i, be, 16);
+            }
+            if (n == sizeof(counters)) {
+                SM4_MB::encrypt(rk, counters, out);
+            }
+            else {
+                SM4_MB::encrypt(rk, counters, tail);
+                memcpy(out, tail, n);
+                memset(tail, 0, sizeof(tail));
+            }
+            out += n;
+            len -= n;
+        }
+        hi = __builtin_bswap64(hi);
+        lo = __builtin_bswap64(lo);
+        memcpy(v, &hi, 8);
+        memcpy(v + 8, &lo, 8);
+    }
+};
+
+// HMAC-SM3 DRBGSP 800-90A 10.1.2״̬Ϊ32ֽڵKV32ֽڡnonce 16ֽȡgetrandom()
+class SM3_HmacDrbg {
+public:
+    static constexpr size_t OUT_LEN = 32;
+    static constexpr size_t MAX_REQUEST = 1 << 16;
+    static constexpr uint64_t RESEED_INTERVAL = 1ull << 48;
+
+    explicit SM3_HmacDrbg(const uint8_t* personalization = nullptr, size_t len = 0) {
+        uint8_t entropy[48];
+        getEntropy(entropy, sizeof(entropy));
+        instantiate(entropy, sizeof(entropy), personalization, len);
+        memset(entropy, 0, sizeof(entropy));
+    }
+
+    ~SM3_HmacDrbg() {
+        memset(k, 0, sizeof(k));
+        memset(v, 0, sizeof(v));
+    }
+
+    // seed_material = entropy_input || nonce || personalization_string
+    void instantiate(const uint8_t* entropy, size_t entropyLen, const uint8_t* personalization, size_t len) {
+        std::vector<uint8_t> seed(entropy, entropy + entropyLen);
+        if (personalization) {
+            seed.insert(seed.end(), personalization, personalization + len);
+        }
+        memset(k, 0x00, sizeof(k));
+        memset(v, 0x01, sizeof(v));
+        update(seed.data(), seed.size());
+        std::fill(seed.begin(), seed.end(), 0);
+        reseedCounter = 1;
+        pid = getpid();
+    }
+
+    void reseed(const uint8_t* additional = nullptr, size_t len = 0) {
+        uint8_t entropy[OUT_LEN];
+        getEntropy(entropy, sizeof(entropy));
+        reseed(entropy, sizeof(entropy), additional, len);
+        memset(entropy, 0, sizeof(entropy));
+    }
+
+    // seed_material = entropy_input || additional_input
+    void reseed(const uint8_t* entropy, size_t entropyLen, const uint8_t* additional, size_t len) {
+        std::vector<uint8_t> seed(entropy, entropy + entropyLen);
+        if (additional) {
+            seed.insert(seed.end(), additional, additional + len);
+        }
+        update(seed.data(), seed.size());
+        std::fill(seed.begin(), seed.end(), 0);
+        reseedCounter = 1;
+        pid = getpid();
+    }
+
+    void generate(uint8_t* out, size_t len, const uint8_t* additional = nullptr, size_t addLen = 0) {
+        if (!additional) {
+            addLen = 0;
+        }
+        do {
+            if (reseedCounter > RESEED_INTERVAL || getpid() != pid) {
+                reseed(additional, addLen);
+                addLen = 0;
+            }
+            if (addLen) {
+                update(additional, addLen);
+            }
+            size_t n = std::min(len, MAX_REQUEST);
+            HMAC_SM3 hmac(k, sizeof(k));
+            for (size_t off = 0; off < n; off += OUT_LEN) {
+                hmac.mac(v, sizeof(v), v);
+                memcpy(out + off, v, std::min(OUT_LEN, n - off));
+            }
+            update(additional, addLen);
+            ++reseedCounter;
+            out += n;
+            len -= n;
+        } while (len > 0);
+    }
+
+private:
+    uint8_t k[OUT_LEN];
+    uint8_t v[OUT_LEN];
+    uint64_t reseedCounter;
+    pid_t pid;
+
+    // HMAC_DRBG_UpdateK = HMAC(K, V || 0x00 || provided)V = HMAC(K, V)providedǿʱ0x01һ
+    void update(const uint8_t* provided, size_t len) {
+        std::vector<uint8_t> buf(OUT_LEN + 1 + len);
+        for (uint8_t round = 0; round < 2; ++round) {
+            memcpy(buf.data(), v, OUT_LEN);
+            buf[OUT_LEN] = round;
+            if (len) {
+                memcpy(buf.data() + OUT_LEN + 1, provided, len);
+            }
+            HMAC_SM3(k, sizeof(k)).mac(buf.data(), buf.size(), k);
+            HMAC_SM3(k, sizeof(k)).mac(v, sizeof(v), v);
+            if (len == 0) {
+                break;
+            }
+        }
+        std::fill(buf.begin(), buf.end(), 0);
+    }
+};
+
+// ÿ߳һʵʱҪ
+SM4_CtrDrbg& threadCtrDrbg() {
+    thread_local SM4_CtrDrbg drbg;
+    return drbg;
+}
+
+SM3_HmacDrbg& threadHmacDrbg() {
+    thread_local SM3_HmacDrbg drbg;
+    return drbg;
+}
+
+void printHex(const char* label, const uint8_t* data, size_t len) {
+    std::cout << label << ": ";
+    for (size_t i = 0; i < len; ++i) {
+        std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)data[i];
+    }
+    std::cout << std::dec << std::endl;
+}
+
+// SM4ԣ׼100εĽںʵֽں˶
+void testSM4() {
+    const uint8_t key[16] = {
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10
+    };
+    const uint8_t expected[16] = {
+        0x68, 0x1e, 0xdf, 0x34, 0xd2, 0x06, 0x96, 0x5e, 0x86, 0xb3, 0xe9, 0x4f, 0x53, 0x6e, 0x42, 0x46
+    };
+    const uint8_t expectedMillion[16] = {
+        0x59, 0x52, 0x98, 0xc7, 0xc6, 0xfd, 0x27, 0x1f, 0x04, 0x02, 0xf8, 0x04, 0xc3, 0x3d, 0x3f, 0x66
+    };
+    uint32_t rk[32];
+    sm4KeyExpansion(key, rk);
+
+    uint8_t block[16];
+    sm4EncryptBlock(rk, key, block);
+    printHex("SM4(0123456789abcdeffedcba9876543210)", block, 16);
+    bool ok = memcmp(block, expected, 16) == 0;
+
+    // 16鶼ȡһε1000000κ׼ĽȽ
+    alignas(32) uint8_t blocks[SM4_MB::LANES * 16];
+    for (int i = 0; i < SM4_MB::LANES; ++i) {
+        memcpy(blocks + 16 * i, key, 16);
+    }
+    for (int i = 0; i < 1000000; ++i) {
+        SM4_MB::encrypt(rk, blocks, blocks);
+    }
+    bool million = true;
+    for (int i = 0; i < SM4_MB::LANES; ++i) {
+        million = million && memcmp(blocks + 16 * i, expectedMillion, 16) == 0;
+    }
+
+    // Sе256ȫں
+    alignas(32) uint8_t in[SM4_MB::LANES * 16], out[SM4_MB::LANES * 16];
+    bool kernel = true;
+    for (int trial = 0; trial < 64; ++trial) {
+        for (size_t i = 0; i < sizeof(in); ++i) {
+            in[i] = (uint8_t)(i + trial * 37);
+        }
+        SM4_MB::encrypt(rk, in, out);
+        for (int i = 0; i < SM4_MB::LANES; ++i) {
+            sm4EncryptBlock(rk, in + 16 * i, block);
+            kernel = kernel && memcmp(block, out + 16 * i, 16) == 0;
+        }
+    }
+    // ʱԿչ뵥ʵһ
+    bool table = true;
+    uint8_t randomKey[16];
+    uint32_t rkTable[32];
+    uint8_t blockTable[16];
+    for (int trial = 0; trial < 1000; ++trial) {
+        for (int i = 0; i < 16; ++i) {
+            randomKey[i] = (uint8_t)(trial * 131 + i * 29 + (trial >> 3) * i);
+        }
+        sm4KeyExpansion(randomKey, rk);
+        sm4KeyExpansionTable(randomKey, rkTable);
+        sm4EncryptBlock(rk, randomKey, block);
+        sm4EncryptBlockTable(rkTable, randomKey, blockTable);
+        table = table && memcmp(rk, rkTable, sizeof(rk)) == 0 && memcmp(block, blockTable, 16) == 0;
+    }
+    std::cout << "SM4 test vector: " << (ok ? "passed" : "FAILED") << ", 1000000 iterations: "
+        << (million ? "passed" : "FAILED") << ", 16-block kernel matches scalar: " << (kernel ? "yes" : "no")
+        << ", constant-time S-box matches table: " << (table ? "yes" : "no") << std::endl;
+}
+
+// ֪𰸣Ϊ00 01 02 ...Ի"SM4-DRBG test"ɶPythonʵ֣SM4׼ּ㣬HMAChashlibsm3
+// Ϊһڶgenerate(32)"extra"ĵһgenerate(32)
+// 80 81 82 ..."reseed"²ֺĵһgenerate(32)
+const uint8_t CTR_DRBG_KAT[4][32] = {
+    {
+        0x94, 0xfd, 0xa4, 0xd3, 0x50, 0xa9, 0x92, 0x91, 0xe4, 0x5c, 0xc6, 0xec, 0xa2, 0x00, 0x56, 0x86,
+        0xf4, 0x7e, 0xc8, 0x0f, 0x73, 0x4a, 0x17, 0xae, 0x68, 0xc7, 0xab, 0xed, 0x01, 0x1f, 0x11, 0x10
+    },
+    {
+        0x5e, 0xe4, 0xae, 0x0d, 0x77, 0x50, 0x89, 0xc0, 0xaf, 0x37, 0xda, 0xff, 0x8c, 0x40, 0x89, 0xbb,
+        0x26, 0xf2, 0x05, 0x6b, 0xa0, 0x1c, 0x48, 0xc7, 0x86, 0x5e, 0x8c, 0x30, 0x6d, 0xff, 0xdd, 0x6d
+    },
+    {
+        0x3a, 0xb7, 0xa9, 0xea, 0x93, 0xd0, 0x50, 0xcc, 0xb5, 0x9d, 0x0c, 0x02, 0xd1, 0xfe, 0x75, 0x6f,
+        0x3d, 0x1b, 0xf3, 0xef, 0x48, 0x66, 0xb9, 0xb1, 0x80, 0x99, 0x6c, 0x3c, 0x50, 0xe2, 0xc1, 0x4c
+    },
+    {
+        0x1f, 0x65, 0x48, 0x5e, 0xf1, 0x12, 0xd0, 0xb9, 0x5c, 0xb4, 0x8a, 0xa3, 0xbc, 0x4c, 0x6b, 0x1c,
+        0xe6, 0x51, 0x39, 0x0e, 0xc6, 0x5b, 0x13, 0xc6, 0x20, 0x9f, 0xfa, 0x3b, 0xfc, 0x29, 0xb5, 0x92
+    }
+};
+
+const uint8_t HMAC_DRBG_KAT[4][32] = {
+    {
+        0x14, 0xf4, 0x99, 0xfd, 0x40, 0x72, 0x22, 0x13, 0x7b, 0x21, 0x14, 0xf2, 0x42, 0x5a, 0xaf, 0x9c,
+        0xc8, 0xc2, 0xc5, 0x81, 0x5f, 0x02, 0x37, 0x8d, 0x5f, 0xa3, 0xe1, 0x0c, 0x34, 0x90, 0xb3, 0x57
+    },
+    {
+        0xd3, 0x36, 0x5c, 0x07, 0x3f, 0x2f, 0x72, 0x13, 0xce, 0x42, 0x0d, 0x15, 0x2e, 0x34, 0x94, 0xab,
+        0x5f, 0x23, 0xee, 0x59, 0xe8, 0xf9, 0x8d, 0x7b, 0xf6, 0x25, 0xc8, 0x99, 0x8e, 0x74, 0xdc, 0x06
+    },
+    {
+        0xa3, 0xa1, 0x91, 0xf5, 0xb8, 0x9d, 0x53, 0x35, 0xf1, 0x8c, 0x6a, 0x61, 0x4b, 0xb3, 0x5d, 0xef,
+        0xd9, 0xd4, 0x57, 0x93, 0x58, 0x74, 0x03, 0xbf, 0xac, 0xa1, 0xbe, 0x29, 0xcd, 0x50, 0xbc, 0x0f
+    },
+    {
+        0x91, 0x5a, 0x7c, 0x9a, 0x96, 0xd7, 0xe7, 0xed, 0x59, 0xbb, 0xcd, 0x01, 0x08, 0xc8, 0x4d, 0x7e,
+        0x0e, 0x8d, 0xab, 0x1e, 0xc8, 0x89, 0x29, 0x94, 0xc3, 0x61, 0x59, 0x12, 0xd4, 0x27, 0x57, 0x23
+    }
+};
+
+// ֪𰸵θ32ֽ
+template <typename Drbg, typename Instantiate, typename Reseed>
+bool checkDrbgKat(const uint8_t expected[4][32], Instantiate instantiate, Reseed reseed) {
+    const uint8_t* extra = (const uint8_t*)"extra";
+    const uint8_t* reseedInput = (const uint8_t*)"reseed";
+    uint8_t out[4][32];
+    Drbg first, second, third;
+    instantiate(first);
+    first.generate(out[0], 32);
+    first.generate(out[1], 32);
+    instantiate(second);
+    second.generate(out[2], 32, extra, 5);
+    instantiate(third);
+    reseed(third, reseedInput, 6);
+    third.generate(out[3], 32);
+    return memcmp(out, expected, sizeof(out)) == 0;
+}
+
+// DRBGԣ֪𰸣read()岻ıһıforkͬ
+void testDrbg() {
+    uint8_t entropy[48];
+    for (int i = 0; i < 48; ++i) {
+        entropy[i] = (uint8_t)i;
+    }
+    const char* personalization = "SM4-DRBG test";
+    uint8_t reseedEntropy[32];
+    for (int i = 0; i < 32; ++i) {
+        reseedEntropy[i] = (uint8_t)(0x80 + i);
+    }
+    bool ctrKat = checkDrbgKat<SM4_CtrDrbg>(CTR_DRBG_KAT,
+        [&](SM4_CtrDrbg& drbg) { drbg.instantiate(entropy, (const uint8_t*)personalization, strlen(personalization)); },
+        [&](SM4_CtrDrbg& drbg, const uint8_t* add, size_t len) { drbg.reseed(reseedEntropy, add, len); });
+    bool hmacKat = checkDrbgKat<SM3_HmacDrbg>(HMAC_DRBG_KAT,
+        [&](SM3_HmacDrbg& drbg) {
+            drbg.instantiate(entropy, sizeof(entropy), (const uint8_t*)personalization, strlen(personalization));
+        },
+        [&](SM3_HmacDrbg& drbg, const uint8_t* add, size_t len) {
+            drbg.reseed(reseedEntropy, sizeof(reseedEntropy), add, len);
+        });
+    std::cout << "CTR_DRBG known answers: " << (ctrKat ? "passed" : "FAILED") << ", HMAC_DRBG known answers: "
+        << (hmacKat ? "passed" : "FAILED") << std::endl;
+
+    SM4_CtrDrbg a, b;
+    a.instantiate(entropy, (const uint8_t*)personalization, strlen(personalization));
+    b.instantiate(entropy, (const uint8_t*)personalization, strlen(personalization));
+    std::vector<uint8_t> x(1000), y(1000);
+    a.generate(x.data(), x.size());
+    b.generate(y.data(), y.size());
+    bool ctrSame = x == y;
+    printHex("CTR_DRBG first 32 bytes", x.data(), 32);
+
+    // ʵֶգһE(K, V+1) || E(K, V+2) || ...
+    SM4_CtrDrbg c;
+    c.instantiate(entropy, (const uint8_t*)personalization, strlen(personalization));
+    std::vector<uint8_t> big(3 * SM4_CtrDrbg::MAX_REQUEST + 100);
+    c.generate(big.data(), big.size());
+    bool prefixSame = memcmp(big.data(), x.data(), x.size()) == 0;
+    // read()ͬһ
+    SM4_CtrDrbg d;
+    d.instantiate(entropy, (const uint8_t*)personalization, strlen(personalization));
+    uint8_t pieces[100];
+    d.read(pieces, 40);
+    d.read(pieces + 40, 60);
+    prefixSame = prefixSame && memcmp(pieces, big.data(), sizeof(pieces)) == 0;
+
+    b.generate(y.data(), y.size(), (const uint8_t*)"extra", 5);
+    a.generate(x.data(), x.size());
+    bool additionalDiffers = x != y;
+
+    std::vector<uint8_t> parent(32), child(32);
+    int fds[2];
+    bool forkDiffers = false;
+    if (pipe(fds) == 0) {
+        pid_t pidChild = fork();
+        if (pidChild == 0) {
+            a.generate(child.data(), child.size());
+            ssize_t written = write(fds[1], child.data(), child.size());
+            _exit(written == (ssize_t)child.size() ? 0 : 1);
+        }
+        a.generate(parent.data(), parent.size());
+        forkDiffers = read(fds[0], child.data(), child.size()) == (ssize_t)child.size() && parent != child;
+        waitpid(pidChild, nullptr, 0);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    SM3_HmacDrbg h1, h2;
+    h1.instantiate(entropy, sizeof(entropy), (const uint8_t*)personalization, strlen(personalization));
+    h2.instantiate(entropy, sizeof(entropy), (const uint8_t*)personalization, strlen(personalization));
+    h1.generate(x.data(), x.size());
+    h2.generate(y.data(), y.size());
+    bool hmacSame = x == y;
+    printHex("HMAC_DRBG first 32 bytes", x.data(), 32);
+
+    std::cout << "CTR_DRBG deterministic: " << (ctrSame && prefixSame ? "yes" : "no") << ", additional input changes output: "
+        << (additionalDiffers ? "yes" : "no") << ", forked child reseeded: " << (forkDiffers ? "yes" : "no")
+        << ", HMAC_DRBG deterministic: " << (hmacSame ? "yes" : "no") << std::endl;
+}
+
+// ܣں¡߳CTR_DRBGHMAC_DRBGÿ߳һʵĶ߳
+void drbgPerformanceTest() {
+    uint32_t rk[32];
+    const uint8_t key[16] = { 0 };
+    sm4KeyExpansion(key, rk);
+    const size_t total = 256 * 1024 * 1024;
+    alignas(32) uint8_t blocks[SM4_MB::LANES * 16] = { 0 };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < total / sizeof(blocks); ++i) {
+        SM4_MB::encrypt(rk, blocks, blocks);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double kernelTime = std::chrono::duration<double>(end - start).count();
+
+    const size_t scalarTotal = 16 * 1024 * 1024;
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < scalarTotal / 16; ++i) {
+        sm4EncryptBlock(rk, blocks, blocks);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double scalarTime = std::chrono::duration<double>(end - start).count();
+
+    std::vector<uint8_t> buffer(16 * 1024 * 1024);
+    SM4_CtrDrbg& drbg = threadCtrDrbg();
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 16; ++i) {
+        drbg.generate(buffer.data(), buffer.size());
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double ctrTime = std::chrono::duration<double>(end - start).count();
+
+    // 32ֽСgenerate()뾭read()壬ÿεgetrandom()
+    uint8_t nonce[32];
+    const int requests = 1000000;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < requests; ++i) {
+        drbg.generate(nonce, sizeof(nonce));
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double smallTime = std::chrono::duration<double>(end - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < requests; ++i) {
+        drbg.read(nonce, sizeof(nonce));
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double bufferedTime = std::chrono::duration<double>(end - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < requests / 10; ++i) {
+        getEntropy(nonce, sizeof(nonce));
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double getrandomTime = std::chrono::duration<double>(end - start).count() * 10;
+
+    SM3_HmacDrbg& hmacDrbg = threadHmacDrbg();
+    start = std::chrono::high_resolution_clock::now();
+    hmacDrbg.generate(buffer.data(), buffer.size());
+    end = std::chrono::high_resolution_clock::now();
+    double hmacTime = std::chrono::duration<double>(end - start).count();
+
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    start = std::chrono::high_resolution_clock::now();
+    parallelFor(threads, threads, [&](size_t) {
+        std::vector<uint8_t> local(16 * 1024 * 1024);
+        for (int i = 0; i < 8; ++i) {
+            threadCtrDrbg().generate(local.data(), local.size());
+        }
+    });
+    end = std::chrono::high_resolution_clock::now();
+    double parallelTime = std::chrono::duration<double>(end - start).count();
+
+    const double mb = 1024.0 * 1024.0;
+    std::cout << "SM4 16-block kernel: " << total / mb / kernelTime << " MB/s, scalar: "
+        << scalarTotal / mb / scalarTime << " MB/s" << std::endl;
+    std::cout << "SM4-CTR_DRBG bulk: " << 16 * buffer.size() / mb / ctrTime << " MB/s, 32-byte requests: "
+        << requests / smallTime << " /s, buffered: " << requests / bufferedTime << " /s (getrandom: "
+        << requests / getrandomTime << " /s)" << std::endl;
+    std::cout << "HMAC-SM3 DRBG bulk: " << buffer.size() / mb / hmacTime << " MB/s" << std::endl;
+    std::cout << "SM4-CTR_DRBG with " << threads << " threads: " << threads * 8.0 * 16 / parallelTime << " MB/s"
+        << std::endl;
+}
+
+// ļʱSM4_DRBG_NO_MAIN
+#ifndef SM4_DRBG_NO_MAIN
+int main() {
+    testSM4();
+    testDrbg();
+    drbgPerformanceTest();
+    return 0;
+}
+#endif
+
+#endif
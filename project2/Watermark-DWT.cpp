@@ -0,0 +1,938 @@
+// HaarСͼˮӡprojec2.pyC++汾BGRתYYLάHaar任LLӴӦˮӡLLϵ任
+// LHaar任ֻ漰2^L2^Lؿ飬˰2^LС256зֿ飺ÿBGRY任Ƕ롢任дBGRL1ɣ
+// AVX2һδ8ϵͼдöPPM/PGMOpenCVĿ¼еͼ̳߳زд
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <immintrin.h>
+#include <dirent.h>
+#include <unistd.h>
+
+// 8λͼchannelsΪ3ʱBGRţOpenCVһ£Ϊ1ʱΪҶ
+struct Image {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// PPM(P6)/PGM(P5)PPMеRGB˳תΪBGR
+bool readPnm(const std::string& path, Image& img) {
+    std::ifstream in(path, std::ios::binary);
+    std::string magic;
+    if (!(in >> magic) || (magic != "P6" && magic != "P5")) {
+        return false;
+    }
+    auto readInt = [&](int& v) {
+        in >> std::ws;
+        while (in.peek() == '#') {
+            std::string comment;
+            std::getline(in, comment);
+            in >> std::ws;
+        }
+        return (bool)(in >> v);
+    };
+    int maxval = 0;
+    if (!readInt(img.width) || !readInt(img.height) || !readInt(maxval) ||
+        img.width <= 0 || img.height <= 0 || maxval != 255) {
+        return false;
+    }
+    in.get();
+    img.channels = magic == "P6" ? 3 : 1;
+    img.pixels.resize((size_t)img.width * img.height * img.channels);
+    if (!in.read((char*)img.pixels.data(), img.pixels.size())) {
+        return false;
+    }
+    if (img.channels == 3) {
+        for (size_t i = 0; i < img.pixels.size(); i += 3) {
+            std::swap(img.pixels[i], img.pixels[i + 2]);
+        }
+    }
+    return true;
+}
+
+bool writePnm(const std::string& path, const Image& img) {
+    if (img.channels != 1 && img.channels != 3) {
+        return false;
+    }
+    std::ofstream out(path, std::ios::binary);
+    out << (img.channels == 3 ? "P6" : "P5") << "\n" << img.width << " " << img.height << "\n255\n";
+    if (img.channels == 1) {
+        out.write((const char*)img.pixels.data(), img.pixels.size());
+    }
+    else {
+        std::vector<uint8_t> row((size_t)img.width * 3);
+        for (int y = 0; y < img.height; ++y) {
+            const uint8_t* src = &img.pixels[(size_t)y * row.size()];
+            for (size_t i = 0; i < row.size(); i += 3) {
+                row[i] = src[i + 2];
+                row[i + 1] = src[i + 1];
+                row[i + 2] = src[i];
+            }
+            out.write((const char*)row.data(), row.size());
+        }
+    }
+    return (bool)out;
+}
+
+// OpenCVBGR2YCrCbͬĶϵ14λСY = 0.114B + 0.587G + 0.299R
+const int Y_SHIFT = 14;
+const int Y_B = 1868, Y_G = 9617, Y_R = 4899;
+
+inline int lumaOf(const uint8_t* bgr) {
+    return (bgr[0] * Y_B + bgr[1] * Y_G + bgr[2] * Y_R + (1 << (Y_SHIFT - 1))) >> Y_SHIFT;
+}
+
+// pshufb룺16BGRأ3ĴBGRͨԼ16ֽڸݻԭ
+struct PixelShuffles {
+    alignas(16) uint8_t split[3][3][16];   // [ͨ][Ĵ]
+    alignas(16) uint8_t spread[3][16];     // [Ĵ]
+
+    PixelShuffles() {
+        for (int c = 0; c < 3; ++c) {
+            for (int r = 0; r < 3; ++r) {
+                for (int i = 0; i < 16; ++i) {
+                    int src = 3 * i + c;
+                    split[c][r][i] = src / 16 == r ? (uint8_t)(src % 16) : 0x80;
+                }
+            }
+        }
+        for (int r = 0; r < 3; ++r) {
+            for (int i = 0; i < 16; ++i) {
+                spread[r][i] = (uint8_t)((16 * r + i) / 3);
+            }
+        }
+    }
+};
+
+const PixelShuffles& pixelShuffles() {
+    static const PixelShuffles shuffles;
+    return shuffles;
+}
+
+inline __m128i loadMask(const uint8_t* mask) {
+    return _mm_load_si128((const __m128i*)mask);
+}
+
+// һnBGRתΪȣȡfloat棩
+void bgrToLuma(const uint8_t* bgr, float* y, int n) {
+    const PixelShuffles& ps = pixelShuffles();
+    const __m256i coefBG = _mm256_set1_epi32((Y_G << 16) | Y_B);
+    const __m256i coefR1 = _mm256_set1_epi32(((1 << (Y_SHIFT - 1)) << 16) | Y_R);
+    const __m256i one = _mm256_set1_epi16(1);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8_t* p = bgr + 3 * i;
+        __m128i v0 = _mm_loadu_si128((const __m128i*)p);
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(p + 16));
+        __m128i v2 = _mm_loadu_si128((const __m128i*)(p + 32));
+        __m128i ch[3];
+        for (int c = 0; c < 3; ++c) {
+            ch[c] = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, loadMask(ps.split[c][0])),
+                _mm_shuffle_epi8(v1, loadMask(ps.split[c][1]))), _mm_shuffle_epi8(v2, loadMask(ps.split[c][2])));
+        }
+        __m256i b = _mm256_cvtepu8_epi16(ch[0]);
+        __m256i g = _mm256_cvtepu8_epi16(ch[1]);
+        __m256i r = _mm256_cvtepu8_epi16(ch[2]);
+        // ÿ128λͨڣloΪ0-38-11أhiΪ4-712-15
+        __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(b, g), coefBG),
+            _mm256_madd_epi16(_mm256_unpacklo_epi16(r, one), coefR1));
+        __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(b, g), coefBG),
+            _mm256_madd_epi16(_mm256_unpackhi_epi16(r, one), coefR1));
+        __m256 flo = _mm256_cvtepi32_ps(_mm256_srai_epi32(lo, Y_SHIFT));
+        __m256 fhi = _mm256_cvtepi32_ps(_mm256_srai_epi32(hi, Y_SHIFT));
+        _mm256_storeu_ps(y + i, _mm256_permute2f128_ps(flo, fhi, 0x20));
+        _mm256_storeu_ps(y + i + 8, _mm256_permute2f128_ps(flo, fhi, 0x31));
+    }
+    for (; i < n; ++i) {
+        y[i] = (float)lumaOf(bgr + 3 * i);
+    }
+}
+
+// һȵı仯ӵBGRͨϣYCrCbBGRYϵ1CrCbʱYԭӵBGR
+// ؾYCrCbȽص[0,255]루Pythonastype(uint8)ǽضϣ
+// float»x.9999سx-1Ϊͽȡ
+void applyLumaDelta(uint8_t* bgr, const float* rec, const float* orig, int n) {
+    const PixelShuffles& ps = pixelShuffles();
+    const __m256 lo = _mm256_setzero_ps(), hi = _mm256_set1_ps(255.0f);
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 r0 = _mm256_round_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(rec + i), lo), hi),
+            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 r1 = _mm256_round_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(rec + i + 8), lo), hi),
+            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256i d0 = _mm256_cvtps_epi32(_mm256_sub_ps(r0, _mm256_loadu_ps(orig + i)));
+        __m256i d1 = _mm256_cvtps_epi32(_mm256_sub_ps(r1, _mm256_loadu_ps(orig + i + 8)));
+        __m256i d = _mm256_permute4x64_epi64(_mm256_packs_epi32(d0, d1), 0xD8);
+        // ֳָԱͼӼȼڱ͵BGR+Y
+        __m256i pos = _mm256_max_epi16(d, zero);
+        __m256i neg = _mm256_max_epi16(_mm256_sub_epi16(zero, d), zero);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(pos, neg), 0xD8);
+        __m128i up = _mm256_castsi256_si128(packed);
+        __m128i down = _mm256_extracti128_si256(packed, 1);
+        uint8_t* p = bgr + 3 * i;
+        for (int r = 0; r < 3; ++r) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * r));
+            __m128i mask = loadMask(ps.spread[r]);
+            v = _mm_subs_epu8(_mm_adds_epu8(v, _mm_shuffle_epi8(up, mask)), _mm_shuffle_epi8(down, mask));
+            _mm_storeu_si128((__m128i*)(p + 16 * r), v);
+        }
+    }
+    for (; i < n; ++i) {
+        int d = (int)std::nearbyint(std::min(std::max(rec[i], 0.0f), 255.0f)) - (int)orig[i];
+        for (int c = 0; c < 3; ++c) {
+            bgr[3 * i + c] = (uint8_t)std::min(std::max(bgr[3 * i + c] + d, 0), 255);
+        }
+    }
+}
+
+// 22 HaarΣpywt'haar'ͬһ棩
+// (x0, x1, x2, x3)  ((x0+x1+x2+x3)/2, (x0-x1+x2-x3)/2, (x0+x1-x2-x3)/2, (x0-x1-x2+x3)/2)
+// 任ڵa b / c dLL HL / LH HH任LL HL / LH HHa b / c d
+// r0r12pairsԭдأLLдll任llȡ任
+void haarRowPair(float* r0, float* r1, float* ll, int pairs, bool inverse) {
+    const __m256 half = _mm256_set1_ps(0.5f);
+    int j = 0;
+    for (; j + 8 <= pairs; j += 8) {
+        __m256 a0 = _mm256_loadu_ps(r0 + 2 * j), a1 = _mm256_loadu_ps(r0 + 2 * j + 8);
+        __m256 b0 = _mm256_loadu_ps(r1 + 2 * j), b1 = _mm256_loadu_ps(r1 + 2 * j + 8);
+        // żλ÷ֿĴǵ0,1,4,5,2,3,6,7
+        __m256 x0 = _mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 x1 = _mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+        __m256 x2 = _mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 x3 = _mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+        if (inverse) {
+            x0 = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_loadu_ps(ll + j)), 0xD8));
+        }
+        __m256 s0 = _mm256_add_ps(x0, x1), d0 = _mm256_sub_ps(x0, x1);
+        __m256 s1 = _mm256_add_ps(x2, x3), d1 = _mm256_sub_ps(x2, x3);
+        __m256 y0 = _mm256_mul_ps(_mm256_add_ps(s0, s1), half);
+        __m256 y1 = _mm256_mul_ps(_mm256_add_ps(d0, d1), half);
+        __m256 y2 = _mm256_mul_ps(_mm256_sub_ps(s0, s1), half);
+        __m256 y3 = _mm256_mul_ps(_mm256_sub_ps(d0, d1), half);
+        if (!inverse) {
+            _mm256_storeu_ps(ll + j, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(y0), 0xD8)));
+        }
+        _mm256_storeu_ps(r0 + 2 * j, _mm256_unpacklo_ps(y0, y1));
+        _mm256_storeu_ps(r0 + 2 * j + 8, _mm256_unpackhi_ps(y0, y1));
+        _mm256_storeu_ps(r1 + 2 * j, _mm256_unpacklo_ps(y2, y3));
+        _mm256_storeu_ps(r1 + 2 * j + 8, _mm256_unpackhi_ps(y2, y3));
+    }
+    for (; j < pairs; ++j) {
+        float x0 = inverse ? ll[j] : r0[2 * j], x1 = r0[2 * j + 1], x2 = r1[2 * j], x3 = r1[2 * j + 1];
+        float s0 = x0 + x1, d0 = x0 - x1, s1 = x2 + x3, d1 = x2 - x3;
+        r0[2 * j] = (s0 + s1) * 0.5f;
+        r0[2 * j + 1] = (d0 + d1) * 0.5f;
+        r1[2 * j] = (s0 - s1) * 0.5f;
+        r1[2 * j + 1] = (d0 - d1) * 0.5f;
+        if (!inverse) {
+            ll[j] = r0[2 * j];
+        }
+    }
+}
+
+// һ2^LСTILEеķֿ顣0ȣϸϵԭڸ㣬kLLдk㻺壨(2^L>>k)С(TILE>>k)У
+// һֻʣһLL
+class HaarTile {
+public:
+    static const int TILE = 256;
+    static const int MAX_LEVEL = 5;
+
+    explicit HaarTile(int levels) : levels(levels) {
+        if (levels < 1 || levels > MAX_LEVEL) {
+            throw std::invalid_argument("Haar任15֮");
+        }
+        size_t total = 0;
+        for (int k = 0; k <= levels; ++k) {
+            total += (size_t)(blockSize() >> k) * (TILE >> k);
+        }
+        storage.assign(total, 0.0f);
+        float* p = storage.data();
+        for (int k = 0; k <= levels; ++k) {
+            buf[k] = p;
+            p += (size_t)(blockSize() >> k) * (TILE >> k);
+        }
+    }
+
+    int blockSize() const {
+        return 1 << levels;
+    }
+
+    float* row(int r) {
+        return buf[0] + (size_t)r * TILE;
+    }
+
+    // һLLwidth / 2^L
+    float* ll() {
+        return buf[levels];
+    }
+
+    // ǰwidthУ2^LıTILEL任
+    void forward(int width) {
+        for (int k = 1; k <= levels; ++k) {
+            step(k, width, false);
+        }
+    }
+
+    void inverse(int width) {
+        for (int k = levels; k >= 1; --k) {
+            step(k, width, true);
+        }
+    }
+
+private:
+    int levels;
+    std::vector<float> storage;
+    float* buf[MAX_LEVEL + 1];
+
+    void step(int k, int width, bool inverse) {
+        int rows = blockSize() >> (k - 1);
+        int pairs = width >> k;
+        int stride = TILE >> (k - 1);
+        for (int i = 0; i < rows / 2; ++i) {
+            haarRowPair(buf[k - 1] + (size_t)(2 * i) * stride, buf[k - 1] + (size_t)(2 * i + 1) * stride,
+                buf[k] + (size_t)i * (stride / 2), pairs, inverse);
+        }
+    }
+};
+
+void checkColor(const Image& img) {
+    if (img.channels != 3 || img.width <= 0 || img.height <= 0 ||
+        img.pixels.size() != (size_t)img.width * img.height * 3) {
+        throw std::invalid_argument("ҪBGRͨͼ");
+    }
+}
+
+inline uint8_t* pixelAt(Image& img, int x, int y) {
+    return &img.pixels[((size_t)y * img.width + x) * 3];
+}
+
+inline const uint8_t* pixelAt(const Image& img, int x, int y) {
+    return &img.pixels[((size_t)y * img.width + x) * 3];
+}
+
+// YͨLLL(Hr/2^L)(Wr/2^L)
+std::vector<float> lumaLL(const Image& img, int levels) {
+    HaarTile tile(levels);
+    const int S = tile.blockSize();
+    const int Hr = img.height - img.height % S, Wr = img.width - img.width % S;
+    std::vector<float> out((size_t)(Hr / S) * (Wr / S));
+    for (int y0 = 0; y0 < Hr; y0 += S) {
+        for (int x0 = 0; x0 < Wr; x0 += HaarTile::TILE) {
+            int width = std::min(HaarTile::TILE, Wr - x0);
+            for (int r = 0; r < S; ++r) {
+                bgrToLuma(pixelAt(img, x0, y0 + r), tile.row(r), width);
+            }
+            tile.forward(width);
+            std::memcpy(&out[(size_t)(y0 / S) * (Wr / S) + x0 / S], tile.ll(), (width / S) * sizeof(float));
+        }
+    }
+    return out;
+}
+
+// ĬǶǿȡPython汾ȡ0.1ʱȱ仯0.1Ҷȼȡ8λˮӡ
+// 8ʱPSNRԼ39dBȡˮӡԭˮӡϵԼ0.99
+const float DEFAULT_ALPHA = 8.0f;
+
+// ˮӡǶ롣PythonͬˮӡŵС255LHaarֽLL' = LL + LL_ˮӡ
+// ߲2^LʱҲ·һرֲ䣨pywtⲿԳأ
+class HaarWatermarker {
+public:
+    HaarWatermarker(const Image& watermark, float alpha = DEFAULT_ALPHA, int level = 1) : alpha(alpha), levels(level) {
+        if (watermark.width <= 0 || watermark.height <= 0 ||
+            (watermark.channels != 1 && watermark.channels != 3) ||
+            watermark.pixels.size() != (size_t)watermark.width * watermark.height * watermark.channels) {
+            throw std::invalid_argument("ˮӡͼЧ");
+        }
+        if (alpha == 0.0f) {
+            throw std::invalid_argument("ǶǿȲΪ0");
+        }
+        HaarTile check(level);
+        (void)check;
+        mark.width = watermark.width;
+        mark.height = watermark.height;
+        mark.channels = 1;
+        if (watermark.channels == 1) {
+            mark.pixels = watermark.pixels;
+        }
+        else {
+            mark.pixels.resize((size_t)mark.width * mark.height);
+            for (size_t i = 0; i < mark.pixels.size(); ++i) {
+                mark.pixels[i] = (uint8_t)lumaOf(&watermark.pixels[3 * i]);
+            }
+        }
+    }
+
+    int level() const {
+        return levels;
+    }
+
+    // ԭظBGRͼˮӡɱ߳ͬʱ
+    void embed(Image& img) const {
+        checkColor(img);
+        HaarTile tile(levels);
+        const int S = tile.blockSize();
+        const int Hr = img.height - img.height % S, Wr = img.width - img.width % S;
+        if (Hr == 0 || Wr == 0) {
+            return;
+        }
+        std::shared_ptr<const std::vector<float>> markLL = watermarkLL(img.width, img.height);
+        const size_t llStride = Wr / S;
+        std::vector<float> orig((size_t)S * HaarTile::TILE);
+        for (int y0 = 0; y0 < Hr; y0 += S) {
+            const float* markRow = markLL->data() + (size_t)(y0 / S) * llStride;
+            for (int x0 = 0; x0 < Wr; x0 += HaarTile::TILE) {
+                int width = std::min(HaarTile::TILE, Wr - x0);
+                for (int r = 0; r < S; ++r) {
+                    bgrToLuma(pixelAt(img, x0, y0 + r), tile.row(r), width);
+                    std::memcpy(&orig[(size_t)r * HaarTile::TILE], tile.row(r), width * sizeof(float));
+                }
+                tile.forward(width);
+                float* ll = tile.ll();
+                for (int j = 0; j < width / S; ++j) {
+                    ll[j] += alpha * markRow[x0 / S + j];
+                }
+                tile.inverse(width);
+                for (int r = 0; r < S; ++r) {
+                    applyLumaDelta(pixelAt(img, x0, y0 + r), tile.row(r), &orig[(size_t)r * HaarTile::TILE], width);
+                }
+            }
+        }
+    }
+
+private:
+    Image mark;
+    float alpha;
+    int levels;
+    mutable std::mutex cacheMutex;
+    mutable std::map<std::pair<int, int>, std::shared_ptr<const std::vector<float>>> cache;
+
+    // ˮӡ˫ţcv2.resizeINTER_LINEARͬĶ룩С255LLϵ
+    // ͬһߴͼһݣʱֻһ
+    std::shared_ptr<const std::vector<float>> watermarkLL(int width, int height) const {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find({ width, height });
+        if (it != cache.end()) {
+            return it->second;
+        }
+        const int S = 1 << levels;
+        const int Hr = height - height % S, Wr = width - width % S;
+        auto sample = [&](int x, float fx, int& x0, int& x1, float& w) {
+            float s = ((float)x + 0.5f) * fx - 0.5f;
+            s = std::max(s, 0.0f);
+            x0 = std::min((int)s, mark.width - 1);
+            x1 = std::min(x0 + 1, mark.width - 1);
+            w = s - (float)x0;
+        };
+        std::vector<int> cx0(Wr), cx1(Wr);
+        std::vector<float> cw(Wr);
+        for (int x = 0; x < Wr; ++x) {
+            sample(x, (float)mark.width / width, cx0[x], cx1[x], cw[x]);
+        }
+        auto ll = std::make_shared<std::vector<float>>((size_t)(Hr / S) * (Wr / S), 0.0f);
+        const float norm = 1.0f / (255.0f * (float)S);
+        for (int y = 0; y < Hr; ++y) {
+            float s = std::max(((float)y + 0.5f) * mark.height / height - 0.5f, 0.0f);
+            int y0 = std::min((int)s, mark.height - 1), y1 = std::min(y0 + 1, mark.height - 1);
+            float wy = s - (float)y0;
+            const uint8_t* row0 = &mark.pixels[(size_t)y0 * mark.width];
+            const uint8_t* row1 = &mark.pixels[(size_t)y1 * mark.width];
+            float* out = ll->data() + (size_t)(y / S) * (Wr / S);
+            for (int x = 0; x < Wr; ++x) {
+                float top = row0[cx0[x]] + (row0[cx1[x]] - row0[cx0[x]]) * cw[x];
+                float bottom = row1[cx0[x]] + (row1[cx1[x]] - row1[cx0[x]]) * cw[x];
+                out[x / S] += (top + (bottom - top) * wy) * norm;
+            }
+        }
+        cache[{ width, height }] = ll;
+        return ll;
+    }
+};
+
+// ȡˮӡ(LL_ˮӡ - LL_ԭͼ) / ֻLL任ÿΪLL/2^L쵽0~255
+// صĻҶͼΪ߽ص2^LĴС
+Image extractWatermark(const Image& watermarked, const Image& original, float alpha, int levels) {
+    checkColor(watermarked);
+    checkColor(original);
+    if (alpha == 0.0f) {
+        throw std::invalid_argument("ǶǿȲΪ0");
+    }
+    if (watermarked.width != original.width || watermarked.height != original.height) {
+        throw std::invalid_argument("ˮӡͼԭͼСͬ");
+    }
+    const int S = 1 << levels;
+    const int Hr = watermarked.height - watermarked.height % S, Wr = watermarked.width - watermarked.width % S;
+    std::vector<float> marked = lumaLL(watermarked, levels), plain = lumaLL(original, levels);
+    float lo = 0.0f, hi = 0.0f;
+    for (size_t i = 0; i < marked.size(); ++i) {
+        marked[i] = (marked[i] - plain[i]) / alpha / (float)S;
+        lo = i == 0 ? marked[i] : std::min(lo, marked[i]);
+        hi = i == 0 ? marked[i] : std::max(hi, marked[i]);
+    }
+    Image out;
+    out.width = Wr;
+    out.height = Hr;
+    out.channels = 1;
+    out.pixels.assign((size_t)Wr * Hr, 0);
+    const float scale = hi > lo ? 255.0f / (hi - lo) : 0.0f;
+    for (int y = 0; y < Hr; ++y) {
+        for (int x = 0; x < Wr; ++x) {
+            out.pixels[(size_t)y * Wr + x] = (uint8_t)((marked[(size_t)(y / S) * (Wr / S) + x / S] - lo) * scale);
+        }
+    }
+    return out;
+}
+
+// ̳߳أ߳ڹʱפӶȡ(, )·ͼˮӡдֱ
+// ÿ߳ļ֮临ͬһػ塣marker̳߳شڵþ
+class WatermarkBatch {
+public:
+    explicit WatermarkBatch(const HaarWatermarker& marker, unsigned threads = 0) : marker(marker) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    // ύļ߳
+    ~WatermarkBatch() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    void submit(std::string inPath, std::string outPath) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.emplace_back(std::move(inPath), std::move(outPath));
+        }
+        ready.notify_one();
+    }
+
+    // ȵΪûڴļϴwait()ɹдĸ
+    size_t wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return queue.empty() && busy == 0; });
+        size_t count = succeeded;
+        succeeded = 0;
+        return count;
+    }
+
+private:
+    const HaarWatermarker& marker;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable idle;
+    std::deque<std::pair<std::string, std::string>> queue;
+    size_t busy = 0;
+    size_t succeeded = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void work() {
+        Image img;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            ready.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            std::pair<std::string, std::string> job = std::move(queue.front());
+            queue.pop_front();
+            ++busy;
+            lock.unlock();
+            bool ok = false;
+            if (readPnm(job.first, img) && img.channels == 3) {
+                marker.embed(img);
+                ok = writePnm(job.second, img);
+            }
+            else {
+                std::cerr << "޷ȡͼ: " << job.first << std::endl;
+            }
+            lock.lock();
+            --busy;
+            succeeded += ok;
+            if (queue.empty() && busy == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+};
+
+// Ŀ¼еȫPPMͼˮӡԭļдoutDirسɹĸ
+size_t watermarkDirectory(const std::string& inDir, const std::string& outDir,
+    const HaarWatermarker& marker, unsigned threads = 0) {
+    std::vector<std::string> names;
+    DIR* dir = opendir(inDir.c_str());
+    if (dir == nullptr) {
+        return 0;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".ppm") == 0) {
+            names.push_back(name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    WatermarkBatch batch(marker, threads);
+    for (const std::string& name : names) {
+        batch.submit(inDir + "/" + name, outDir + "/" + name);
+    }
+    return batch.wait();
+}
+
+// οʵ֣Yƽ水pywtķʽֽ⣨doubleǶع˶ԷֿAVX2汾
+void embedReference(Image& img, const Image& watermark, float alpha, int level) {
+    const int S = 1 << level;
+    const int Hr = img.height - img.height % S, Wr = img.width - img.width % S;
+    std::vector<double> y((size_t)Hr * Wr), orig;
+    for (int r = 0; r < Hr; ++r) {
+        for (int c = 0; c < Wr; ++c) {
+            y[(size_t)r * Wr + c] = lumaOf(&img.pixels[((size_t)r * img.width + c) * 3]);
+        }
+    }
+    orig = y;
+    // ϸϵdetails[k]ΪHLLHHH
+    std::vector<std::vector<double>> details(level);
+    int h = Hr, w = Wr;
+    for (int k = 0; k < level; ++k) {
+        std::vector<double> ll((size_t)(h / 2) * (w / 2));
+        details[k].resize(ll.size() * 3);
+        for (int r = 0; r < h / 2; ++r) {
+            for (int c = 0; c < w / 2; ++c) {
+                double a = y[(size_t)(2 * r) * w + 2 * c], b = y[(size_t)(2 * r) * w + 2 * c + 1];
+                double cc = y[(size_t)(2 * r + 1) * w + 2 * c], d = y[(size_t)(2 * r + 1) * w + 2 * c + 1];
+                size_t i = (size_t)r * (w / 2) + c;
+                ll[i] = (a + b + cc + d) / 2;
+                details[k][3 * i] = (a - b + cc - d) / 2;
+                details[k][3 * i + 1] = (a + b - cc - d) / 2;
+                details[k][3 * i + 2] = (a - b - cc + d) / 2;
+            }
+        }
+        y.swap(ll);
+        h /= 2;
+        w /= 2;
+    }
+    // ˮӡ˫š255ֽͬ⵽L㣨LL/2^L
+    for (int r = 0; r < Hr; ++r) {
+        double sy = std::max((r + 0.5) * watermark.height / img.height - 0.5, 0.0);
+        int y0 = std::min((int)sy, watermark.height - 1), y1 = std::min(y0 + 1, watermark.height - 1);
+        for (int c = 0; c < Wr; ++c) {
+            double sx = std::max((c + 0.5) * watermark.width / img.width - 0.5, 0.0);
+            int x0 = std::min((int)sx, watermark.width - 1), x1 = std::min(x0 + 1, watermark.width - 1);
+            auto at = [&](int yy, int xx) { return (double)watermark.pixels[(size_t)yy * watermark.width + xx]; };
+            double top = at(y0, x0) + (at(y0, x1) - at(y0, x0)) * (sx - x0);
+            double bottom = at(y1, x0) + (at(y1, x1) - at(y1, x0)) * (sx - x0);
+            y[(size_t)(r / S) * w + c / S] += alpha * (top + (bottom - top) * (sy - y0)) / 255.0 / S;
+        }
+    }
+    for (int k = level - 1; k >= 0; --k) {
+        std::vector<double> up((size_t)(h * 2) * (w * 2));
+        for (int r = 0; r < h; ++r) {
+            for (int c = 0; c < w; ++c) {
+                size_t i = (size_t)r * w + c;
+                double x0 = y[i], x1 = details[k][3 * i], x2 = details[k][3 * i + 1], x3 = details[k][3 * i + 2];
+                up[(size_t)(2 * r) * (2 * w) + 2 * c] = (x0 + x1 + x2 + x3) / 2;
+                up[(size_t)(2 * r) * (2 * w) + 2 * c + 1] = (x0 - x1 + x2 - x3) / 2;
+                up[(size_t)(2 * r + 1) * (2 * w) + 2 * c] = (x0 + x1 - x2 - x3) / 2;
+                up[(size_t)(2 * r + 1) * (2 * w) + 2 * c + 1] = (x0 - x1 - x2 + x3) / 2;
+            }
+        }
+        y.swap(up);
+        h *= 2;
+        w *= 2;
+    }
+    for (int r = 0; r < Hr; ++r) {
+        for (int c = 0; c < Wr; ++c) {
+            int d = (int)std::nearbyint(std::min(std::max(y[(size_t)r * Wr + c], 0.0), 255.0)) - (int)orig[(size_t)r * Wr + c];
+            uint8_t* p = &img.pixels[((size_t)r * img.width + c) * 3];
+            for (int ch = 0; ch < 3; ++ch) {
+                p[ch] = (uint8_t)std::min(std::max(p[ch] + d, 0), 255);
+            }
+        }
+    }
+}
+
+// Pythoncreate_sample_imagesͬĽͼˮӡ÷ƴ"TEST"cv2.putText
+void createSampleImages(Image& host, Image& watermark, int width = 512, int height = 512) {
+    host.width = width;
+    host.height = height;
+    host.channels = 3;
+    host.pixels.assign((size_t)width * height * 3, 0);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t* p = &host.pixels[((size_t)y * width + x) * 3];
+            p[0] = (uint8_t)(x * 256 / width / 2);
+            p[1] = (uint8_t)((x + y) % 64);
+            p[2] = (uint8_t)(y * 256 / height / 2);
+        }
+    }
+    static const char* glyphs[4] = { "111010010010010", "111100111100111", "111100111001111", "111010010010010" };
+    watermark.width = 128;
+    watermark.height = 128;
+    watermark.channels = 1;
+    watermark.pixels.assign(128 * 128, 0);
+    for (int g = 0; g < 4; ++g) {
+        for (int i = 0; i < 15; ++i) {
+            if (glyphs[g][i] != '1') {
+                continue;
+            }
+            int gx = 8 + g * 30 + (i % 3) * 8, gy = 44 + (i / 3) * 8;
+            for (int y = gy; y < gy + 8; ++y) {
+                std::fill_n(&watermark.pixels[(size_t)y * 128 + gx], 8, 255);
+            }
+        }
+    }
+}
+
+double psnr(const Image& a, const Image& b) {
+    double err = 0;
+    for (size_t i = 0; i < a.pixels.size(); ++i) {
+        double d = (double)a.pixels[i] - b.pixels[i];
+        err += d * d;
+    }
+    err /= (double)a.pixels.size();
+    return err == 0 ? INFINITY : 10 * std::log10(255.0 * 255.0 / err);
+}
+
+void testWatermark() {
+    std::cout << "=== HaarСˮӡ ===" << std::endl;
+    std::mt19937 rng(2025);
+
+    // ֿ任任LLڿ/2^L任ԭ
+    bool ok = true;
+    for (int level = 1; level <= HaarTile::MAX_LEVEL; ++level) {
+        HaarTile tile(level);
+        const int S = tile.blockSize();
+        const int width = HaarTile::TILE - S * (level % 2);
+        std::vector<float> input((size_t)S * width);
+        for (int r = 0; r < S; ++r) {
+            for (int c = 0; c < width; ++c) {
+                input[(size_t)r * width + c] = tile.row(r)[c] = (float)(rng() % 256);
+            }
+        }
+        tile.forward(width);
+        for (int j = 0; j < width / S; ++j) {
+            double sum = 0;
+            for (int r = 0; r < S; ++r) {
+                for (int c = j * S; c < (j + 1) * S; ++c) {
+                    sum += input[(size_t)r * width + c];
+                }
+            }
+            ok &= std::fabs(tile.ll()[j] - sum / S) < 1e-2;
+        }
+        tile.inverse(width);
+        for (int r = 0; r < S; ++r) {
+            for (int c = 0; c < width; ++c) {
+                ok &= std::fabs(tile.row(r)[c] - input[(size_t)r * width + c]) < 1e-3;
+            }
+        }
+    }
+    std::cout << "ֿHaar任: " << (ok ? "ͨ" : "ʧ") << std::endl;
+
+    // doubleοʵֶԱȣ߹ⲻ2^L16ıǱβ
+    Image host, watermark;
+    createSampleImages(host, watermark, 517, 389);
+    for (int level = 1; level <= 3; ++level) {
+        HaarWatermarker marker(watermark, 8.0f, level);
+        Image fast = host, reference = host;
+        marker.embed(fast);
+        embedReference(reference, watermark, 8.0f, level);
+        size_t diff = 0;
+        int maxDiff = 0;
+        for (size_t i = 0; i < fast.pixels.size(); ++i) {
+            int d = std::abs((int)fast.pixels[i] - reference.pixels[i]);
+            diff += d != 0;
+            maxDiff = std::max(maxDiff, d);
+        }
+        std::cout << "level=" << level << " οʵֲֽͬ: " << diff << "/" << fast.pixels.size()
+            << " " << maxDiff << (maxDiff <= 1 ? " ͨ" : " ʧ") << std::endl;
+    }
+
+    // Ƕȡȡźˮӡƽϵ
+    createSampleImages(host, watermark);
+    for (float alpha : { 0.1f, DEFAULT_ALPHA }) {
+        HaarWatermarker marker(watermark, alpha, 2);
+        Image marked = host;
+        marker.embed(marked);
+        Image extracted = extractWatermark(marked, host, alpha, 2);
+        double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+        const double n = (double)extracted.pixels.size();
+        for (int y = 0; y < extracted.height; ++y) {
+            for (int x = 0; x < extracted.width; ++x) {
+                double a = extracted.pixels[(size_t)y * extracted.width + x];
+                double b = watermark.pixels[(size_t)(y / 4) * 128 + x / 4];
+                sx += a;
+                sy += b;
+                sxx += a * a;
+                syy += b * b;
+                sxy += a * b;
+            }
+        }
+        double denom = std::sqrt((sxx - sx * sx / n) * (syy - sy * sy / n));
+        double corr = denom > 0 ? (sxy - sx * sy / n) / denom : 0.0;
+        std::cout << "alpha=" << alpha << " PSNR=" << psnr(host, marked) << "dBȡˮӡϵ " << corr << std::endl;
+    }
+    std::cout << "alpha=0.1ʱȱ仯0.1Ҷȼȡ8λˮӡʵʹҪalpha" << std::endl;
+
+    // Ŀ¼ͬһ̳߳Ƕͬ
+    char inDir[] = "/tmp/watermark-in-XXXXXX";
+    char outDir[] = "/tmp/watermark-out-XXXXXX";
+    if (mkdtemp(inDir) && mkdtemp(outDir)) {
+        HaarWatermarker marker(watermark);
+        std::vector<Image> expected;
+        for (int i = 0; i < 6; ++i) {
+            Image img = host;
+            img.pixels[(size_t)i * 1000] ^= 0xFF;
+            writePnm(std::string(inDir) + "/" + std::to_string(i) + ".ppm", img);
+            marker.embed(img);
+            expected.push_back(img);
+        }
+        WatermarkBatch batch(marker, 3);
+        size_t written = 0;
+        for (int round = 0; round < 2; ++round) {
+            for (int i = round * 3; i < round * 3 + 3; ++i) {
+                batch.submit(std::string(inDir) + "/" + std::to_string(i) + ".ppm",
+                    std::string(outDir) + "/" + std::to_string(i) + ".ppm");
+            }
+            written += batch.wait();
+        }
+        bool same = written == expected.size();
+        for (size_t i = 0; i < expected.size(); ++i) {
+            Image out;
+            std::string in = std::string(inDir) + "/" + std::to_string(i) + ".ppm";
+            std::string result = std::string(outDir) + "/" + std::to_string(i) + ".ppm";
+            same = same && readPnm(result, out) && out.pixels == expected[i].pixels;
+            unlink(in.c_str());
+            unlink(result.c_str());
+        }
+        rmdir(inDir);
+        rmdir(outDir);
+        std::cout << "Ŀ¼: д " << written << " ţǶ" << (same ? "һ" : "һ") << std::endl;
+    }
+}
+
+// ʾͼԭͼˮӡͼalphaĬֵ2㣩ȡˮӡдdirУ鿴Ч
+bool writeDemoImages(const std::string& dir) {
+    Image host, watermark;
+    createSampleImages(host, watermark);
+    HaarWatermarker marker(watermark, DEFAULT_ALPHA, 2);
+    Image marked = host;
+    marker.embed(marked);
+    Image extracted = extractWatermark(marked, host, DEFAULT_ALPHA, 2);
+    return writePnm(dir + "/host_image.ppm", host) && writePnm(dir + "/watermarked_image.ppm", marked) &&
+        writePnm(dir + "/extracted_watermark.pgm", extracted);
+}
+
+void watermarkPerformanceTest(int iterations = 60) {
+    std::cout << "\n=== 1080pˮӡܲ ===" << std::endl;
+    Image host, watermark;
+    createSampleImages(host, watermark, 1920, 1080);
+    std::mt19937 rng(7);
+    for (auto& p : host.pixels) {
+        p = (uint8_t)(p + rng() % 32);
+    }
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (int level : { 1, 3 }) {
+        HaarWatermarker marker(watermark, DEFAULT_ALPHA, level);
+        Image warm = host;
+        marker.embed(warm);
+
+        std::vector<Image> batch(cores, host);
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < cores; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < iterations; ++i) {
+                    marker.embed(batch[t]);
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        double rate = cores * iterations / seconds;
+        std::cout << "level=" << level << "" << cores << "߳: " << rate << " /루ÿ "
+            << seconds * 1000 / iterations << " ms/̣߳" << rate * 1920 * 1080 * 3 / 1e9 << " GB/s" << std::endl;
+    }
+}
+
+void usage(const char* prog) {
+    std::cerr << "÷: " << prog << " embed <ˮӡ.pgm> <Ŀ¼> <Ŀ¼> [alpha] [level] [threads]" << std::endl;
+    std::cerr << "      " << prog << " extract <ˮӡ.ppm> <ԭͼ.ppm> <.pgm> [alpha] [level]" << std::endl;
+    std::cerr << "      " << prog << " demo <Ŀ¼>дʾԭͼˮӡͼȡˮӡ" << std::endl;
+    std::cerr << "alphaĬΪ" << DEFAULT_ALPHA << "ȡʱǶʱͬalphaСԼ1ʱȱ仯һҶȼ"
+        << "ȡ8λˮӡlevelĬΪ1threadsĬΪȫ" << std::endl;
+}
+
+#ifndef WATERMARK_NO_MAIN
+int main(int argc, char* argv[]) {
+    if (argc >= 2) {
+        std::string mode = argv[1];
+        try {
+            if (mode == "embed" && argc >= 5) {
+                Image watermark;
+                if (!readPnm(argv[2], watermark)) {
+                    std::cerr << "޷ȡˮӡ: " << argv[2] << std::endl;
+                    return 1;
+                }
+                HaarWatermarker marker(watermark, argc > 5 ? std::stof(argv[5]) : DEFAULT_ALPHA, argc > 6 ? std::stoi(argv[6]) : 1);
+                auto start = std::chrono::high_resolution_clock::now();
+                size_t count = watermarkDirectory(argv[3], argv[4], marker, argc > 7 ? std::stoi(argv[7]) : 0);
+                double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+                std::cout << "Ѵ " << count << " ͼ" << count / seconds << " /" << std::endl;
+                return 0;
+            }
+            if (mode == "extract" && argc >= 5) {
+                Image marked, original;
+                if (!readPnm(argv[2], marked) || !readPnm(argv[3], original)) {
+                    std::cerr << "޷ȡͼ" << std::endl;
+                    return 1;
+                }
+                Image extracted = extractWatermark(marked, original,
+                    argc > 5 ? std::stof(argv[5]) : DEFAULT_ALPHA, argc > 6 ? std::stoi(argv[6]) : 1);
+                return writePnm(argv[4], extracted) ? 0 : 1;
+            }
+            if (mode == "demo" && argc >= 3) {
+                return writeDemoImages(argv[2]) ? 0 : 1;
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        usage(argv[0]);
+        return 1;
+    }
+    testWatermark();
+    watermarkPerformanceTest();
+    return 0;
+}
+#endif
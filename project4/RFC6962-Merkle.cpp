@@ -0,0 +1,1678 @@
+#define SM3_NO_MAIN
+#include "SM3.cpp"
+
+#include <array>
+#include <stdexcept>
+
+// RFC6962 MerkleҶ SM3(0x00 || )ڲڵ SM3(0x01 ||  || )
+using Digest = std::array<unsigned char, 32>;
+
+// Сn2ݣn > 1
+inline size_t splitPoint(size_t n) {
+    size_t k = 1;
+    while (k * 2 < n) {
+        k *= 2;
+    }
+    return k;
+}
+
+// RFC6962 PATH(m, D[start, start+n))subtree(start, count)ضӦĸ
+template <class SubtreeFn>
+void rfc6962Path(size_t m, size_t start, size_t n, const SubtreeFn& subtree, std::vector<Digest>& proof) {
+    if (n <= 1) {
+        return;
+    }
+    size_t k = splitPoint(n);
+    if (m < k) {
+        rfc6962Path(m, start, k, subtree, proof);
+        proof.push_back(subtree(start + k, n - k));
+    }
+    else {
+        rfc6962Path(m - k, start + k, n - k, subtree, proof);
+        proof.push_back(subtree(start, k));
+    }
+}
+
+// RFC6962 SUBPROOF(m, D[start, start+n), complete)
+template <class SubtreeFn>
+void rfc6962Subproof(size_t m, size_t start, size_t n, bool complete, const SubtreeFn& subtree,
+    std::vector<Digest>& proof) {
+    if (m == n) {
+        if (!complete) {
+            proof.push_back(subtree(start, n));
+        }
+        return;
+    }
+    size_t k = splitPoint(n);
+    if (m <= k) {
+        rfc6962Subproof(m, start, k, complete, subtree, proof);
+        proof.push_back(subtree(start + k, n - k));
+    }
+    else {
+        rfc6962Subproof(m - k, start + k, n - k, false, subtree, proof);
+        proof.push_back(subtree(start, k));
+    }
+}
+
+// ҶӹϣλõĿѰַժҪǰ8ֽΪϣֵλ(, λ+1)һУ
+// ̽⣻ͬʱͨleafAt(λ)ȽժҪӳ䵽ļļһ־û
+class LeafIndex {
+public:
+    LeafIndex() : header(nullptr), slots(nullptr), fd(-1) {
+    }
+
+    ~LeafIndex() {
+        close();
+    }
+
+    LeafIndex(const LeafIndex&) = delete;
+    LeafIndex& operator=(const LeafIndex&) = delete;
+
+    // ļpathΪʱֻڴн
+    bool open(const std::string& indexPath) {
+        close();
+        path = indexPath;
+        if (path.empty()) {
+            return remap(-1, MIN_CAPACITY, true);
+        }
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            return false;
+        }
+        if ((size_t)st.st_size >= HEADER_SIZE) {
+            Header h;
+            if (pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) && memcmp(h.magic, INDEX_MAGIC, 8) == 0 &&
+                (size_t)st.st_size == HEADER_SIZE + h.capacity * sizeof(Slot)) {
+                return remap(fd, h.capacity, false);
+            }
+        }
+        return ftruncate(fd, 0) == 0 && remap(fd, MIN_CAPACITY, true);
+    }
+
+    void close() {
+        if (header) {
+            munmap(header, mapLength());
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        header = nullptr;
+        slots = nullptr;
+        fd = -1;
+    }
+
+    // ǵҶ¹ΪDIRTY
+    uint64_t entries() const {
+        return header ? header->entries : 0;
+    }
+
+    void setEntries(uint64_t n) {
+        header->entries = n;
+    }
+
+    // ԤnҶӵĲλ
+    bool reset(uint64_t n) {
+        uint64_t capacity = MIN_CAPACITY;
+        while (capacity < n * 2) {
+            capacity *= 2;
+        }
+        return rebuild(capacity, false);
+    }
+
+    // ҶӣظҶӱȳֵλ
+    template <class LeafFn>
+    bool insert(const Digest& leaf, uint64_t pos, const LeafFn& leafAt) {
+        if ((header->used + 1) * 2 > header->capacity && !rebuild(header->capacity * 2, true)) {
+            return false;
+        }
+        uint64_t key = keyOf(leaf);
+        uint64_t mask = header->capacity - 1;
+        for (uint64_t i = key & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (slot.pos == 0) {
+                slot.key = key;
+                slot.pos = pos + 1;
+                ++header->used;
+                return true;
+            }
+            if (slot.key == key && leafAt(slot.pos - 1) == leaf) {
+                return true;
+            }
+        }
+    }
+
+    // Ҷλãʱ-1
+    template <class LeafFn>
+    long find(const Digest& leaf, const LeafFn& leafAt) const {
+        if (!header) {
+            return -1;
+        }
+        uint64_t key = keyOf(leaf);
+        uint64_t mask = header->capacity - 1;
+        for (uint64_t i = key & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (slot.pos == 0) {
+                return -1;
+            }
+            if (slot.key == key && leafAt(slot.pos - 1) == leaf) {
+                return (long)(slot.pos - 1);
+            }
+        }
+    }
+
+    bool sync() {
+        return fd < 0 || msync(header, mapLength(), MS_SYNC) == 0;
+    }
+
+    static constexpr uint64_t DIRTY = ~(uint64_t)0;
+
+private:
+    struct Header {
+        char magic[8];
+        uint64_t capacity; // λ2
+        uint64_t used;     // ռòλ
+        uint64_t entries;  // ѲҶظ
+    };
+
+    struct Slot {
+        uint64_t key;
+        uint64_t pos; // λ+10ʾղ
+    };
+
+    static constexpr size_t HEADER_SIZE = sizeof(Header);
+    static constexpr uint64_t MIN_CAPACITY = 1024;
+    static constexpr const char* INDEX_MAGIC = "SM3LIDX1";
+
+    std::string path;
+    Header* header;
+    Slot* slots;
+    int fd;
+
+    static uint64_t keyOf(const Digest& leaf) {
+        uint64_t key;
+        memcpy(&key, leaf.data(), 8);
+        return key;
+    }
+
+    size_t mapLength() const {
+        return HEADER_SIZE + header->capacity * sizeof(Slot);
+    }
+
+    // ӳıinitΪʱдձͷfd<0ʱʹӳ
+    bool remap(int file, uint64_t capacity, bool init) {
+        size_t length = HEADER_SIZE + capacity * sizeof(Slot);
+        if (file >= 0 && init && ftruncate(file, (off_t)length) != 0) {
+            return false;
+        }
+        void* map = file >= 0 ? mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0)
+            : mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) {
+            return false;
+        }
+        header = (Header*)map;
+        slots = (Slot*)((unsigned char*)map + HEADER_SIZE);
+        if (init) {
+            memcpy(header->magic, INDEX_MAGIC, 8);
+            header->capacity = capacity;
+            header->used = 0;
+            header->entries = 0;
+        }
+        return true;
+    }
+
+    // ļµӳ䣩нıkeepΪʱǨԭвλԭ滻
+    bool rebuild(uint64_t capacity, bool keep) {
+        Header* oldHeader = header;
+        Slot* oldSlots = slots;
+        size_t oldLength = mapLength();
+        int oldFd = fd;
+
+        int newFd = -1;
+        std::string tmp = path + ".tmp";
+        if (!path.empty()) {
+            newFd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (newFd < 0) {
+                return false;
+            }
+        }
+        if (!remap(newFd, capacity, true)) {
+            if (newFd >= 0) {
+                ::close(newFd);
+            }
+            header = oldHeader;
+            slots = oldSlots;
+            return false;
+        }
+        if (keep) {
+            uint64_t mask = capacity - 1;
+            for (uint64_t i = 0; i < oldHeader->capacity; ++i) {
+                if (oldSlots[i].pos == 0) {
+                    continue;
+                }
+                uint64_t j = oldSlots[i].key & mask;
+                while (slots[j].pos != 0) {
+                    j = (j + 1) & mask;
+                }
+                slots[j] = oldSlots[i];
+            }
+            header->used = oldHeader->used;
+            header->entries = oldHeader->entries;
+        }
+        munmap(oldHeader, oldLength);
+        if (oldFd >= 0) {
+            ::close(oldFd);
+        }
+        fd = newFd;
+        return path.empty() || (sync() && rename(tmp.c_str(), path.c_str()) == 0);
+    }
+};
+
+// ҶӴ֤indicesΪȥصҶλãnodesԵϡͬ
+// ֵ֤ܽڵ㣬Ҷ·ϹĽڵֻһ
+struct MultiProof {
+    size_t treeSize = 0;
+    std::vector<size_t> indices;
+    std::vector<Digest> nodes;
+};
+
+class MerkleTree {
+public:
+    static Digest hashLeaf(const unsigned char* data, size_t len) {
+        Digest d;
+        leafHasher().hash(data, len, d.data());
+        return d;
+    }
+
+    static Digest hashChildren(const Digest& left, const Digest& right) {
+        Digest d;
+        SM3_Optimized sm3 = nodeHasher().begin();
+        sm3.update(left.data(), 32);
+        sm3.update(right.data(), 32);
+        sm3.final(d.data());
+        return d;
+    }
+
+    // Ҷӹϣÿ8һ龭໺ں˲м㣬ҶӳȿԲͬ
+    static void hashLeaves(const unsigned char* const data[], const size_t len[], size_t count,
+        Digest* out, unsigned threads = 0) {
+        size_t groups = (count + SM3_MB::LANES - 1) / SM3_MB::LANES;
+        parallelFor(groups, threads, [&](size_t g) {
+            size_t first = g * SM3_MB::LANES;
+            if (first + SM3_MB::LANES <= count) {
+                SM3_MB::hash(leafHasher().state(), data + first, len + first, (unsigned char(*)[32])out[first].data());
+                return;
+            }
+            for (size_t i = first; i < count; ++i) {
+                out[i] = hashLeaf(data[i], len[i]);
+            }
+        });
+    }
+
+    // ŵpairs(, )ժҪÿ8һ龭໺ں˼㸸ڵ
+    static void hashPairs(const Digest* nodes, size_t pairs, Digest* out, unsigned threads = 0) {
+        size_t groups = (pairs + SM3_MB::LANES - 1) / SM3_MB::LANES;
+        parallelFor(groups, threads, [&](size_t g) {
+            size_t first = g * SM3_MB::LANES;
+            if (first + SM3_MB::LANES <= pairs) {
+                const unsigned char* msg[SM3_MB::LANES];
+                for (int l = 0; l < SM3_MB::LANES; ++l) {
+                    msg[l] = nodes[(first + l) * 2].data();
+                }
+                SM3_MB::hash(nodeHasher().state(), msg, 64, (unsigned char(*)[32])out[first].data());
+                return;
+            }
+            for (size_t i = first; i < pairs; ++i) {
+                out[i] = hashChildren(nodes[i * 2], nodes[i * 2 + 1]);
+            }
+        });
+    }
+
+    // һ㣺ժҪùڲڵϢ
+    static void hashLevel(const std::vector<Digest>& level, std::vector<Digest>& next, unsigned threads) {
+        next.resize((level.size() + 1) / 2);
+        hashPairs(level.data(), level.size() / 2, next.data(), threads);
+        if (level.size() % 2) {
+            next.back() = level.back();
+        }
+    }
+
+    // ԭʼҶݽ
+    void build(const unsigned char* const data[], const size_t len[], size_t count, unsigned threads = 0) {
+        std::vector<Digest> leaves(count);
+        hashLeaves(data, len, count, leaves.data(), threads);
+        buildFromLeafHashes(std::move(leaves), threads);
+    }
+
+    void build(const std::vector<std::string>& leafData, unsigned threads = 0) {
+        std::vector<const unsigned char*> data(leafData.size());
+        std::vector<size_t> len(leafData.size());
+        for (size_t i = 0; i < leafData.size(); ++i) {
+            data[i] = (const unsigned char*)leafData[i].data();
+            len[i] = leafData[i].size();
+        }
+        build(data.data(), len.data(), leafData.size(), threads);
+    }
+
+    // Ҷӹϣ㽨ÿһУĩڵֱ
+    void buildFromLeafHashes(std::vector<Digest> leaves, unsigned threads = 0) {
+        leafIndex.reset();
+        levels.clear();
+        levels.push_back(std::move(leaves));
+        while (levels.back().size() > 1) {
+            std::vector<Digest> next;
+            hashLevel(levels.back(), next, threads);
+            levels.push_back(std::move(next));
+        }
+    }
+
+    size_t size() const {
+        return levels.empty() ? 0 : levels[0].size();
+    }
+
+    // ĸΪSM3("")
+    Digest root() const {
+        if (size() == 0) {
+            Digest d;
+            SM3_Optimized sm3;
+            sm3.final(d.data());
+            return d;
+        }
+        return levels.back()[0];
+    }
+
+    const Digest& leafHash(size_t index) const {
+        return levels.at(0).at(index);
+    }
+
+    // ΪҶӽڴеĹϣ˺findLeafΪO(1)
+    void buildIndex() {
+        auto built = std::make_shared<LeafIndex>();
+        built->open("");
+        built->reset(size());
+        for (size_t i = 0; i < size(); ++i) {
+            built->insert(levels[0][i], i, [this](uint64_t pos) -> const Digest& {
+                return levels[0][pos];
+            });
+        }
+        built->setEntries(size());
+        leafIndex = std::move(built);
+    }
+
+    // Ҷӹϣһγֵλãʱ-1δʱ˻ΪԲ
+    long findLeaf(const Digest& leaf) const {
+        if (leafIndex) {
+            return leafIndex->find(leaf, [this](uint64_t pos) -> const Digest& {
+                return levels[0][pos];
+            });
+        }
+        if (levels.empty()) {
+            return -1;
+        }
+        auto it = std::find(levels[0].begin(), levels[0].end(), leaf);
+        return it == levels[0].end() ? -1 : (long)(it - levels[0].begin());
+    }
+
+    // ֤RFC6962 PATHԵϵֵܽڵ㣬Ƶĩڵ㲻֤
+    std::vector<Digest> inclusionProof(size_t index) const {
+        if (index >= size()) {
+            throw std::invalid_argument("Invalid leaf index");
+        }
+        std::vector<Digest> proof;
+        for (size_t h = 0; h + 1 < levels.size(); ++h, index >>= 1) {
+            size_t sibling = index ^ 1;
+            if (sibling < levels[h].size()) {
+                proof.push_back(levels[h][sibling]);
+            }
+        }
+        return proof;
+    }
+
+    // һ֤RFC6962 PROOF֤ǰfirstҶӹɵǵǰǰ׺
+    std::vector<Digest> consistencyProof(size_t first) const {
+        if (first == 0 || first > size()) {
+            throw std::invalid_argument("Invalid subtree sizes");
+        }
+        std::vector<Digest> proof;
+        rfc6962Subproof(first, 0, size(), true, [this](size_t start, size_t count) {
+            return subtreeHash(start, count);
+        }, proof);
+        return proof;
+    }
+
+    // RFC9162 2.1.3.2֤֤
+    static bool verifyInclusion(const Digest& leaf, size_t index, size_t treeSize,
+        const std::vector<Digest>& proof, const Digest& root) {
+        if (index >= treeSize) {
+            return false;
+        }
+        size_t fn = index;
+        size_t sn = treeSize - 1;
+        Digest r = leaf;
+        for (const Digest& p : proof) {
+            if (sn == 0) {
+                return false;
+            }
+            if ((fn & 1) || fn == sn) {
+                r = hashChildren(p, r);
+                while (!(fn & 1) && fn != 0) {
+                    fn >>= 1;
+                    sn >>= 1;
+                }
+            }
+            else {
+                r = hashChildren(r, p);
+            }
+            fn >>= 1;
+            sn >>= 1;
+        }
+        return sn == 0 && r == root;
+    }
+
+    // RFC9162 2.1.4.2֤һ֤
+    static bool verifyConsistency(size_t first, size_t second, const Digest& firstRoot,
+        const Digest& secondRoot, const std::vector<Digest>& proof) {
+        if (first == 0 || first > second) {
+            return false;
+        }
+        if (first == second) {
+            return proof.empty() && firstRoot == secondRoot;
+        }
+
+        // firstΪ2ʱһ֤ʡ
+        std::vector<Digest> path;
+        if ((first & (first - 1)) == 0) {
+            path.push_back(firstRoot);
+        }
+        path.insert(path.end(), proof.begin(), proof.end());
+        if (path.empty()) {
+            return false;
+        }
+
+        size_t fn = first - 1;
+        size_t sn = second - 1;
+        while (fn & 1) {
+            fn >>= 1;
+            sn >>= 1;
+        }
+        Digest fr = path[0];
+        Digest sr = path[0];
+        for (size_t i = 1; i < path.size(); ++i) {
+            if (sn == 0) {
+                return false;
+            }
+            if ((fn & 1) || fn == sn) {
+                fr = hashChildren(path[i], fr);
+                sr = hashChildren(path[i], sr);
+                while (!(fn & 1) && fn != 0) {
+                    fn >>= 1;
+                    sn >>= 1;
+                }
+            }
+            else {
+                sr = hashChildren(sr, path[i]);
+            }
+            fn >>= 1;
+            sn >>= 1;
+        }
+        return sn == 0 && fr == firstRoot && sr == secondRoot;
+    }
+
+    // ֤ϲҶӵ·ͬڵ֪ڵ㻥Ϊֵʱٲ֤
+    MultiProof multiProof(std::vector<size_t> indices) const {
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+        if (indices.empty() || indices.back() >= size()) {
+            throw std::invalid_argument("Invalid leaf index");
+        }
+        MultiProof proof;
+        proof.treeSize = size();
+        proof.indices = indices;
+        std::vector<size_t> known = std::move(indices);
+        for (size_t h = 0; h + 1 < levels.size(); ++h) {
+            std::vector<size_t> parents;
+            for (size_t j = 0; j < known.size(); ++j) {
+                size_t i = known[j];
+                if (!(i & 1) && j + 1 < known.size() && known[j + 1] == i + 1) {
+                    ++j;
+                }
+                else if ((i ^ 1) < levels[h].size()) {
+                    proof.nodes.push_back(levels[h][i ^ 1]);
+                }
+                parents.push_back(i >> 1);
+            }
+            known.swap(parents);
+        }
+        return proof;
+    }
+
+    // ֤֤leavesindicesһһӦÿҪĸڵܺһ໺ںˡ
+    // treeSizeȡǩͷindicesɵ÷֤еֵ֮ͬ
+    // ƸСڲڵ㵱Ҷ֤ͨ
+    static bool verifyMultiProof(const MultiProof& proof, const std::vector<size_t>& indices,
+        const std::vector<Digest>& leaves, size_t treeSize, const Digest& root) {
+        if (proof.treeSize != treeSize || proof.indices != indices) {
+            return false;
+        }
+        if (indices.empty() || leaves.size() != indices.size() || indices.back() >= treeSize) {
+            return false;
+        }
+        for (size_t j = 1; j < indices.size(); ++j) {
+            if (indices[j] <= indices[j - 1]) {
+                return false;
+            }
+        }
+
+        std::vector<size_t> known = indices;
+        std::vector<Digest> digests = leaves;
+        size_t levelSize = treeSize;
+        size_t used = 0;
+        std::vector<Digest> pairs;
+        std::vector<long> source; // ڵԴ>=0Ϊpairsеţ<0ΪֱƵĽڵ
+        while (levelSize > 1) {
+            pairs.clear();
+            source.clear();
+            std::vector<size_t> parents;
+            std::vector<Digest> carried;
+            for (size_t j = 0; j < known.size(); ++j) {
+                size_t i = known[j];
+                if (!(i & 1) && j + 1 < known.size() && known[j + 1] == i + 1) {
+                    pairs.push_back(digests[j]);
+                    pairs.push_back(digests[++j]);
+                }
+                else if ((i ^ 1) < levelSize) {
+                    if (used == proof.nodes.size()) {
+                        return false;
+                    }
+                    const Digest& sibling = proof.nodes[used++];
+                    pairs.push_back(i & 1 ? sibling : digests[j]);
+                    pairs.push_back(i & 1 ? digests[j] : sibling);
+                }
+                else {
+                    source.push_back(-1 - (long)carried.size());
+                    carried.push_back(digests[j]);
+                    parents.push_back(i >> 1);
+                    continue;
+                }
+                source.push_back((long)(pairs.size() / 2 - 1));
+                parents.push_back(i >> 1);
+            }
+
+            std::vector<Digest> hashed(pairs.size() / 2);
+            hashPairs(pairs.data(), hashed.size(), hashed.data(), 1);
+            digests.resize(source.size());
+            for (size_t j = 0; j < source.size(); ++j) {
+                digests[j] = source[j] >= 0 ? hashed[source[j]] : carried[-1 - source[j]];
+            }
+            known.swap(parents);
+            levelSize = (levelSize + 1) / 2;
+        }
+        return used == proof.nodes.size() && digests[0] == root;
+    }
+
+    // ֤໥Ĵ֤ҶλƽλáǰժҪֵܽڵ㶼ͬ
+    // ·ֻһΣÿĸڵһ໺ںˡ֤ͨ
+    static size_t verifyInclusionBatch(const Digest leaves[], const size_t index[], size_t count, size_t treeSize,
+        const std::vector<Digest> proofs[], const Digest& root, bool valid[]) {
+        std::vector<size_t> order(count);
+        for (size_t i = 0; i < count; ++i) {
+            order[i] = i;
+            valid[i] = index[i] < treeSize;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return index[a] < index[b];
+        });
+
+        std::vector<Digest> cur(count);
+        std::vector<size_t> pos(count), used(count, 0);
+        for (size_t i = 0; i < count; ++i) {
+            cur[i] = leaves[i];
+            pos[i] = index[i];
+        }
+        std::vector<Digest> pairs, hashed;
+        std::vector<size_t> slot(count);
+        for (size_t levelSize = treeSize; levelSize > 1; levelSize = (levelSize + 1) / 2) {
+            pairs.clear();
+            size_t prev = SIZE_MAX;
+            for (size_t i : order) {
+                if (!valid[i]) {
+                    continue;
+                }
+                if ((pos[i] ^ 1) >= levelSize) {
+                    slot[i] = SIZE_MAX;
+                    pos[i] >>= 1;
+                    continue;
+                }
+                if (used[i] == proofs[i].size()) {
+                    valid[i] = false;
+                    continue;
+                }
+                const Digest& sibling = proofs[i][used[i]++];
+                const Digest& left = pos[i] & 1 ? sibling : cur[i];
+                const Digest& right = pos[i] & 1 ? cur[i] : sibling;
+                if (prev == SIZE_MAX || pairs[prev * 2] != left || pairs[prev * 2 + 1] != right) {
+                    prev = pairs.size() / 2;
+                    pairs.push_back(left);
+                    pairs.push_back(right);
+                }
+                slot[i] = prev;
+                pos[i] >>= 1;
+            }
+            hashed.resize(pairs.size() / 2);
+            hashPairs(pairs.data(), hashed.size(), hashed.data(), 1);
+            for (size_t i = 0; i < count; ++i) {
+                if (valid[i] && slot[i] != SIZE_MAX) {
+                    cur[i] = hashed[slot[i]];
+                }
+            }
+        }
+
+        size_t passed = 0;
+        for (size_t i = 0; i < count; ++i) {
+            valid[i] = valid[i] && used[i] == proofs[i].size() && cur[i] == root;
+            passed += valid[i];
+        }
+        return passed;
+    }
+
+    // һ֤СԵǰ֤
+    std::vector<std::vector<Digest>> consistencyProofs(const std::vector<size_t>& firsts, unsigned threads = 0) const {
+        for (size_t first : firsts) {
+            if (first == 0 || first > size()) {
+                throw std::invalid_argument("Invalid subtree sizes");
+            }
+        }
+        std::vector<std::vector<Digest>> proofs(firsts.size());
+        parallelFor(firsts.size(), threads, [&](size_t i) {
+            proofs[i] = consistencyProof(firsts[i]);
+        });
+        return proofs;
+    }
+
+    // ֤һ֤֤ͨ
+    static size_t verifyConsistencyBatch(const size_t first[], const Digest firstRoot[], size_t count, size_t second,
+        const Digest& secondRoot, const std::vector<Digest> proofs[], bool valid[], unsigned threads = 0) {
+        std::atomic<size_t> passed(0);
+        parallelFor(count, threads, [&](size_t i) {
+            valid[i] = verifyConsistency(first[i], second, firstRoot[i], secondRoot, proofs[i]);
+            passed += valid[i];
+        });
+        return passed;
+    }
+
+private:
+    std::vector<std::vector<Digest>> levels;
+    std::shared_ptr<const LeafIndex> leafIndex;
+
+    // 0x00/0x01ǰ׺м״ֻ̬һ
+    static const SM3_Prefixed& leafHasher() {
+        static const unsigned char prefix = 0x00;
+        static const SM3_Prefixed hasher(&prefix, 1);
+        return hasher;
+    }
+
+    static const SM3_Prefixed& nodeHasher() {
+        static const unsigned char prefix = 0x01;
+        static const SM3_Prefixed hasher(&prefix, 1);
+        return hasher;
+    }
+
+    // D[start, start+count)ĸstart߶ȶ룬ĻλұԵ
+    const Digest& subtreeHash(size_t start, size_t count) const {
+        size_t h = 0;
+        while (((size_t)1 << h) < count) {
+            ++h;
+        }
+        return levels[h][start >> h];
+    }
+
+};
+
+// ֤ĿҶӹϣеǰ/̣Լڵ֤
+struct NonMembershipProof {
+    std::vector<Digest> neighbors;
+    MultiProof proof;
+};
+
+// Ҷӱ壺ҶӰҶӹϣвȥأҶ֮䲻Ҷӣ
+// ֤ǰͺ̵ĴԼ֤Ŀ겻
+class SortedMerkleTree {
+public:
+    void build(const std::vector<std::string>& leafData, unsigned threads = 0) {
+        std::vector<const unsigned char*> data(leafData.size());
+        std::vector<size_t> len(leafData.size());
+        for (size_t i = 0; i < leafData.size(); ++i) {
+            data[i] = (const unsigned char*)leafData[i].data();
+            len[i] = leafData[i].size();
+        }
+        std::vector<Digest> leaves(leafData.size());
+        MerkleTree::hashLeaves(data.data(), len.data(), leaves.size(), leaves.data(), threads);
+        std::sort(leaves.begin(), leaves.end());
+        leaves.erase(std::unique(leaves.begin(), leaves.end()), leaves.end());
+        tree.buildFromLeafHashes(std::move(leaves), threads);
+    }
+
+    size_t size() const {
+        return tree.size();
+    }
+
+    Digest root() const {
+        return tree.root();
+    }
+
+    const MerkleTree& merkleTree() const {
+        return tree;
+    }
+
+    // ֲҶλãʱ-1
+    long find(const unsigned char* data, size_t len) const {
+        size_t pos = lowerBound(MerkleTree::hashLeaf(data, len));
+        return pos < size() && tree.leafHash(pos) == MerkleTree::hashLeaf(data, len) ? (long)pos : -1;
+    }
+
+    NonMembershipProof nonMembershipProof(const unsigned char* data, size_t len) const {
+        if (size() == 0) {
+            throw std::invalid_argument("Empty tree");
+        }
+        Digest target = MerkleTree::hashLeaf(data, len);
+        size_t pos = lowerBound(target);
+        if (pos < size() && tree.leafHash(pos) == target) {
+            throw std::invalid_argument("Leaf is a member");
+        }
+        std::vector<size_t> indices;
+        if (pos > 0) {
+            indices.push_back(pos - 1);
+        }
+        if (pos < size()) {
+            indices.push_back(pos);
+        }
+        NonMembershipProof proof;
+        for (size_t i : indices) {
+            proof.neighbors.push_back(tree.leafHash(i));
+        }
+        proof.proof = tree.multiProof(indices);
+        return proof;
+    }
+
+    // ֤ھڣλˣĿϣϸ֮䣻
+    // treeSizeȡrootһǩͷ֤ܲƵĴС
+    static bool verifyNonMembership(const unsigned char* data, size_t len, const NonMembershipProof& proof,
+        size_t treeSize, const Digest& root) {
+        const std::vector<size_t>& indices = proof.proof.indices;
+        size_t n = treeSize;
+        Digest target = MerkleTree::hashLeaf(data, len);
+        if (indices.size() != proof.neighbors.size()) {
+            return false;
+        }
+        if (indices.size() == 2) {
+            if (indices[1] != indices[0] + 1 || !(proof.neighbors[0] < target) || !(target < proof.neighbors[1])) {
+                return false;
+            }
+        }
+        else if (indices.size() == 1) {
+            bool first = indices[0] == 0 && target < proof.neighbors[0];
+            bool last = indices[0] + 1 == n && proof.neighbors[0] < target;
+            if (!first && !last) {
+                return false;
+            }
+        }
+        else {
+            return false;
+        }
+        return MerkleTree::verifyMultiProof(proof.proof, indices, proof.neighbors, treeSize, root);
+    }
+
+private:
+    MerkleTree tree;
+
+    size_t lowerBound(const Digest& target) const {
+        size_t lo = 0, hi = size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (tree.leafHash(mid) < target) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+};
+
+// ͷRFC6962 3.5TreeHeadSignatureǩǩֵ
+struct TreeHead {
+    uint64_t timestamp;
+    uint64_t treeSize;
+    Digest rootHash;
+    std::vector<unsigned char> signature;
+
+    // 汾(1) || ǩtree_hash(1) || ʱ(8) || С(8) || ϣ(32)
+    std::vector<unsigned char> signedData() const {
+        std::vector<unsigned char> out;
+        out.push_back(0); // v1
+        out.push_back(1); // tree_hash
+        for (int i = 7; i >= 0; --i) {
+            out.push_back((timestamp >> (i * 8)) & 0xFF);
+        }
+        for (int i = 7; i >= 0; --i) {
+            out.push_back((treeSize >> (i * 8)) & 0xFF);
+        }
+        out.insert(out.end(), rootHash.begin(), rootHash.end());
+        return out;
+    }
+};
+
+// ֻ׷ӵMerkle־ֻɵı߽磨frontier
+// hĸڵҽСĵhλΪ1׷һҶϲlog(n)
+class MerkleLog {
+public:
+    using Signer = std::function<std::vector<unsigned char>(const unsigned char*, size_t)>;
+
+    MerkleLog() : treeSize(0) {
+    }
+
+    size_t size() const {
+        return treeSize;
+    }
+
+    void append(const unsigned char* data, size_t len) {
+        appendLeafHash(MerkleTree::hashLeaf(data, len));
+    }
+
+    // ƶƼһλ1½ڵϲ
+    void appendLeafHash(const Digest& leaf) {
+        Digest node = leaf;
+        int h = 0;
+        while ((treeSize >> h) & 1) {
+            node = MerkleTree::hashChildren(frontier[h], node);
+            ++h;
+        }
+        frontier[h] = node;
+        ++treeSize;
+    }
+
+    // ׷ӣҶӲйϣ߽ϲÿɶԵĽڵһ𾭶໺ں˼
+    void appendBatch(const unsigned char* const data[], const size_t len[], size_t count, unsigned threads = 0) {
+        std::vector<Digest> level(count);
+        MerkleTree::hashLeaves(data, len, count, level.data(), threads);
+        appendLeafHashes(std::move(level), threads);
+    }
+
+    void appendLeafHashes(std::vector<Digest> level, unsigned threads = 0) {
+        size_t newSize = treeSize + level.size();
+        size_t start = treeSize; // ǰһ½ڵλ
+        for (int h = 0; !level.empty(); ++h, start >>= 1) {
+            // ͬڵʱ
+            if (start & 1) {
+                level.insert(level.begin(), frontier[h]);
+                --start;
+            }
+            // ĩβ䵥ĽڵΪµı߽ڵ
+            if (level.size() % 2) {
+                frontier[h] = level.back();
+                level.pop_back();
+            }
+            std::vector<Digest> next;
+            MerkleTree::hashLevel(level, next, threads);
+            level.swap(next);
+        }
+        treeSize = newSize;
+    }
+
+    // Ͳı߽ڵ㿪ʼ۵O(log n)ѹؽ
+    Digest root() const {
+        if (treeSize == 0) {
+            Digest d;
+            SM3_Optimized sm3;
+            sm3.final(d.data());
+            return d;
+        }
+        int h = 0;
+        while (!((treeSize >> h) & 1)) {
+            ++h;
+        }
+        Digest r = frontier[h];
+        for (++h; h < 64; ++h) {
+            if ((treeSize >> h) & 1) {
+                r = MerkleTree::hashChildren(frontier[h], r);
+            }
+        }
+        return r;
+    }
+
+    // ڵǰСǩͷǩ㷨ɵ÷ṩ
+    TreeHead signTreeHead(uint64_t timestamp, const Signer& signer) const {
+        TreeHead head;
+        head.timestamp = timestamp;
+        head.treeSize = treeSize;
+        head.rootHash = root();
+        std::vector<unsigned char> tbs = head.signedData();
+        head.signature = signer(tbs.data(), tbs.size());
+        return head;
+    }
+
+private:
+    uint64_t treeSize;
+    Digest frontier[64];
+};
+
+// ־ûMerklehڵ˳ level_<h>.dat Уÿ32ֽڣ
+// ļopen()/commit()ʱmmapֻ֤O(log n)ڵڵҳ
+// constԱֻӳ䣬ɶ̲߳ãappend/commit/open
+// Сϣ¼ tree.size Уͨдʱļ + fsync + renameԭύ
+// Ҷ leaf.idx ύʱ£ύ¼һ£ʱɵ0ؽ
+class MerkleStore {
+public:
+    MerkleStore() : treeSize(0), committed(0) {
+    }
+
+    ~MerkleStore() {
+        close();
+    }
+
+    MerkleStore(const MerkleStore&) = delete;
+    MerkleStore& operator=(const MerkleStore&) = delete;
+
+    // 򿪣½洢Ŀ¼ȡύĴСصδύβָ߽ڵ
+    bool open(const std::string& path) {
+        close();
+        dir = path;
+        mkdir(dir.c_str(), 0755);
+
+        committed = 0;
+        Digest committedRoot;
+        int fd = ::open((dir + "/tree.size").c_str(), O_RDONLY);
+        if (fd >= 0) {
+            unsigned char record[COMMIT_RECORD_SIZE];
+            bool ok = read(fd, record, sizeof(record)) == (ssize_t)sizeof(record) &&
+                memcmp(record, COMMIT_MAGIC, 8) == 0;
+            ::close(fd);
+            if (!ok) {
+                return false;
+            }
+            for (int i = 0; i < 8; ++i) {
+                committed = (committed << 8) | record[8 + i];
+            }
+            memcpy(committedRoot.data(), record + 16, 32);
+        }
+
+        for (int h = 0; h < MAX_LEVELS && (committed >> h) > 0; ++h) {
+            if (!openLevel(h) || ftruncate(levels[h].fd, (off_t)((committed >> h) * 32)) != 0) {
+                return false;
+            }
+            levels[h].flushed = committed >> h;
+            if (!mapLevel(h)) {
+                return false;
+            }
+        }
+        if (!leafIndex.open(dir + "/leaf.idx")) {
+            return false;
+        }
+        if (leafIndex.entries() != committed && !rebuildIndex()) {
+            return false;
+        }
+
+        treeSize = committed;
+        for (int h = 0; h < MAX_LEVELS; ++h) {
+            if ((treeSize >> h) & 1) {
+                frontier[h] = node(h, (treeSize >> h) - 1);
+            }
+        }
+        return committed == 0 || root(committed) == committedRoot;
+    }
+
+    // رʱδύ׷
+    void close() {
+        for (int h = 0; h < MAX_LEVELS; ++h) {
+            Level& level = levels[h];
+            if (level.map) {
+                munmap(level.map, level.mapLen);
+            }
+            if (level.fd >= 0) {
+                ::close(level.fd);
+            }
+            level = Level();
+        }
+        leafIndex.close();
+        treeSize = committed = 0;
+    }
+
+    uint64_t size() const {
+        return treeSize;
+    }
+
+    uint64_t committedSize() const {
+        return committed;
+    }
+
+    void append(const unsigned char* data, size_t len) {
+        appendLeafHashes(std::vector<Digest>(1, MerkleTree::hashLeaf(data, len)));
+    }
+
+    void appendBatch(const unsigned char* const data[], const size_t len[], size_t count, unsigned threads = 0) {
+        std::vector<Digest> leaves(count);
+        MerkleTree::hashLeaves(data, len, count, leaves.data(), threads);
+        appendLeafHashes(std::move(leaves), threads);
+    }
+
+    // MerkleLogͬϲÿ²ڵ˳дòĴд
+    void appendLeafHashes(std::vector<Digest> level, unsigned threads = 0) {
+        uint64_t newSize = treeSize + level.size();
+        uint64_t start = treeSize;
+        for (int h = 0; !level.empty(); ++h, start >>= 1) {
+            // ڵ㶼levelУ˳ļĩβ
+            std::vector<unsigned char>& pending = levels[h].pending;
+            for (const Digest& d : level) {
+                pending.insert(pending.end(), d.begin(), d.end());
+            }
+            if (start & 1) {
+                level.insert(level.begin(), frontier[h]);
+                --start;
+            }
+            if (level.size() % 2) {
+                frontier[h] = level.back();
+                level.pop_back();
+            }
+            std::vector<Digest> next;
+            MerkleTree::hashLevel(level, next, threads);
+            level.swap(next);
+        }
+        treeSize = newSize;
+    }
+
+    // ύд벢ͬݣԭ滻С¼
+    bool commit() {
+        for (int h = 0; h < MAX_LEVELS; ++h) {
+            Level& level = levels[h];
+            if (level.pending.empty()) {
+                continue;
+            }
+            if (!openLevel(h)) {
+                return false;
+            }
+            size_t written = 0;
+            while (written < level.pending.size()) {
+                ssize_t n = pwrite(level.fd, level.pending.data() + written, level.pending.size() - written,
+                    (off_t)(level.flushed * 32 + written));
+                if (n <= 0) {
+                    return false;
+                }
+                written += (size_t)n;
+            }
+            if (fdatasync(level.fd) != 0) {
+                return false;
+            }
+            level.flushed += level.pending.size() / 32;
+            level.pending.clear();
+            if (!mapLevel(h)) {
+                return false;
+            }
+        }
+
+        // ڼΪDIRTY´ʱؽ
+        leafIndex.setEntries(LeafIndex::DIRTY);
+        for (uint64_t i = committed; i < treeSize; ++i) {
+            if (!leafIndex.insert(node(0, i), i, leafAt())) {
+                return false;
+            }
+        }
+        leafIndex.setEntries(treeSize);
+        if (!leafIndex.sync()) {
+            return false;
+        }
+
+        unsigned char record[COMMIT_RECORD_SIZE];
+        memcpy(record, COMMIT_MAGIC, 8);
+        for (int i = 0; i < 8; ++i) {
+            record[8 + i] = (treeSize >> ((7 - i) * 8)) & 0xFF;
+        }
+        // ύ¼renameͬĿ¼֮Ÿcommitted;ʧʱڴ״̬һ£´ύ
+        Digest r = treeSize == 0 ? root(0) : subtreeHash(0, treeSize);
+        memcpy(record + 16, r.data(), 32);
+
+        std::string tmp = dir + "/tree.size.tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = write(fd, record, sizeof(record)) == (ssize_t)sizeof(record) && fsync(fd) == 0;
+        ::close(fd);
+        if (!ok || rename(tmp.c_str(), (dir + "/tree.size").c_str()) != 0) {
+            return false;
+        }
+        int dirFd = ::open(dir.c_str(), O_RDONLY);
+        if (dirFd < 0) {
+            return false;
+        }
+        ok = fsync(dirFd) == 0;
+        ::close(dirFd);
+        if (!ok) {
+            return false;
+        }
+        committed = treeSize;
+        return true;
+    }
+
+    // ύΧС
+    Digest root(uint64_t size) const {
+        if (size > committed) {
+            throw std::invalid_argument("Tree size not committed");
+        }
+        if (size == 0) {
+            Digest d;
+            SM3_Optimized sm3;
+            sm3.final(d.data());
+            return d;
+        }
+        return subtreeHash(0, size);
+    }
+
+    std::vector<Digest> inclusionProof(uint64_t index, uint64_t size) const {
+        if (size > committed || index >= size) {
+            throw std::invalid_argument("Invalid leaf index");
+        }
+        std::vector<Digest> proof;
+        rfc6962Path(index, 0, size, [this](size_t start, size_t count) {
+            return subtreeHash(start, count);
+        }, proof);
+        return proof;
+    }
+
+    std::vector<Digest> consistencyProof(uint64_t first, uint64_t second) const {
+        if (first == 0 || first > second || second > committed) {
+            throw std::invalid_argument("Invalid subtree sizes");
+        }
+        std::vector<Digest> proof;
+        rfc6962Subproof(first, 0, second, true, [this](size_t start, size_t count) {
+            return subtreeHash(start, count);
+        }, proof);
+        return proof;
+    }
+
+    Digest leafHash(uint64_t index) const {
+        if (index >= committed) {
+            throw std::invalid_argument("Invalid leaf index");
+        }
+        return node(0, index);
+    }
+
+    // ύҶиҶӹϣһγֵλãʱ-1
+    long findLeaf(const Digest& leaf) const {
+        return leafIndex.find(leaf, leafAt());
+    }
+
+    long find(const unsigned char* data, size_t len) const {
+        return findLeaf(MerkleTree::hashLeaf(data, len));
+    }
+
+private:
+    static constexpr int MAX_LEVELS = 64;
+    static constexpr size_t COMMIT_RECORD_SIZE = 8 + 8 + 32;
+    static constexpr const char* COMMIT_MAGIC = "SM3MTv1\0";
+
+    struct Level {
+        int fd = -1;
+        unsigned char* map = nullptr;
+        size_t mapLen = 0;
+        uint64_t flushed = 0;               // дļĽڵ
+        std::vector<unsigned char> pending; // δύĽڵ
+    };
+
+    std::string dir;
+    uint64_t treeSize;
+    uint64_t committed;
+    Digest frontier[MAX_LEVELS];
+    Level levels[MAX_LEVELS];
+    LeafIndex leafIndex;
+
+    std::function<const Digest&(uint64_t)> leafAt() const {
+        return [this](uint64_t pos) -> const Digest& {
+            return node(0, pos);
+        };
+    }
+
+    bool rebuildIndex() {
+        if (!leafIndex.reset(committed)) {
+            return false;
+        }
+        for (uint64_t i = 0; i < committed; ++i) {
+            if (!leafIndex.insert(node(0, i), i, leafAt())) {
+                return false;
+            }
+        }
+        leafIndex.setEntries(committed);
+        return leafIndex.sync();
+    }
+
+    bool openLevel(int h) {
+        if (levels[h].fd >= 0) {
+            return true;
+        }
+        std::string path = dir + "/level_" + std::to_string(h) + ".dat";
+        levels[h].fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        return levels[h].fd >= 0;
+    }
+
+    // ӳhдļȫڵ㣻ֻд뷽open/commit
+    bool mapLevel(int h) {
+        Level& level = levels[h];
+        size_t length = (size_t)(level.flushed * 32);
+        if (length == level.mapLen) {
+            return true;
+        }
+        if (level.map) {
+            munmap(level.map, level.mapLen);
+            level.map = nullptr;
+            level.mapLen = 0;
+        }
+        if (length == 0) {
+            return true;
+        }
+        void* map = mmap(nullptr, length, PROT_READ, MAP_SHARED, level.fd, 0);
+        if (map == MAP_FAILED) {
+            return false;
+        }
+        level.map = (unsigned char*)map;
+        level.mapLen = length;
+        return true;
+    }
+
+    // ȡhiڵ㣬޸ӳ
+    const Digest& node(int h, uint64_t i) const {
+        const Level& level = levels[h];
+        if ((i + 1) * 32 > level.mapLen) {
+            throw std::runtime_error("node is not written to the level file");
+        }
+        return *(const Digest*)(level.map + i * 32);
+    }
+
+    // D[start, start+count)ĸֱӶȡұԵĲ۵
+    Digest subtreeHash(uint64_t start, uint64_t count) const {
+        std::vector<Digest> pieces;
+        while (count > 0) {
+            int h = 63 - __builtin_clzll(count);
+            pieces.push_back(node(h, start >> h));
+            start += (uint64_t)1 << h;
+            count -= (uint64_t)1 << h;
+        }
+        Digest r = pieces.back();
+        for (size_t i = pieces.size() - 1; i-- > 0;) {
+            r = MerkleTree::hashChildren(pieces[i], r);
+        }
+        return r;
+    }
+};
+
+// ӡժҪ
+void printDigest(const char* label, const Digest& d) {
+    std::cout << label;
+    for (int i = 0; i < 32; ++i) {
+        std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)d[i];
+    }
+    std::cout << std::dec << std::endl;
+}
+
+// ɲ
+std::vector<std::string> generateTestData(size_t n) {
+    std::vector<std::string> data(n);
+    for (size_t i = 0; i < n; ++i) {
+        data[i] = "leaf_" + std::to_string(i);
+    }
+    return data;
+}
+
+// ֤
+void testMerkleTree() {
+    const size_t leafCount = 1000000;
+    std::vector<std::string> leafData = generateTestData(leafCount);
+
+    MerkleTree tree;
+    auto start = std::chrono::high_resolution_clock::now();
+    tree.build(leafData);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto buildTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    Digest root = tree.root();
+    std::cout << "Built Merkle tree with " << leafCount << " leaves in " << buildTime << " ms" << std::endl;
+    printDigest("Merkle root: ", root);
+
+    // ֤
+    const size_t testIndex = 12345;
+    std::vector<Digest> proof = tree.inclusionProof(testIndex);
+    Digest leaf = MerkleTree::hashLeaf((const unsigned char*)leafData[testIndex].data(), leafData[testIndex].size());
+    bool valid = MerkleTree::verifyInclusion(leaf, testIndex, tree.size(), proof, root);
+    std::cout << "Membership proof for leaf " << testIndex << " (" << proof.size() << " nodes) valid: "
+        << (valid ? "true" : "false") << std::endl;
+
+    // һ֤ǰ600000Ҷӹɵľ
+    const size_t oldSize = 600000;
+    MerkleTree oldTree;
+    oldTree.build(std::vector<std::string>(leafData.begin(), leafData.begin() + oldSize));
+    std::vector<Digest> consistency = tree.consistencyProof(oldSize);
+    bool consistent = MerkleTree::verifyConsistency(oldSize, tree.size(), oldTree.root(), root, consistency);
+    std::cout << "Consistency proof " << oldSize << " -> " << leafCount << " (" << consistency.size()
+        << " nodes) valid: " << (consistent ? "true" : "false") << std::endl;
+
+    // ֤ѯʱ
+    const int queries = 100000;
+    int passed = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < queries; ++i) {
+        size_t index = (size_t)i * 7919 % leafCount;
+        std::vector<Digest> p = tree.inclusionProof(index);
+        passed += MerkleTree::verifyInclusion(tree.leafHash(index), index, tree.size(), p, root);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    auto queryTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    std::cout << queries << " proofs generated and verified: " << passed << " valid, "
+        << (double)queryTime / queries << " us per proof" << std::endl;
+}
+
+// ׷־ԣ׷׷ӵ£ؽԱ
+void testMerkleLog() {
+    const size_t leafCount = 1000000;
+    std::vector<std::string> leafData = generateTestData(leafCount);
+
+    MerkleLog log;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const std::string& leaf : leafData) {
+        log.append((const unsigned char*)leaf.data(), leaf.size());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto appendTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::cout << "Single appends: " << leafCount << " leaves in " << appendTime << " ms ("
+        << (double)leafCount / std::max<long long>(appendTime, 1) * 1000 << " appends/s)" << std::endl;
+
+    // ׷ӣÿ4096Ҷӣ߳
+    std::vector<const unsigned char*> data(leafCount);
+    std::vector<size_t> len(leafCount);
+    for (size_t i = 0; i < leafCount; ++i) {
+        data[i] = (const unsigned char*)leafData[i].data();
+        len[i] = leafData[i].size();
+    }
+    const size_t batch = 4096;
+    MerkleLog batchLog;
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < leafCount; i += batch) {
+        size_t n = std::min(batch, leafCount - i);
+        batchLog.appendBatch(&data[i], &len[i], n, 1);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    auto batchTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::cout << "Batched appends: " << leafCount << " leaves in " << batchTime << " ms ("
+        << (double)leafCount / std::max<long long>(batchTime, 1) * 1000 << " appends/s)" << std::endl;
+
+    MerkleTree tree;
+    tree.build(leafData);
+    std::cout << "Log root matches full rebuild: "
+        << (log.root() == tree.root() && batchLog.root() == tree.root() ? "yes" : "no") << std::endl;
+
+    // ǩͷʾHMAC-SM3Ϊǩ
+    const unsigned char logKey[] = "merkle-log-signing-key";
+    HMAC_SM3 hmac(logKey, sizeof(logKey) - 1);
+    TreeHead head = log.signTreeHead(1700000000000ULL, [&](const unsigned char* msg, size_t msgLen) {
+        std::vector<unsigned char> tag(32);
+        hmac.mac(msg, msgLen, tag.data());
+        return tag;
+    });
+    std::vector<unsigned char> tbs = head.signedData();
+    std::cout << "Signed tree head at size " << head.treeSize << " verified: "
+        << (hmac.verify(tbs.data(), tbs.size(), head.signature.data()) ? "true" : "false") << std::endl;
+}
+
+// ֤ԣҶ֤ĴС֤ʱ֤֤Ĳ֤
+void testBatchProofs() {
+    const size_t leafCount = 1000000;
+    const size_t batch = 4096;
+    std::vector<std::string> leafData = generateTestData(leafCount);
+    MerkleTree tree;
+    tree.build(leafData);
+    Digest root = tree.root();
+
+    std::vector<size_t> indices(batch);
+    for (size_t i = 0; i < batch; ++i) {
+        indices[i] = (i * 7919 + 17) % leafCount;
+    }
+    std::sort(indices.begin(), indices.end());
+    std::vector<Digest> leaves(batch);
+    std::vector<std::vector<Digest>> proofs(batch);
+    size_t separateNodes = 0;
+    for (size_t i = 0; i < batch; ++i) {
+        leaves[i] = tree.leafHash(indices[i]);
+        proofs[i] = tree.inclusionProof(indices[i]);
+        separateNodes += proofs[i].size();
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    MultiProof multi = tree.multiProof(indices);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto genTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    std::cout << "Multi-proof for " << batch << " leaves: " << multi.nodes.size() << " nodes (separate proofs: "
+        << separateNodes << "), generated in " << genTime << " us" << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    std::vector<size_t> sortedIndices(indices.begin(), indices.end());
+    std::sort(sortedIndices.begin(), sortedIndices.end());
+    bool multiValid = MerkleTree::verifyMultiProof(multi, sortedIndices, leaves, leafCount, root);
+    end = std::chrono::high_resolution_clock::now();
+    auto multiTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t singlePassed = 0;
+    for (size_t i = 0; i < batch; ++i) {
+        singlePassed += MerkleTree::verifyInclusion(leaves[i], indices[i], leafCount, proofs[i], root);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    auto singleTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    std::unique_ptr<bool[]> valid(new bool[batch]);
+    start = std::chrono::high_resolution_clock::now();
+    size_t batchPassed = MerkleTree::verifyInclusionBatch(leaves.data(), indices.data(), batch, leafCount,
+        proofs.data(), root, valid.get());
+    end = std::chrono::high_resolution_clock::now();
+    auto batchTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    std::cout << "Multi-proof verified: " << (multiValid ? "true" : "false") << " in " << multiTime << " us" << std::endl;
+    std::cout << "Separate proofs verified one by one: " << singlePassed << " valid in " << singleTime << " us" << std::endl;
+    std::cout << "Separate proofs verified as batch: " << batchPassed << " valid in " << batchTime << " us" << std::endl;
+
+    // ۸һֻ֤ʧ
+    proofs[batch / 2][3][0] ^= 1;
+    batchPassed = MerkleTree::verifyInclusionBatch(leaves.data(), indices.data(), batch, leafCount,
+        proofs.data(), root, valid.get());
+    multi.nodes[multi.nodes.size() / 2][0] ^= 1;
+    std::cout << "Tampered proof rejected: " << (batchPassed == batch - 1 && !valid[batch / 2] &&
+        !MerkleTree::verifyMultiProof(multi, sortedIndices, leaves, leafCount, root) ? "yes" : "no") << std::endl;
+
+    // һ֤
+    std::vector<size_t> firsts;
+    std::vector<Digest> firstRoots;
+    for (size_t first = 1; first < leafCount; first = first * 3 + 1) {
+        MerkleTree old;
+        old.buildFromLeafHashes(std::vector<Digest>(&tree.leafHash(0), &tree.leafHash(0) + first));
+        firsts.push_back(first);
+        firstRoots.push_back(old.root());
+    }
+    std::vector<std::vector<Digest>> consistency = tree.consistencyProofs(firsts);
+    std::unique_ptr<bool[]> consistent(new bool[firsts.size()]);
+    size_t consistentCount = MerkleTree::verifyConsistencyBatch(firsts.data(), firstRoots.data(), firsts.size(),
+        leafCount, root, consistency.data(), consistent.get());
+    std::cout << "Batch consistency proofs: " << consistentCount << "/" << firsts.size() << " valid" << std::endl;
+
+    // Ĳ֤
+    SortedMerkleTree sorted;
+    sorted.build(leafData);
+    Digest sortedRoot = sorted.root();
+    const std::string absent = "absent_leaf";
+    NonMembershipProof nonMember = sorted.nonMembershipProof((const unsigned char*)absent.data(), absent.size());
+    bool absentValid = SortedMerkleTree::verifyNonMembership((const unsigned char*)absent.data(), absent.size(),
+        nonMember, sorted.size(), sortedRoot);
+    // ͬһ֤ðĳҶӵĲ
+    const std::string& present = leafData[12345];
+    bool presentValid = SortedMerkleTree::verifyNonMembership((const unsigned char*)present.data(), present.size(),
+        nonMember, sorted.size(), sortedRoot);
+    std::cout << "Non-membership proof for \"" << absent << "\" (" << nonMember.proof.nodes.size()
+        << " nodes) valid: " << (absentValid ? "true" : "false") << std::endl;
+    std::cout << "Same proof for an existing leaf rejected: " << (!presentValid ? "yes" : "no") << std::endl;
+
+    // αֻ֤2ҶӣѸӽڵ㵱һҶӡӽڵ㵱ֵܣ
+    // ֤еĴС֤ʱҶӹϣӽڵĳԱܱ֤
+    const MerkleTree& sortedTree = sorted.merkleTree();
+    size_t split = 1;
+    while (split * 2 < sorted.size()) {
+        split *= 2;
+    }
+    MerkleTree left, right;
+    left.buildFromLeafHashes(std::vector<Digest>(&sortedTree.leafHash(0), &sortedTree.leafHash(0) + split));
+    right.buildFromLeafHashes(std::vector<Digest>(&sortedTree.leafHash(0) + split,
+        &sortedTree.leafHash(0) + sorted.size()));
+    NonMembershipProof forged;
+    forged.neighbors.push_back(right.root());
+    forged.proof.treeSize = 2;
+    forged.proof.indices.push_back(1);
+    forged.proof.nodes.push_back(left.root());
+    const int members = 200;
+    int forgeable = 0, forgedAccepted = 0;
+    for (int i = 0; i < members; ++i) {
+        const std::string& member = leafData[(size_t)i * 7919 % leafCount];
+        forgeable += SortedMerkleTree::verifyNonMembership((const unsigned char*)member.data(), member.size(),
+            forged, forged.proof.treeSize, sortedRoot);
+        forgedAccepted += SortedMerkleTree::verifyNonMembership((const unsigned char*)member.data(), member.size(),
+            forged, sorted.size(), sortedRoot);
+    }
+    std::cout << "Forged non-membership proofs (claimed tree size 2) accepted for members: " << forgedAccepted
+        << "/" << members << " (" << forgeable << " would pass if the claimed size were trusted)" << std::endl;
+}
+
+// ־û洢ԣд롢ύ´򿪣ģδύıָ
+void testMerkleStore() {
+    const size_t leafCount = 1000000;
+    char dirTemplate[] = "/tmp/merkle-storeXXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        std::cout << "Failed to create a temporary directory for the store" << std::endl;
+        return;
+    }
+    const std::string dir = dirTemplate;
+    std::vector<std::string> leafData = generateTestData(leafCount);
+    std::vector<const unsigned char*> data(leafCount);
+    std::vector<size_t> len(leafCount);
+    for (size_t i = 0; i < leafCount; ++i) {
+        data[i] = (const unsigned char*)leafData[i].data();
+        len[i] = leafData[i].size();
+    }
+
+    MerkleStore store;
+    if (!store.open(dir)) {
+        std::cout << "Failed to open store " << dir << std::endl;
+        rmdir(dir.c_str());
+        return;
+    }
+    const size_t batch = 4096;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < leafCount; i += batch) {
+        store.appendBatch(&data[i], &len[i], std::min(batch, leafCount - i), 1);
+    }
+    bool committed = store.commit();
+    auto end = std::chrono::high_resolution_clock::now();
+    auto appendTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::cout << "Stored " << leafCount << " leaves and committed in " << appendTime << " ms: "
+        << (committed ? "ok" : "failed") << std::endl;
+
+    // ׷ӵύֱӹرգ൱ڽ̱
+    for (size_t i = 0; i < 1000; ++i) {
+        store.append(data[i], len[i]);
+    }
+    store.close();
+
+    start = std::chrono::high_resolution_clock::now();
+    bool reopened = store.open(dir);
+    end = std::chrono::high_resolution_clock::now();
+    auto openTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    std::cout << "Reopened in " << openTime << " us, size after uncommitted appends: " << store.size()
+        << (reopened && store.size() == leafCount ? " (recovered)" : " (mismatch)") << std::endl;
+
+    MerkleTree tree;
+    tree.build(leafData);
+    Digest root = store.root(leafCount);
+    std::cout << "Stored root matches in-memory tree: " << (root == tree.root() ? "yes" : "no") << std::endl;
+
+    // ҶҶݲλ
+    const int lookups = 1000000;
+    int found = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < lookups; ++i) {
+        size_t index = (size_t)i * 7919 % leafCount;
+        found += store.find(data[index], len[index]) == (long)index;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    auto lookupTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    const std::string absent = "absent_leaf";
+    std::cout << lookups << " stored leaf lookups: " << found << " found in " << lookupTime << " ms, absent leaf: "
+        << store.find((const unsigned char*)absent.data(), absent.size()) << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    tree.buildIndex();
+    end = std::chrono::high_resolution_clock::now();
+    auto indexTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    found = 0;
+    for (int i = 0; i < lookups; ++i) {
+        size_t index = (size_t)i * 7919 % leafCount;
+        found += tree.findLeaf(tree.leafHash(index)) == (long)index;
+    }
+    std::cout << "In-memory leaf index built in " << indexTime << " ms, " << found << " lookups matched" << std::endl;
+
+    // ֻ֤ȡĽڵ
+    const int queries = 100000;
+    int passed = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < queries; ++i) {
+        size_t index = (size_t)i * 7919 % leafCount;
+        std::vector<Digest> p = store.inclusionProof(index, leafCount);
+        passed += MerkleTree::verifyInclusion(store.leafHash(index), index, leafCount, p, root);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    auto queryTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    std::cout << queries << " stored proofs generated and verified: " << passed << " valid, "
+        << (double)queryTime / queries << " us per proof" << std::endl;
+
+    // ֻԱɲã4߳ͬʱ֤뵥߳һ
+    std::atomic<int> concurrentPassed(0);
+    parallelFor(queries, 4, [&](size_t i) {
+        size_t index = i * 7919 % leafCount;
+        std::vector<Digest> p = store.inclusionProof(index, leafCount);
+        concurrentPassed += MerkleTree::verifyInclusion(store.leafHash(index), index, leafCount, p, root);
+    });
+    std::cout << queries << " stored proofs from 4 concurrent readers: " << concurrentPassed.load() << " valid"
+        << std::endl;
+
+    const size_t oldSize = 600000;
+    std::vector<Digest> consistency = store.consistencyProof(oldSize, leafCount);
+    std::cout << "Stored consistency proof " << oldSize << " -> " << leafCount << " valid: "
+        << (MerkleTree::verifyConsistency(oldSize, leafCount, store.root(oldSize), root, consistency) &&
+            consistency == tree.consistencyProof(oldSize) ? "true" : "false") << std::endl;
+
+    // ׷Ӻٴύ
+    store.appendBatch(data.data(), len.data(), 1000, 1);
+    std::cout << "Append after recovery committed: " << (store.commit() ? "ok" : "failed")
+        << ", size " << store.committedSize() << std::endl;
+
+    store.close();
+    for (int h = 0; h < 64; ++h) {
+        unlink((dir + "/level_" + std::to_string(h) + ".dat").c_str());
+    }
+    unlink((dir + "/tree.size").c_str());
+    unlink((dir + "/tree.size.tmp").c_str());
+    unlink((dir + "/leaf.idx").c_str());
+    rmdir(dir.c_str());
+}
+
+int main() {
+    testMerkleTree();
+    testMerkleLog();
+    testBatchProofs();
+    testMerkleStore();
+    return 0;
+}
@@ -4,6 +4,69 @@
 #include <cstring>
 #include <chrono>
 #include <iomanip>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <immintrin.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+// SM3м״̬update֮󶼿ɵӸôϣ
+struct SM3State {
+    static constexpr size_t SERIALIZED_SIZE = 32 + 8 + 64;
+
+    uint32_t state[8];
+    uint64_t count;
+    unsigned char buffer[64];
+
+    // ѹժҪ״̬processedLenΪԭϢĳȣչã
+    static SM3State fromDigest(const unsigned char digest[32], uint64_t processedLen) {
+        SM3State s;
+        for (int i = 0; i < 8; ++i) {
+            s.state[i] = ((uint32_t)digest[i * 4] << 24) | ((uint32_t)digest[i * 4 + 1] << 16) |
+                ((uint32_t)digest[i * 4 + 2] << 8) | digest[i * 4 + 3];
+        }
+        s.count = processedLen;
+        memset(s.buffer, 0, sizeof(s.buffer));
+        return s;
+    }
+
+    // л8״ֺ̬ͼ˴ţ64ֽڻ
+    void serialize(unsigned char out[SERIALIZED_SIZE]) const {
+        for (int i = 0; i < 8; ++i) {
+            out[i * 4] = (state[i] >> 24) & 0xFF;
+            out[i * 4 + 1] = (state[i] >> 16) & 0xFF;
+            out[i * 4 + 2] = (state[i] >> 8) & 0xFF;
+            out[i * 4 + 3] = state[i] & 0xFF;
+        }
+        for (int i = 0; i < 8; ++i) {
+            out[32 + i] = (count >> ((7 - i) * 8)) & 0xFF;
+        }
+        memcpy(out + 40, buffer, 64);
+    }
+
+    void deserialize(const unsigned char in[SERIALIZED_SIZE]) {
+        for (int i = 0; i < 8; ++i) {
+            state[i] = ((uint32_t)in[i * 4] << 24) | ((uint32_t)in[i * 4 + 1] << 16) |
+                ((uint32_t)in[i * 4 + 2] << 8) | in[i * 4 + 3];
+        }
+        count = 0;
+        for (int i = 0; i < 8; ++i) {
+            count = (count << 8) | in[32 + i];
+        }
+        memcpy(buffer, in + 40, 64);
+    }
+};
 
 // SM3ʵ
 class SM3 {
@@ -52,13 +115,13 @@ public:
         size_t index = count % 64;
         size_t padLen = (index < 56) ? (56 - index) : (120 - index);
 
-        // 
+        // 䣨ǰ¼
+        uint64_t bitCount = count * 8;
         unsigned char padding[64] = { 0 };
         padding[0] = 0x80;
         update(padding, padLen);
 
         // ӳ
-        uint64_t bitCount = count * 8;
         for (int i = 0; i < 8; ++i) {
             padding[i] = (bitCount >> ((7 - i) * 8)) & 0xFF;
         }
@@ -73,6 +136,21 @@ public:
         }
     }
 
+    // /м״̬
+    SM3State exportState() const {
+        SM3State s;
+        memcpy(s.state, state, sizeof(state));
+        s.count = count;
+        memcpy(s.buffer, buffer, sizeof(buffer));
+        return s;
+    }
+
+    void importState(const SM3State& s) {
+        memcpy(state, s.state, sizeof(state));
+        count = s.count;
+        memcpy(buffer, s.buffer, sizeof(buffer));
+    }
+
 private:
     uint32_t state[8];
     uint64_t count;
@@ -133,7 +211,7 @@ private:
         uint32_t H = state[7];
 
         for (int j = 0; j < 64; ++j) {
-            uint32_t SS1 = rotateLeft(rotateLeft(A, 12) + E + rotateLeft(0x79CC4519, j), 7);
+            uint32_t SS1 = rotateLeft(rotateLeft(A, 12) + E + rotateLeft(j < 16 ? 0x79CC4519 : 0x7A879D8A, j % 32), 7);
             uint32_t SS2 = SS1 ^ rotateLeft(A, 12);
             uint32_t TT1 = FF(A, B, C, j) + D + SS2 + W1[j];
             uint32_t TT2 = GG(E, F, G, j) + H + SS1 + W[j];
@@ -169,7 +247,7 @@ void testSM3() {
     for (int i = 0; i < 32; ++i) {
         std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)digest[i];
     }
-    std::cout << std::endl;
+    std::cout << std::dec << std::endl;
 
     // "abc"
     sm3.reset();
@@ -179,7 +257,7 @@ void testSM3() {
     for (int i = 0; i < 32; ++i) {
         std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)digest[i];
     }
-    std::cout << std::endl;
+    std::cout << std::dec << std::endl;
 
     // Գַ
     sm3.reset();
@@ -190,7 +268,7 @@ void testSM3() {
     for (int i = 0; i < 32; ++i) {
         std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)digest[i];
     }
-    std::cout << std::endl;
+    std::cout << std::dec << std::endl;
 }
 
 // ܲ
@@ -216,6 +294,26 @@ void performanceTest() {
 
 
 // SM3Żʵ
+
+// Ԥֳ Tj <<< (j mod 32)ѹʱֱӲ
+alignas(32) constexpr uint32_t SM3_TJ[64] = {
+    0x79CC4519, 0xF3988A32, 0xE7311465, 0xCE6228CB, 0x9CC45197, 0x3988A32F, 0x7311465E, 0xE6228CBC,
+    0xCC451979, 0x988A32F3, 0x311465E7, 0x6228CBCE, 0xC451979C, 0x88A32F39, 0x11465E73, 0x228CBCE6,
+    0x9D8A7A87, 0x3B14F50F, 0x7629EA1E, 0xEC53D43C, 0xD8A7A879, 0xB14F50F3, 0x629EA1E7, 0xC53D43CE,
+    0x8A7A879D, 0x14F50F3B, 0x29EA1E76, 0x53D43CEC, 0xA7A879D8, 0x4F50F3B1, 0x9EA1E762, 0x3D43CEC5,
+    0x7A879D8A, 0xF50F3B14, 0xEA1E7629, 0xD43CEC53, 0xA879D8A7, 0x50F3B14F, 0xA1E7629E, 0x43CEC53D,
+    0x879D8A7A, 0x0F3B14F5, 0x1E7629EA, 0x3CEC53D4, 0x79D8A7A8, 0xF3B14F50, 0xE7629EA1, 0xCEC53D43,
+    0x9D8A7A87, 0x3B14F50F, 0x7629EA1E, 0xEC53D43C, 0xD8A7A879, 0xB14F50F3, 0x629EA1E7, 0xC53D43CE,
+    0x8A7A879D, 0x14F50F3B, 0x29EA1E76, 0x53D43CEC, 0xA7A879D8, 0x4F50F3B1, 0x9EA1E762, 0x3D43CEC5
+};
+
+// 4չÿֽдD/H÷ֻĴ8θֵ
+#define SM3_ROUNDS4(R, j)                                                                \
+    R(A, B, C, D, E, F, G, H, SM3_TJ[(j)], W[(j)], W[(j)] ^ W[(j) + 4]);                 \
+    R(D, A, B, C, H, E, F, G, SM3_TJ[(j) + 1], W[(j) + 1], W[(j) + 1] ^ W[(j) + 5]);     \
+    R(C, D, A, B, G, H, E, F, SM3_TJ[(j) + 2], W[(j) + 2], W[(j) + 2] ^ W[(j) + 6]);     \
+    R(B, C, D, A, F, G, H, E, SM3_TJ[(j) + 3], W[(j) + 3], W[(j) + 3] ^ W[(j) + 7])
+
 class SM3_Optimized {
 public:
     SM3_Optimized() {
@@ -232,156 +330,221 @@ public:
         state[6] = 0xE38DEE4D;
         state[7] = 0xB0FB0E4E;
         count = 0;
+        bufferLen = 0;
     }
 
+    // ֱӴӵ÷ڴѹֻпõĲֽڽ뻺
     void update(const unsigned char* data, size_t len) {
-        size_t index = count % 64;
         count += len;
 
-        // е
-        if (index + len < 64) {
-            memcpy(buffer + index, data, len);
+        // һʱֻ׷ӵ
+        if (len < 64 && bufferLen + len < 64) {
+            memcpy(buffer + bufferLen, data, len);
+            bufferLen += len;
             return;
         }
 
-        // 仺
-        memcpy(buffer + index, data, 64 - index);
-        processBlock(buffer);
+        // Ȳ뻺еĲ
+        if (bufferLen) {
+            size_t take = 64 - bufferLen;
+            memcpy(buffer + bufferLen, data, take);
+            processBlocks(buffer, 1);
+            data += take;
+            len -= take;
+            bufferLen = 0;
+        }
 
-        // Ŀ
-        size_t i = 64 - index;
-        for (; i + 64 <= len; i += 64) {
-            processBlock(data + i);
+        // һѹֵڷ֮䱣ڼĴ
+        size_t blocks = len / 64;
+        if (blocks) {
+            processBlocks(data, blocks);
+            data += blocks * 64;
+            len -= blocks * 64;
         }
 
         // ʣ
-        memcpy(buffer, data + i, len - i);
+        if (len) {
+            memcpy(buffer, data, len);
+            bufferLen = len;
+        }
+    }
+
+    // ɢ/ۼ룺Ƭİ˳գƴ
+    void update(const struct iovec* iov, int iovcnt) {
+        for (int i = 0; i < iovcnt; ++i) {
+            update((const unsigned char*)iov[i].iov_base, iov[i].iov_len);
+        }
     }
 
     void final(unsigned char digest[32]) {
-        size_t index = count % 64;
-        size_t padLen = (index < 56) ? (56 - index) : (120 - index);
+        uint64_t bitCount = count * 8;
 
-        // 
-        unsigned char padding[64] = { 0 };
-        padding[0] = 0x80;
-        update(padding, padLen);
+        // ֱڻ䣬ȷŲʱѹһ
+        buffer[bufferLen++] = 0x80;
+        if (bufferLen > 56) {
+            memset(buffer + bufferLen, 0, 64 - bufferLen);
+            processBlocks(buffer, 1);
+            bufferLen = 0;
+        }
+        memset(buffer + bufferLen, 0, 56 - bufferLen);
 
         // ӳ
-        uint64_t bitCount = count * 8;
         for (int i = 0; i < 8; ++i) {
-            padding[i] = (bitCount >> ((7 - i) * 8)) & 0xFF;
+            buffer[56 + i] = (bitCount >> ((7 - i) * 8)) & 0xFF;
         }
-        update(padding, 8);
+        processBlocks(buffer, 1);
+        bufferLen = 0;
 
-        // ϣֵ
-        for (int i = 0; i < 8; ++i) {
-            digest[i * 4] = (state[i] >> 24) & 0xFF;
-            digest[i * 4 + 1] = (state[i] >> 16) & 0xFF;
-            digest[i * 4 + 2] = (state[i] >> 8) & 0xFF;
-            digest[i * 4 + 3] = state[i] & 0xFF;
-        }
+        // ϣֵ - PSHUFBһת4ֵֽ
+        const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+        _mm_storeu_si128((__m128i*)digest, _mm_shuffle_epi8(_mm_load_si128((const __m128i*)state), bswap));
+        _mm_storeu_si128((__m128i*)(digest + 16), _mm_shuffle_epi8(_mm_load_si128((const __m128i*)(state + 4)), bswap));
+    }
+
+    // /м״̬
+    SM3State exportState() const {
+        SM3State s;
+        memcpy(s.state, state, sizeof(state));
+        s.count = count;
+        memcpy(s.buffer, buffer, bufferLen);
+        memset(s.buffer + bufferLen, 0, sizeof(s.buffer) - bufferLen);
+        return s;
+    }
+
+    void importState(const SM3State& s) {
+        memcpy(state, s.state, sizeof(state));
+        count = s.count;
+        memcpy(buffer, s.buffer, sizeof(buffer));
+        bufferLen = (size_t)(s.count % 64);
     }
 
 private:
     alignas(32) uint32_t state[8];
     uint64_t count;
+    size_t bufferLen; // еĲֽÿεõcount % 64
     alignas(32) unsigned char buffer[64];
 
     // ѭ - ʹ
-    inline uint32_t rotateLeft(uint32_t x, int n) {
+    static inline uint32_t rotateLeft(uint32_t x, int n) {
         return (x << n) | (x >> (32 - n));
     }
 
-    //  - ʹ
-    inline uint32_t FF(uint32_t x, uint32_t y, uint32_t z, int j) {
-        return (j < 16) ? (x ^ y ^ z) : ((x & y) | (x & z) | (y & z));
-    }
-
-    inline uint32_t GG(uint32_t x, uint32_t y, uint32_t z, int j) {
-        return (j < 16) ? (x ^ y ^ z) : ((x & y) | ((~x) & z));
+    // ѭ - 4ͬʱλ
+    static inline __m128i rotateLeft128(__m128i x, int n) {
+        return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n));
     }
 
     // û - ʹ
-    inline uint32_t P0(uint32_t x) {
+    static inline uint32_t P0(uint32_t x) {
         return x ^ rotateLeft(x, 9) ^ rotateLeft(x, 17);
     }
 
-    inline uint32_t P1(uint32_t x) {
-        return x ^ rotateLeft(x, 15) ^ rotateLeft(x, 23);
+    // 0-15֣FF/GGΪ谴ִη֧
+    static inline void round0(uint32_t A, uint32_t& B, uint32_t C, uint32_t& D,
+        uint32_t E, uint32_t& F, uint32_t G, uint32_t& H,
+        uint32_t Tj, uint32_t Wj, uint32_t W1j) {
+        uint32_t A12 = rotateLeft(A, 12);
+        uint32_t SS1 = rotateLeft(A12 + E + Tj, 7);
+        uint32_t SS2 = SS1 ^ A12;
+        D = (A ^ B ^ C) + D + SS2 + W1j;
+        H = P0((E ^ F ^ G) + H + SS1 + Wj);
+        B = rotateLeft(B, 9);
+        F = rotateLeft(F, 19);
     }
 
-    //  - ʹչѭ;ֲŻ
-    void processBlock(const unsigned char* block) {
-        alignas(32) uint32_t W[68];
-        alignas(32) uint32_t W1[64];
-
-        // Ϣչ - չѭ
-        for (int i = 0; i < 16; ++i) {
-            W[i] = (block[i * 4] << 24) | (block[i * 4 + 1] << 16) |
-                (block[i * 4 + 2] << 8) | block[i * 4 + 3];
-        }
-
-        // չѭʹþֲ
-        for (int i = 16; i < 68; ++i) {
-            uint32_t tmp = W[i - 16] ^ W[i - 9] ^ rotateLeft(W[i - 3], 15);
-            W[i] = P1(tmp) ^ rotateLeft(W[i - 13], 7) ^ W[i - 6];
-        }
-
-        // мW1
-        for (int i = 0; i < 64; ++i) {
-            W1[i] = W[i] ^ W[i + 4];
-        }
-
-        // ѹ - ʹþֲڴ
-        uint32_t A = state[0];
-        uint32_t B = state[1];
-        uint32_t C = state[2];
-        uint32_t D = state[3];
-        uint32_t E = state[4];
-        uint32_t F = state[5];
-        uint32_t G = state[6];
-        uint32_t H = state[7];
+    // 16-63֣FFȡGGȡѡ
+    static inline void round1(uint32_t A, uint32_t& B, uint32_t C, uint32_t& D,
+        uint32_t E, uint32_t& F, uint32_t G, uint32_t& H,
+        uint32_t Tj, uint32_t Wj, uint32_t W1j) {
+        uint32_t A12 = rotateLeft(A, 12);
+        uint32_t SS1 = rotateLeft(A12 + E + Tj, 7);
+        uint32_t SS2 = SS1 ^ A12;
+        D = ((A & B) | ((A | B) & C)) + D + SS2 + W1j;
+        H = P0((((F ^ G) & E) ^ G) + H + SS1 + Wj);
+        B = rotateLeft(B, 9);
+        F = rotateLeft(F, 19);
+    }
 
-        // չѭ
-        for (int j = 0; j < 16; ++j) {
-            uint32_t SS1 = rotateLeft(rotateLeft(A, 12) + E + rotateLeft(0x79CC4519, j), 7);
-            uint32_t SS2 = SS1 ^ rotateLeft(A, 12);
-            uint32_t TT1 = FF(A, B, C, j) + D + SS2 + W1[j];
-            uint32_t TT2 = GG(E, F, G, j) + H + SS1 + W[j];
-            D = C;
-            C = rotateLeft(B, 9);
-            B = A;
-            A = TT1;
-            H = G;
-            G = rotateLeft(F, 19);
-            F = E;
-            E = P0(TT2);
+    // Ķ - SIMDϢչ + ȫչ64ֵֻ֣βдһ
+    void processBlocks(const unsigned char* block, size_t blocks) {
+        alignas(16) uint32_t W[72]; // 4ֹչĩд
+        const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+        uint32_t V0 = state[0];
+        uint32_t V1 = state[1];
+        uint32_t V2 = state[2];
+        uint32_t V3 = state[3];
+        uint32_t V4 = state[4];
+        uint32_t V5 = state[5];
+        uint32_t V6 = state[6];
+        uint32_t V7 = state[7];
+
+        for (; blocks > 0; --blocks, block += 64) {
+            //  - PSHUFBһν4ֵֽ
+            for (int i = 0; i < 4; ++i) {
+                __m128i m = _mm_loadu_si128((const __m128i*)(block + i * 16));
+                _mm_store_si128((__m128i*)(W + i * 4), _mm_shuffle_epi8(m, bswap));
+            }
+
+            // Ϣչ - W[j]W[j-3]ÿ3֣4ͨһ
+            for (int j = 16; j < 68; j += 3) {
+                __m128i w16 = _mm_loadu_si128((const __m128i*)(W + j - 16));
+                __m128i w13 = _mm_loadu_si128((const __m128i*)(W + j - 13));
+                __m128i w9 = _mm_loadu_si128((const __m128i*)(W + j - 9));
+                __m128i w6 = _mm_loadu_si128((const __m128i*)(W + j - 6));
+                __m128i w3 = _mm_loadu_si128((const __m128i*)(W + j - 3));
+
+                __m128i t = _mm_xor_si128(_mm_xor_si128(w16, w9), rotateLeft128(w3, 15));
+                t = _mm_xor_si128(_mm_xor_si128(t, rotateLeft128(t, 15)), rotateLeft128(t, 23));
+                t = _mm_xor_si128(_mm_xor_si128(t, rotateLeft128(w13, 7)), w6);
+                _mm_storeu_si128((__m128i*)(W + j), t);
+            }
+
+            // ѹ - ʹþֲڴ
+            uint32_t A = V0;
+            uint32_t B = V1;
+            uint32_t C = V2;
+            uint32_t D = V3;
+            uint32_t E = V4;
+            uint32_t F = V5;
+            uint32_t G = V6;
+            uint32_t H = V7;
+
+            SM3_ROUNDS4(round0, 0);
+            SM3_ROUNDS4(round0, 4);
+            SM3_ROUNDS4(round0, 8);
+            SM3_ROUNDS4(round0, 12);
+
+            SM3_ROUNDS4(round1, 16);
+            SM3_ROUNDS4(round1, 20);
+            SM3_ROUNDS4(round1, 24);
+            SM3_ROUNDS4(round1, 28);
+            SM3_ROUNDS4(round1, 32);
+            SM3_ROUNDS4(round1, 36);
+            SM3_ROUNDS4(round1, 40);
+            SM3_ROUNDS4(round1, 44);
+            SM3_ROUNDS4(round1, 48);
+            SM3_ROUNDS4(round1, 52);
+            SM3_ROUNDS4(round1, 56);
+            SM3_ROUNDS4(round1, 60);
+
+            V0 ^= A;
+            V1 ^= B;
+            V2 ^= C;
+            V3 ^= D;
+            V4 ^= E;
+            V5 ^= F;
+            V6 ^= G;
+            V7 ^= H;
         }
 
-        for (int j = 16; j < 64; ++j) {
-            uint32_t SS1 = rotateLeft(rotateLeft(A, 12) + E + rotateLeft(0x7A879D8A, j - 16), 7);
-            uint32_t SS2 = SS1 ^ rotateLeft(A, 12);
-            uint32_t TT1 = FF(A, B, C, j) + D + SS2 + W1[j];
-            uint32_t TT2 = GG(E, F, G, j) + H + SS1 + W[j];
-            D = C;
-            C = rotateLeft(B, 9);
-            B = A;
-            A = TT1;
-            H = G;
-            G = rotateLeft(F, 19);
-            F = E;
-            E = P0(TT2);
-        }
-
-        state[0] ^= A;
-        state[1] ^= B;
-        state[2] ^= C;
-        state[3] ^= D;
-        state[4] ^= E;
-        state[5] ^= F;
-        state[6] ^= G;
-        state[7] ^= H;
+        state[0] = V0;
+        state[1] = V1;
+        state[2] = V2;
+        state[3] = V3;
+        state[4] = V4;
+        state[5] = V5;
+        state[6] = V6;
+        state[7] = V7;
     }
 };
 
@@ -391,13 +554,15 @@ void comparePerformance() {
     unsigned char* data = new unsigned char[size];
     memset(data, 0x61, size); // 'a'
 
+    unsigned char basicDigest[32];
+    unsigned char optDigest[32];
+
     // Իʵ
     {
         SM3 sm3;
         auto start = std::chrono::high_resolution_clock::now();
         sm3.update(data, size);
-        unsigned char digest[32];
-        sm3.final(digest);
+        sm3.final(basicDigest);
         auto end = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
         double speed = (double)size / (1024 * 1024) / (duration / 1000.0);
@@ -409,20 +574,1004 @@ void comparePerformance() {
         SM3_Optimized sm3;
         auto start = std::chrono::high_resolution_clock::now();
         sm3.update(data, size);
-        unsigned char digest[32];
-        sm3.final(digest);
+        sm3.final(optDigest);
         auto end = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
         double speed = (double)size / (1024 * 1024) / (duration / 1000.0);
         std::cout << "Optimized SM3: " << duration << " ms, speed: " << speed << " MB/s" << std::endl;
     }
 
+    // Уʵֽһ
+    std::cout << "Digest match: " << (memcmp(basicDigest, optDigest, 32) == 0 ? "yes" : "no") << std::endl;
+
+    delete[] data;
+}
+
+// СƬʽԣ1-100ֽڵƬupdate֤iovecһ
+void fragmentPerformanceTest() {
+    const size_t size = 1024 * 1024 * 32; // 32MB
+    unsigned char* data = new unsigned char[size];
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = (unsigned char)(i * 131 + 7);
+    }
+
+    // ԤɷƬȣʱа
+    std::vector<struct iovec> fragments;
+    uint32_t seed = 12345;
+    for (size_t off = 0; off < size;) {
+        seed = seed * 1103515245 + 12345;
+        size_t len = std::min<size_t>(1 + (seed >> 16) % 100, size - off);
+        fragments.push_back({ data + off, len });
+        off += len;
+    }
+
+    unsigned char basicDigest[32];
+    unsigned char optDigest[32];
+    unsigned char iovDigest[32];
+
+    SM3 basic;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& frag : fragments) {
+        basic.update((const unsigned char*)frag.iov_base, frag.iov_len);
+    }
+    basic.final(basicDigest);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto basicTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    SM3_Optimized sm3;
+    start = std::chrono::high_resolution_clock::now();
+    for (const auto& frag : fragments) {
+        sm3.update((const unsigned char*)frag.iov_base, frag.iov_len);
+    }
+    sm3.final(optDigest);
+    end = std::chrono::high_resolution_clock::now();
+    auto optTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    sm3.reset();
+    start = std::chrono::high_resolution_clock::now();
+    sm3.update(fragments.data(), (int)fragments.size());
+    sm3.final(iovDigest);
+    end = std::chrono::high_resolution_clock::now();
+    auto iovTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    std::cout << "Fragmented update (" << fragments.size() << " fragments): basic " << basicTime
+        << " ms, optimized " << optTime << " ms, iovec " << iovTime << " ms" << std::endl;
+    std::cout << "Fragment digest match: "
+        << (memcmp(basicDigest, optDigest, 32) == 0 && memcmp(optDigest, iovDigest, 32) == 0 ? "yes" : "no")
+        << std::endl;
+
+    delete[] data;
+}
+
+// SM3ʼ
+constexpr uint32_t SM3_IV[8] = {
+    0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600,
+    0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E
+};
+
+// 8·е4չSM3_ROUNDS4ͬļĴֻʽ
+#define SM3_ROUNDS4_X8(R, j)                                                                          \
+    R(A, B, C, D, E, F, G, H, SM3_TJ[(j)], W[(j)], _mm256_xor_si256(W[(j)], W[(j) + 4]));             \
+    R(D, A, B, C, H, E, F, G, SM3_TJ[(j) + 1], W[(j) + 1], _mm256_xor_si256(W[(j) + 1], W[(j) + 5])); \
+    R(C, D, A, B, G, H, E, F, SM3_TJ[(j) + 2], W[(j) + 2], _mm256_xor_si256(W[(j) + 2], W[(j) + 6])); \
+    R(B, C, D, A, F, G, H, E, SM3_TJ[(j) + 3], W[(j) + 3], _mm256_xor_si256(W[(j) + 3], W[(j) + 7]))
+
+// SM3໺ʵ֣AVX2ÿ32λͨһϢ8Ϣͬʱѹ
+class SM3_MB {
+public:
+    static constexpr int LANES = 8;
+
+    // 8ȳϢ prefix || msg[i] Ĺϣǰ׺ΪͨΪգ
+    static void hash(const unsigned char* prefix, size_t prefixLen,
+        const unsigned char* const msg[LANES], size_t len, unsigned char digest[LANES][32]) {
+        size_t lens[LANES];
+        std::fill(lens, lens + LANES, len);
+        hashFrom(SM3_IV, 0, prefix, prefixLen, msg, lens, digest);
+    }
+
+    // ӹм״̬8ͨstartΪ㣬ոԵmsg[i]
+    static void hash(const SM3State& start, const unsigned char* const msg[LANES], size_t len,
+        unsigned char digest[LANES][32]) {
+        size_t lens[LANES];
+        std::fill(lens, lens + LANES, len);
+        hash(start, msg, lens, digest);
+    }
+
+    // ȳϢͨԼһ֮ٸ
+    static void hash(const SM3State& start, const unsigned char* const msg[LANES], const size_t len[LANES],
+        unsigned char digest[LANES][32]) {
+        size_t buffered = (size_t)(start.count % 64);
+        hashFrom(start.state, start.count - buffered, start.buffer, buffered, msg, len, digest);
+    }
+
+    // ivΪѹprocessedֽڣ64ıֵ
+    static void hashFrom(const uint32_t iv[8], uint64_t processed, const unsigned char* prefix, size_t prefixLen,
+        const unsigned char* const msg[LANES], const size_t len[LANES], unsigned char digest[LANES][32]) {
+        alignas(32) uint32_t V[8][LANES];
+        for (int i = 0; i < 8; ++i) {
+            for (int l = 0; l < LANES; ++l) {
+                V[i][l] = iv[i];
+            }
+        }
+
+        size_t blocks[LANES];
+        size_t maxBlocks = 0;
+        for (int l = 0; l < LANES; ++l) {
+            blocks[l] = (prefixLen + len[l] + 9 + 63) / 64;
+            maxBlocks = std::max(maxBlocks, blocks[l]);
+        }
+
+        alignas(32) unsigned char scratch[LANES][64];
+        const unsigned char* blk[LANES];
+
+        for (size_t k = 0; k < maxBlocks; ++k) {
+            size_t off = k * 64;
+            int finished = 0;
+            for (int l = 0; l < LANES; ++l) {
+                if (k >= blocks[l]) {
+                    // ѽͨ飬ѹֵָ
+                    blk[l] = scratch[l];
+                    finished |= 1 << l;
+                }
+                else if (off >= prefixLen && off + 64 <= prefixLen + len[l]) {
+                    // λϢڣֱӴӵ÷ڴȡ
+                    blk[l] = msg[l] + (off - prefixLen);
+                }
+                else {
+                    // Խǰ׺/߽Ŀڱػƴ
+                    buildBlock(scratch[l], prefix, prefixLen, msg[l], len[l], off, k + 1 == blocks[l], processed);
+                    blk[l] = scratch[l];
+                }
+            }
+
+            if (!finished) {
+                compress(V, blk);
+                continue;
+            }
+            uint32_t saved[8][LANES];
+            memcpy(saved, V, sizeof(saved));
+            compress(V, blk);
+            for (int l = 0; l < LANES; ++l) {
+                if (finished & (1 << l)) {
+                    for (int i = 0; i < 8; ++i) {
+                        V[i][l] = saved[i][l];
+                    }
+                }
+            }
+        }
+
+        // ϣֵ
+        for (int l = 0; l < LANES; ++l) {
+            for (int i = 0; i < 8; ++i) {
+                digest[l][i * 4] = (V[i][l] >> 24) & 0xFF;
+                digest[l][i * 4 + 1] = (V[i][l] >> 16) & 0xFF;
+                digest[l][i * 4 + 2] = (V[i][l] >> 8) & 0xFF;
+                digest[l][i * 4 + 3] = V[i][l] & 0xFF;
+            }
+        }
+    }
+
+    // ѹ8ͨһ飬V[][ͨ]
+    static void compress(uint32_t V[8][LANES], const unsigned char* const blk[LANES]) {
+        __m256i W[68];
+
+        // 벢תãÿͨ8 -> ÿ8ͨͬһ
+        const __m256i bswap = _mm256_set_epi8(
+            12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+            12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+        for (int half = 0; half < 2; ++half) {
+            __m256i r[8];
+            for (int l = 0; l < LANES; ++l) {
+                r[l] = _mm256_loadu_si256((const __m256i*)(blk[l] + half * 32));
+            }
+            transpose8x8(r);
+            for (int i = 0; i < 8; ++i) {
+                W[half * 8 + i] = _mm256_shuffle_epi8(r[i], bswap);
+            }
+        }
+
+        // Ϣչ - ֮ͨ໥ÿ8ͨ
+        for (int j = 16; j < 68; ++j) {
+            __m256i t = _mm256_xor_si256(_mm256_xor_si256(W[j - 16], W[j - 9]), rotateLeft256(W[j - 3], 15));
+            t = _mm256_xor_si256(_mm256_xor_si256(t, rotateLeft256(t, 15)), rotateLeft256(t, 23));
+            W[j] = _mm256_xor_si256(_mm256_xor_si256(t, rotateLeft256(W[j - 13], 7)), W[j - 6]);
+        }
+
+        __m256i A = _mm256_load_si256((const __m256i*)V[0]);
+        __m256i B = _mm256_load_si256((const __m256i*)V[1]);
+        __m256i C = _mm256_load_si256((const __m256i*)V[2]);
+        __m256i D = _mm256_load_si256((const __m256i*)V[3]);
+        __m256i E = _mm256_load_si256((const __m256i*)V[4]);
+        __m256i F = _mm256_load_si256((const __m256i*)V[5]);
+        __m256i G = _mm256_load_si256((const __m256i*)V[6]);
+        __m256i H = _mm256_load_si256((const __m256i*)V[7]);
+
+        SM3_ROUNDS4_X8(round0, 0);
+        SM3_ROUNDS4_X8(round0, 4);
+        SM3_ROUNDS4_X8(round0, 8);
+        SM3_ROUNDS4_X8(round0, 12);
+
+        SM3_ROUNDS4_X8(round1, 16);
+        SM3_ROUNDS4_X8(round1, 20);
+        SM3_ROUNDS4_X8(round1, 24);
+        SM3_ROUNDS4_X8(round1, 28);
+        SM3_ROUNDS4_X8(round1, 32);
+        SM3_ROUNDS4_X8(round1, 36);
+        SM3_ROUNDS4_X8(round1, 40);
+        SM3_ROUNDS4_X8(round1, 44);
+        SM3_ROUNDS4_X8(round1, 48);
+        SM3_ROUNDS4_X8(round1, 52);
+        SM3_ROUNDS4_X8(round1, 56);
+        SM3_ROUNDS4_X8(round1, 60);
+
+        _mm256_store_si256((__m256i*)V[0], _mm256_xor_si256(_mm256_load_si256((const __m256i*)V[0]), A));
+        _mm256_store_si256((__m256i*)V[1], _mm256_xor_si256(_mm256_load_si256((const __m256i*)V[1]), B));
+        _mm256_store_si256((__m256i*)V[2], _mm256_xor_si256(_mm256_load_si256((const __m256i*)V[2]), C));
+        _mm256_store_si256((__m256i*)V[3], _mm256_xor_si256(_mm256_load_si256((const __m256i*)V[3]), D));
+        _mm256_store_si256((__m256i*)V[4], _mm256_xor_si256(_mm256_load_si256((const __m256i*)V[4]), E));
+        _mm256_store_si256((__m256i*)V[5], _mm256_xor_si256(_mm256_load_si256((const __m256i*)V[5]), F));
+        _mm256_store_si256((__m256i*)V[6], _mm256_xor_si256(_mm256_load_si256((const __m256i*)V[6]), G));
+        _mm256_store_si256((__m256i*)V[7], _mm256_xor_si256(_mm256_load_si256((const __m256i*)V[7]), H));
+    }
+
+private:
+    static inline __m256i rotateLeft256(__m256i x, int n) {
+        return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+    }
+
+    static inline __m256i P0(__m256i x) {
+        return _mm256_xor_si256(_mm256_xor_si256(x, rotateLeft256(x, 9)), rotateLeft256(x, 17));
+    }
+
+    static inline void round0(__m256i A, __m256i& B, __m256i C, __m256i& D,
+        __m256i E, __m256i& F, __m256i G, __m256i& H,
+        uint32_t Tj, __m256i Wj, __m256i W1j) {
+        __m256i A12 = rotateLeft256(A, 12);
+        __m256i SS1 = rotateLeft256(_mm256_add_epi32(_mm256_add_epi32(A12, E), _mm256_set1_epi32((int)Tj)), 7);
+        __m256i SS2 = _mm256_xor_si256(SS1, A12);
+        __m256i ff = _mm256_xor_si256(_mm256_xor_si256(A, B), C);
+        __m256i gg = _mm256_xor_si256(_mm256_xor_si256(E, F), G);
+        D = _mm256_add_epi32(_mm256_add_epi32(ff, D), _mm256_add_epi32(SS2, W1j));
+        H = P0(_mm256_add_epi32(_mm256_add_epi32(gg, H), _mm256_add_epi32(SS1, Wj)));
+        B = rotateLeft256(B, 9);
+        F = rotateLeft256(F, 19);
+    }
+
+    static inline void round1(__m256i A, __m256i& B, __m256i C, __m256i& D,
+        __m256i E, __m256i& F, __m256i G, __m256i& H,
+        uint32_t Tj, __m256i Wj, __m256i W1j) {
+        __m256i A12 = rotateLeft256(A, 12);
+        __m256i SS1 = rotateLeft256(_mm256_add_epi32(_mm256_add_epi32(A12, E), _mm256_set1_epi32((int)Tj)), 7);
+        __m256i SS2 = _mm256_xor_si256(SS1, A12);
+        __m256i ff = _mm256_or_si256(_mm256_and_si256(A, B), _mm256_and_si256(_mm256_or_si256(A, B), C));
+        __m256i gg = _mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(F, G), E), G);
+        D = _mm256_add_epi32(_mm256_add_epi32(ff, D), _mm256_add_epi32(SS2, W1j));
+        H = P0(_mm256_add_epi32(_mm256_add_epi32(gg, H), _mm256_add_epi32(SS1, Wj)));
+        B = rotateLeft256(B, 9);
+        F = rotateLeft256(F, 19);
+    }
+
+    // 8x832λת
+    static inline void transpose8x8(__m256i r[8]) {
+        __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+        __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+        __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+        __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+        __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+        __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+        __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+        __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+        __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+        __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+        __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+        __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+        __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+        __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+        __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+        __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+        r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+        r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+        r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+        r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+        r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+        r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+        r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+        r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+    }
+
+    // ƴӿ߽ķ飺ǰ׺Ϣ塢0x80ĩ64λ
+    static void buildBlock(unsigned char dst[64], const unsigned char* prefix, size_t prefixLen,
+        const unsigned char* data, size_t len, size_t off, bool last, uint64_t processed) {
+        size_t total = prefixLen + len;
+        memset(dst, 0, 64);
+        if (off < prefixLen) {
+            memcpy(dst, prefix + off, std::min<size_t>(prefixLen - off, 64));
+        }
+        size_t begin = std::max(off, prefixLen);
+        size_t end = std::min(off + 64, total);
+        if (begin < end) {
+            memcpy(dst + (begin - off), data + (begin - prefixLen), end - begin);
+        }
+        if (total >= off && total < off + 64) {
+            dst[total - off] = 0x80;
+        }
+        if (last) {
+            uint64_t bitCount = (processed + total) * 8;
+            for (int i = 0; i < 8; ++i) {
+                dst[56 + i] = (bitCount >> ((7 - i) * 8)) & 0xFF;
+            }
+        }
+    }
+};
+
+// פ̳߳أ߳״õʱ˺һֱȴparallelForÿε̶ֻ߳ٴա
+// һִһ±ԭӼַ߳Ҳ㣬ȫ±ɺ󷵻ء
+// æʱһ̵߳ڲǶ׵ãɵ߳Լ˳ִУ
+class ThreadPool {
+public:
+    // ǰ̵̳߳ءforkӽûи̵Ḷ́߳״ʹʱһ
+    // ʵ˳ʱ߳ڵȴ
+    static ThreadPool& instance() {
+        static std::mutex creation;
+        static ThreadPool* pool = nullptr;
+        std::lock_guard<std::mutex> lock(creation);
+        if (pool == nullptr || pool->owner != getpid()) {
+            pool = new ThreadPool();
+        }
+        return *pool;
+    }
+
+    // threadṣִ̣߳߳fn(0), ..., fn(count - 1)
+    void run(size_t count, unsigned threads, const std::function<void(size_t)>& fn) {
+        std::unique_lock<std::mutex> busy(jobMutex, std::try_to_lock);
+        if (!busy.owns_lock()) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (workers < threads - 1 && workers < MAX_WORKERS) {
+                std::thread(&ThreadPool::workerLoop, this).detach();
+                ++workers;
+            }
+            job = &fn;
+            jobCount = count;
+            next = 0;
+            slots = threads - 1;
+            ++generation;
+        }
+        wake.notify_all();
+        drain();
+        // ٽµḶ́߳Ѽꣻһ߳׳ĵһ쳣ڵ߳׳
+        std::unique_lock<std::mutex> lock(mutex);
+        slots = 0;
+        done.wait(lock, [this] { return running == 0; });
+        job = nullptr;
+        std::exception_ptr thrown = error;
+        error = nullptr;
+        if (thrown) {
+            std::rethrow_exception(thrown);
+        }
+    }
+
+private:
+    static constexpr unsigned MAX_WORKERS = 256;
+
+    pid_t owner = getpid();
+    std::mutex jobMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    unsigned workers = 0;
+    unsigned slots = 0;
+    unsigned running = 0;
+    uint64_t generation = 0;
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> next{ 0 };
+    std::exception_ptr error;
+
+    // ȡִ±ꣻ쳣ʱ²̲߳ȡ
+    void drain() {
+        try {
+            for (size_t i = next.fetch_add(1); i < jobCount; i = next.fetch_add(1)) {
+                (*job)(i);
+            }
+        }
+        catch (...) {
+            next = jobCount;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    void workerLoop() {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return generation != seen; });
+            seen = generation;
+            if (slots == 0) {
+                continue;
+            }
+            --slots;
+            ++running;
+            lock.unlock();
+            drain();
+            lock.lock();
+            if (--running == 0) {
+                done.notify_all();
+            }
+        }
+    }
+};
+
+// ڳפ̳߳ϲִfn(0), ..., fn(count - 1)threadsΪ0ʱȫģΪ1ʱڵ߳˳ִ
+void parallelFor(size_t count, unsigned threads, const std::function<void(size_t)>& fn) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (threads > count) {
+        threads = (unsigned)count;
+    }
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+    ThreadPool::instance().run(count, threads, fn);
+}
+
+// SM3ϣ汾1̶СҶӿ鲢йϣϲ
+// ҶΪSM3(0x00 || )ڲڵΪSM3(0x01 ||  || )ĩڵֱƣRFC6962һ£
+// ժҪΪSM3(0x02 || 汾 || ҶӴС || ܳ || )׼SM3ժҪɻ
+class SM3_Tree {
+public:
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t LEAF_SIZE = 64 * 1024;
+
+    static void hash(const unsigned char* data, size_t len, unsigned char digest[32], unsigned threads = 0) {
+        size_t leaves = (len == 0) ? 1 : (len + LEAF_SIZE - 1) / LEAF_SIZE;
+        std::vector<unsigned char> level(leaves * 32);
+
+        // ҶӲ㣺ÿ8Ҷӣ߶໺ں
+        const unsigned char leafPrefix = 0x00;
+        size_t groups = (leaves + SM3_MB::LANES - 1) / SM3_MB::LANES;
+        parallelFor(groups, threads, [&](size_t g) {
+            size_t first = g * SM3_MB::LANES;
+            if ((first + SM3_MB::LANES) * LEAF_SIZE <= len) {
+                const unsigned char* msg[SM3_MB::LANES];
+                for (int l = 0; l < SM3_MB::LANES; ++l) {
+                    msg[l] = data + (first + l) * LEAF_SIZE;
+                }
+                SM3_MB::hash(&leafPrefix, 1, msg, LEAF_SIZE, (unsigned char(*)[32])&level[first * 32]);
+                return;
+            }
+            for (size_t i = first; i < leaves && i < first + SM3_MB::LANES; ++i) {
+                size_t off = i * LEAF_SIZE;
+                SM3_Optimized sm3;
+                sm3.update(&leafPrefix, 1);
+                sm3.update(data + off, std::min(LEAF_SIZE, len - off));
+                sm3.final(&level[i * 32]);
+            }
+        });
+
+        // ϲժҪùڲڵϢ
+        const unsigned char nodePrefix = 0x01;
+        while (leaves > 1) {
+            size_t pairs = leaves / 2;
+            std::vector<unsigned char> next(((leaves + 1) / 2) * 32);
+            size_t pairGroups = (pairs + SM3_MB::LANES - 1) / SM3_MB::LANES;
+            parallelFor(pairGroups, threads, [&](size_t g) {
+                size_t first = g * SM3_MB::LANES;
+                if (first + SM3_MB::LANES <= pairs) {
+                    const unsigned char* msg[SM3_MB::LANES];
+                    for (int l = 0; l < SM3_MB::LANES; ++l) {
+                        msg[l] = &level[(first + l) * 64];
+                    }
+                    SM3_MB::hash(&nodePrefix, 1, msg, 64, (unsigned char(*)[32])&next[first * 32]);
+                    return;
+                }
+                for (size_t i = first; i < pairs; ++i) {
+                    SM3_Optimized sm3;
+                    sm3.update(&nodePrefix, 1);
+                    sm3.update(&level[i * 64], 64);
+                    sm3.final(&next[i * 32]);
+                }
+            });
+            if (leaves % 2) {
+                memcpy(&next[pairs * 32], &level[(leaves - 1) * 32], 32);
+            }
+            level.swap(next);
+            leaves = (leaves + 1) / 2;
+        }
+
+        // ڵװ󶨰汾šҶӴСϢܳ
+        unsigned char header[14];
+        header[0] = 0x02;
+        header[1] = VERSION;
+        for (int i = 0; i < 4; ++i) {
+            header[2 + i] = ((uint32_t)LEAF_SIZE >> ((3 - i) * 8)) & 0xFF;
+        }
+        for (int i = 0; i < 8; ++i) {
+            header[6 + i] = ((uint64_t)len >> ((7 - i) * 8)) & 0xFF;
+        }
+        SM3_Optimized sm3;
+        sm3.update(header, sizeof(header));
+        sm3.update(&level[0], 32);
+        sm3.final(digest);
+    }
+
+    // ͨmmapӳļйϣreadĿ
+    static bool hashFile(const char* path, unsigned char digest[32], unsigned threads = 0) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return false;
+        }
+
+        size_t len = (size_t)st.st_size;
+        if (len == 0) {
+            close(fd);
+            hash(nullptr, 0, digest, threads);
+            return true;
+        }
+
+        void* mapped = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+        madvise(mapped, len, MADV_WILLNEED);
+        hash((const unsigned char*)mapped, len, digest, threads);
+        munmap(mapped, len);
+        return true;
+    }
+};
+
+// ϣܲ
+void treePerformanceTest() {
+    const int size = 1024 * 1024 * 100; // 100MB
+    unsigned char* data = new unsigned char[size];
+    memset(data, 0x61, size); // 'a'
+    unsigned char digest[32];
+
+    // ߳124...ֱȫ
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (unsigned threads : threadCounts) {
+        auto start = std::chrono::high_resolution_clock::now();
+        SM3_Tree::hash(data, size, digest, threads);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        double speed = (double)size / (1024 * 1024) / (std::max<long long>(duration, 1) / 1000.0);
+        std::cout << "SM3-Tree v" << (int)SM3_Tree::VERSION << " (" << threads << " threads): "
+            << duration << " ms, speed: " << speed << " MB/s" << std::endl;
+    }
+
+    // СϣÿparallelForֻѳפ̣߳ٴ̣߳뵥߳һ
+    const size_t small = 64 * SM3_Tree::LEAF_SIZE;
+    unsigned char single[32], pooled[32];
+    SM3_Tree::hash(data, small, single, 1);
+    bool same = true;
+    auto smallStart = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 100; ++i) {
+        SM3_Tree::hash(data, small, pooled, 4);
+        same = same && memcmp(single, pooled, 32) == 0;
+    }
+    auto smallEnd = std::chrono::high_resolution_clock::now();
+    std::cout << "SM3-Tree 4MB x 100 (4 threads): "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(smallEnd - smallStart).count()
+        << " ms, matches single thread: " << (same ? "yes" : "no") << std::endl;
+
+    // дʱļͨmmapϣӦڴϣһ
+    char path[] = "/tmp/sm3-tree-XXXXXX";
+    int fd = mkstemp(path);
+    FILE* fp = fd >= 0 ? fdopen(fd, "wb") : nullptr;
+    if (fp) {
+        fwrite(data, 1, size, fp);
+        fclose(fp);
+        unsigned char fileDigest[32];
+        auto start = std::chrono::high_resolution_clock::now();
+        bool ok = SM3_Tree::hashFile(path, fileDigest);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        std::cout << "SM3-Tree mmap file: " << duration << " ms, match: "
+            << (ok && memcmp(digest, fileDigest, 32) == 0 ? "yes" : "no") << std::endl;
+        remove(path);
+    }
+    else if (fd >= 0) {
+        close(fd);
+        remove(path);
+    }
+
     delete[] data;
 }
 
+// ̶ǰ׺ϣǰ׺ֻѹһΣ֮ÿϢӻм״̬ʼ
+// ǰ׺һʱм״ֻ̬滺ʡȥǰ׺ظ
+class SM3_Prefixed {
+public:
+    SM3_Prefixed(const unsigned char* prefix, size_t len) {
+        SM3_Optimized sm3;
+        sm3.update(prefix, len);
+        midstate = sm3.exportState();
+    }
+
+    // ǰ׺Ĺϣʽ
+    SM3_Optimized begin() const {
+        SM3_Optimized sm3;
+        sm3.importState(midstate);
+        return sm3;
+    }
+
+    void hash(const unsigned char* data, size_t len, unsigned char digest[32]) const {
+        SM3_Optimized sm3 = begin();
+        sm3.update(data, len);
+        sm3.final(digest);
+    }
+
+    const SM3State& state() const {
+        return midstate;
+    }
+
+private:
+    SM3State midstate;
+};
+
+// չƾSM3(secret)secretȣαSM3(secret || padding || extension)
+void lengthExtensionAttack() {
+    const std::string secret = "secret_data";
+    const std::string extension = "malicious_extension";
+
+    unsigned char originalHash[32];
+    SM3_Optimized sm3;
+    sm3.update((const unsigned char*)secret.data(), secret.size());
+    sm3.final(originalHash);
+
+    // ߹ԭϢ䣺0x800x0064λس
+    std::string padding(1, '\x80');
+    padding.append((56 - (secret.size() + 1) % 64) % 64, '\0');
+    uint64_t bitCount = (uint64_t)secret.size() * 8;
+    for (int i = 0; i < 8; ++i) {
+        padding.push_back((char)((bitCount >> ((7 - i) * 8)) & 0xFF));
+    }
+
+    // ԭϣΪм״̬ѹչݣ¹ϣԭϢ
+    SM3_Optimized forger;
+    forger.importState(SM3State::fromDigest(originalHash, secret.size() + padding.size()));
+    forger.update((const unsigned char*)extension.data(), extension.size());
+    unsigned char forgedHash[32];
+    forger.final(forgedHash);
+
+    // ֱ֤ӼϢʵϣ
+    std::string newMessage = secret + padding + extension;
+    unsigned char realHash[32];
+    sm3.reset();
+    sm3.update((const unsigned char*)newMessage.data(), newMessage.size());
+    sm3.final(realHash);
+
+    std::cout << "Original hash: ";
+    for (int i = 0; i < 32; ++i) {
+        std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)originalHash[i];
+    }
+    std::cout << "\nPredicted new hash: ";
+    for (int i = 0; i < 32; ++i) {
+        std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)forgedHash[i];
+    }
+    std::cout << "\nActual new hash: ";
+    for (int i = 0; i < 32; ++i) {
+        std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)realHash[i];
+    }
+    std::cout << std::dec << std::endl;
+
+    if (memcmp(forgedHash, realHash, 32) == 0) {
+        std::cout << "Length extension attack successful!" << std::endl;
+    }
+    else {
+        std::cout << "Length extension attack failed!" << std::endl;
+    }
+}
+
+// ǰ׺ܲԣ64ֽǰ׺ + 32ֽϢԱÿ¹ϣǰ׺
+void prefixPerformanceTest() {
+    const int iterations = 1000000;
+    unsigned char prefix[64];
+    memset(prefix, 0x36, sizeof(prefix));
+    unsigned char message[32];
+    memset(message, 0x61, sizeof(message));
+    unsigned char naiveDigest[32];
+    unsigned char cachedDigest[32];
+
+    // м״̬лٻָӦһ
+    SM3_Prefixed prefixed(prefix, sizeof(prefix));
+    unsigned char serialized[SM3State::SERIALIZED_SIZE];
+    prefixed.state().serialize(serialized);
+    SM3State restored;
+    restored.deserialize(serialized);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        message[0] = (unsigned char)i;
+        SM3_Optimized sm3;
+        sm3.update(prefix, sizeof(prefix));
+        sm3.update(message, sizeof(message));
+        sm3.final(naiveDigest);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto naiveTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        message[0] = (unsigned char)i;
+        prefixed.hash(message, sizeof(message), cachedDigest);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    auto cachedTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    SM3_Optimized resumed;
+    resumed.importState(restored);
+    resumed.update(message, sizeof(message));
+    unsigned char resumedDigest[32];
+    resumed.final(resumedDigest);
+
+    std::cout << "Prefix re-hash: " << naiveTime << " ms, cached midstate: " << cachedTime
+        << " ms (" << iterations << " messages)" << std::endl;
+    std::cout << "Midstate match: "
+        << (memcmp(naiveDigest, cachedDigest, 32) == 0 && memcmp(cachedDigest, resumedDigest, 32) == 0 ? "yes" : "no")
+        << std::endl;
+}
+
+// HMAC-SM3ԿԤѹ K^ipad  K^opad 飬
+// ÿϢֻѹϢһ
+class HMAC_SM3 {
+public:
+    HMAC_SM3(const unsigned char* key, size_t keyLen) {
+        // 鳤ȵԿȹϣ
+        unsigned char k[64] = { 0 };
+        if (keyLen > 64) {
+            SM3_Optimized sm3;
+            sm3.update(key, keyLen);
+            sm3.final(k);
+        }
+        else {
+            memcpy(k, key, keyLen);
+        }
+
+        unsigned char pad[64];
+        for (int i = 0; i < 64; ++i) {
+            pad[i] = k[i] ^ 0x36;
+        }
+        SM3_Optimized sm3;
+        sm3.update(pad, 64);
+        inner = sm3.exportState();
+
+        for (int i = 0; i < 64; ++i) {
+            pad[i] = k[i] ^ 0x5C;
+        }
+        sm3.reset();
+        sm3.update(pad, 64);
+        outer = sm3.exportState();
+
+        memset(k, 0, sizeof(k));
+        memset(pad, 0, sizeof(pad));
+    }
+
+    void mac(const unsigned char* data, size_t len, unsigned char tag[32]) const {
+        unsigned char innerHash[32];
+        SM3_Optimized sm3;
+        sm3.importState(inner);
+        sm3.update(data, len);
+        sm3.final(innerHash);
+
+        sm3.importState(outer);
+        sm3.update(innerHash, 32);
+        sm3.final(tag);
+    }
+
+    // ǩȽϲǰ˳й¶ƥֽ
+    bool verify(const unsigned char* data, size_t len, const unsigned char tag[32]) const {
+        unsigned char expected[32];
+        mac(data, len, expected);
+        return equalTags(expected, tag);
+    }
+
+    // 㣺countȳϢÿ8һ龭໺ں˼ڲϣ
+    void macBatch(const unsigned char* const msg[], size_t count, size_t len, unsigned char tags[][32]) const {
+        size_t full = count - count % SM3_MB::LANES;
+        for (size_t i = 0; i < full; i += SM3_MB::LANES) {
+            unsigned char innerHash[SM3_MB::LANES][32];
+            const unsigned char* innerPtr[SM3_MB::LANES];
+            SM3_MB::hash(inner, msg + i, len, innerHash);
+            for (int l = 0; l < SM3_MB::LANES; ++l) {
+                innerPtr[l] = innerHash[l];
+            }
+            SM3_MB::hash(outer, innerPtr, 32, (unsigned char(*)[32])tags[i]);
+        }
+        for (size_t i = full; i < count; ++i) {
+            mac(msg[i], len, tags[i]);
+        }
+    }
+
+    // ֤дvalid[i]֤ͨ
+    size_t verifyBatch(const unsigned char* const msg[], size_t count, size_t len,
+        const unsigned char tags[][32], bool valid[]) const {
+        std::unique_ptr<unsigned char[][32]> expected(new unsigned char[count][32]);
+        macBatch(msg, count, len, expected.get());
+        size_t passed = 0;
+        for (size_t i = 0; i < count; ++i) {
+            valid[i] = equalTags(expected[i], tags[i]);
+            passed += valid[i];
+        }
+        return passed;
+    }
+
+private:
+    SM3State inner;
+    SM3State outer;
+
+    static bool equalTags(const unsigned char* a, const unsigned char* b) {
+        unsigned char diff = 0;
+        for (int i = 0; i < 32; ++i) {
+            diff |= a[i] ^ b[i];
+        }
+        return diff == 0;
+    }
+};
+
+// SM3ԿGB/T 32918.4K = SM3(Z || 1) || SM3(Z || 2) || ...ȡǰklenֽ
+// ZֻһΣÿ8һ龭໺ں˲ѹ
+void sm3KDF(const unsigned char* z, size_t zLen, unsigned char* out, size_t klen) {
+    SM3_Prefixed prefixed(z, zLen);
+    size_t blocks = (klen + 31) / 32;
+    uint32_t ct = 1;
+
+    size_t i = 0;
+    for (; i + SM3_MB::LANES <= blocks; i += SM3_MB::LANES) {
+        unsigned char counters[SM3_MB::LANES][4];
+        const unsigned char* msg[SM3_MB::LANES];
+        for (int l = 0; l < SM3_MB::LANES; ++l, ++ct) {
+            counters[l][0] = (ct >> 24) & 0xFF;
+            counters[l][1] = (ct >> 16) & 0xFF;
+            counters[l][2] = (ct >> 8) & 0xFF;
+            counters[l][3] = ct & 0xFF;
+            msg[l] = counters[l];
+        }
+        unsigned char digest[SM3_MB::LANES][32];
+        SM3_MB::hash(prefixed.state(), msg, 4, digest);
+        size_t n = std::min<size_t>(klen - i * 32, sizeof(digest));
+        memcpy(out + i * 32, digest, n);
+    }
+
+    for (; i < blocks; ++i, ++ct) {
+        unsigned char counter[4] = {
+            (unsigned char)(ct >> 24), (unsigned char)(ct >> 16), (unsigned char)(ct >> 8), (unsigned char)ct
+        };
+        unsigned char digest[32];
+        prefixed.hash(counter, 4, digest);
+        memcpy(out + i * 32, digest, std::min<size_t>(klen - i * 32, 32));
+    }
+}
+
+// HMACKDFܲԣԱÿ¹ϣipad/opadZع
+void hmacKdfPerformanceTest() {
+    const int iterations = 1000000;
+    const unsigned char key[] = "0123456789abcdef0123456789abcdef";
+    const size_t keyLen = 32;
+    const size_t tokenLen = 48;
+
+    std::vector<unsigned char> tokens(iterations * tokenLen);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        tokens[i] = (unsigned char)(i * 131 + 7);
+    }
+    std::vector<const unsigned char*> msg(iterations);
+    for (int i = 0; i < iterations; ++i) {
+        msg[i] = &tokens[i * tokenLen];
+    }
+    std::vector<unsigned char> naiveTags(iterations * 32);
+    std::vector<unsigned char> tags(iterations * 32);
+
+    // HMACÿϢѹ K^ipad  K^opad
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        unsigned char ipad[64] = { 0 };
+        unsigned char opad[64] = { 0 };
+        memcpy(ipad, key, keyLen);
+        memcpy(opad, key, keyLen);
+        for (int j = 0; j < 64; ++j) {
+            ipad[j] ^= 0x36;
+            opad[j] ^= 0x5C;
+        }
+        unsigned char innerHash[32];
+        SM3_Optimized sm3;
+        sm3.update(ipad, 64);
+        sm3.update(msg[i], tokenLen);
+        sm3.final(innerHash);
+        sm3.reset();
+        sm3.update(opad, 64);
+        sm3.update(innerHash, 32);
+        sm3.final(&naiveTags[i * 32]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto naiveTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    HMAC_SM3 hmac(key, keyLen);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        hmac.mac(msg[i], tokenLen, &tags[i * 32]);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    auto cachedTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    bool cachedMatch = (naiveTags == tags);
+
+    start = std::chrono::high_resolution_clock::now();
+    std::unique_ptr<bool[]> valid(new bool[iterations]);
+    size_t passed = hmac.verifyBatch(msg.data(), iterations, tokenLen, (const unsigned char(*)[32])naiveTags.data(), valid.get());
+    end = std::chrono::high_resolution_clock::now();
+    auto batchTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    std::cout << "HMAC-SM3 naive: " << naiveTime << " ms, cached ipad/opad: " << cachedTime
+        << " ms, batch verify: " << batchTime << " ms (" << iterations << " tokens)" << std::endl;
+    std::cout << "HMAC-SM3 match: " << (cachedMatch && passed == (size_t)iterations ? "yes" : "no") << std::endl;
+
+    // KDF64ֽZSM2x2||y21MBԿ
+    unsigned char z[64];
+    memset(z, 0x5A, sizeof(z));
+    const size_t klen = 1024 * 1024;
+    std::vector<unsigned char> naiveKey(klen);
+    std::vector<unsigned char> fastKey(klen);
+
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0, ct = 1; i < klen; i += 32, ++ct) {
+        unsigned char counter[4] = {
+            (unsigned char)(ct >> 24), (unsigned char)(ct >> 16), (unsigned char)(ct >> 8), (unsigned char)ct
+        };
+        unsigned char digest[32];
+        SM3_Optimized sm3;
+        sm3.update(z, sizeof(z));
+        sm3.update(counter, 4);
+        sm3.final(digest);
+        memcpy(&naiveKey[i], digest, std::min<size_t>(32, klen - i));
+    }
+    end = std::chrono::high_resolution_clock::now();
+    auto naiveKdfTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    sm3KDF(z, sizeof(z), fastKey.data(), klen);
+    end = std::chrono::high_resolution_clock::now();
+    auto fastKdfTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    std::cout << "SM3-KDF 1MB naive: " << naiveKdfTime << " us, midstate + multi-buffer: " << fastKdfTime
+        << " us, match: " << (naiveKey == fastKey ? "yes" : "no") << std::endl;
+}
+
+// ļʱSM3_NO_MAIN
+#ifndef SM3_NO_MAIN
 int main() {
     testSM3();
     performanceTest();
     comparePerformance();
+    fragmentPerformanceTest();
+    treePerformanceTest();
+    lengthExtensionAttack();
+    prefixPerformanceTest();
+    hmacKdfPerformanceTest();
     return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,430 @@
+// SM2ǩ/֤񣺹ȡ̳߳ + ֤Ӧ
+#define SM2_NO_MAIN
+#include "SM2.cpp"
+
+#include <condition_variable>
+#include <future>
+
+// ȡ̳߳أÿ߳ԼУԼβȡύݻڻУ
+// ԼĶΪʱ̶߳еͷȡⲿ߳ύʱתɢ
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    // threads = 0ʾʹȫ
+    explicit WorkStealingPool(unsigned threads) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (unsigned i = 0; i < threads; ++i) {
+            queues.emplace_back(new Queue());
+        }
+        for (unsigned i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i] { run(i); });
+        }
+    }
+
+    // ִύȫ˳
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    void submit(Task task) {
+        size_t index = currentPool == this ? currentIndex : next++ % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        pending++;
+        // ֪ͨҪ˯ߵ̴߳
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_one();
+    }
+
+    unsigned size() const {
+        return (unsigned)workers.size();
+    }
+
+    uint64_t steals() const {
+        return stolen;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> pending{ 0 };
+    std::atomic<size_t> next{ 0 };
+    std::atomic<uint64_t> stolen{ 0 };
+    bool stopping = false;
+
+    static thread_local WorkStealingPool* currentPool;
+    static thread_local size_t currentIndex;
+
+    bool take(size_t self, Task& task) {
+        {
+            Queue& own = *queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); ++k) {
+            Queue& victim = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                stolen++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(size_t self) {
+        currentPool = this;
+        currentIndex = self;
+        for (;;) {
+            Task task;
+            if (take(self, task)) {
+                pending--;
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || pending > 0; });
+            if (stopping && pending == 0) {
+                return;
+            }
+        }
+    }
+};
+
+thread_local WorkStealingPool* WorkStealingPool::currentPool = nullptr;
+thread_local size_t WorkStealingPool::currentIndex = 0;
+
+// ǩ/֤ǩֱΪִУ֤УflushÿȡmaxBatch֤
+// ʱһҲ̱ȡߣӳٵͣæʱڶлۣȻ¸ߣ
+// ÿ߳Լ֤ʱռ䣬ԤȺ֤·ϵĵ鲻ٷڴ
+class SM2_Service {
+public:
+    SM2_Service(unsigned threads, size_t maxBatch = 256) : maxBatch(std::max<size_t>(1, maxBatch)), pool(threads) {}
+
+    // ʱȵȴɣ֮пܻʣյflushpoolִ겢߳
+    ~SM2_Service() {
+        drain();
+    }
+
+    void sign(std::shared_ptr<const SM2_SignerContext> signer, std::string message,
+        std::function<void(const SM2_Signature&)> done) {
+        begin();
+        pool.submit([this, signer, message, done] {
+            done(signer->sign((const unsigned char*)message.data(), message.size()));
+            end();
+        });
+    }
+
+    std::future<SM2_Signature> submitSign(std::shared_ptr<const SM2_SignerContext> signer, std::string message) {
+        auto promise = std::make_shared<std::promise<SM2_Signature>>();
+        std::future<SM2_Signature> result = promise->get_future();
+        sign(std::move(signer), std::move(message), [promise](const SM2_Signature& sig) { promise->set_value(sig); });
+        return result;
+    }
+
+    // entry.eΪõ SM3(Z || M) mod nSM2_VerifierContext::digest
+    void verify(const SM2_BatchEntry& entry, std::function<void(bool)> done) {
+        begin();
+        size_t flushes = 0;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            waiting.push_back(PendingVerify{ entry, std::move(done) });
+            // ûŶеflushʱһÿһٶһ̲߳д
+            if (!flushScheduled) {
+                flushScheduled = true;
+                flushes = 1;
+            }
+            else if (waiting.size() % maxBatch == 0) {
+                flushes = 1;
+            }
+        }
+        if (flushes) {
+            pool.submit([this] { flush(); });
+        }
+    }
+
+    std::future<bool> submitVerify(const SM2_BatchEntry& entry) {
+        auto promise = std::make_shared<std::promise<bool>>();
+        std::future<bool> result = promise->get_future();
+        verify(entry, [promise](bool valid) { promise->set_value(valid); });
+        return result;
+    }
+
+    std::future<bool> submitVerify(const SM2_VerifierContext& verifier, const unsigned char* msg, size_t len,
+        const SM2_Signature& sig) {
+        return submitVerify(SM2_BatchEntry{ verifier.publicKey(), verifier.digest(msg, len), sig });
+    }
+
+    // ȴύȫ
+    void drain() {
+        std::unique_lock<std::mutex> lock(outstandingMutex);
+        idle.wait(lock, [this] { return outstanding == 0; });
+    }
+
+    uint64_t batches() const {
+        return batchCount;
+    }
+
+    uint64_t batchedVerifies() const {
+        return verifyCount;
+    }
+
+    uint64_t steals() const {
+        return pool.steals();
+    }
+
+private:
+    struct PendingVerify {
+        SM2_BatchEntry entry;
+        std::function<void(bool)> done;
+    };
+
+    size_t maxBatch;
+    std::mutex queueMutex;
+    std::deque<PendingVerify> waiting;
+    bool flushScheduled = false;
+    std::mutex outstandingMutex;
+    std::condition_variable idle;
+    size_t outstanding = 0;
+    std::atomic<uint64_t> batchCount{ 0 };
+    std::atomic<uint64_t> verifyCount{ 0 };
+    // һԱִ߳ʣʱԱȻЧ
+    WorkStealingPool pool;
+
+    void begin() {
+        std::lock_guard<std::mutex> lock(outstandingMutex);
+        ++outstanding;
+    }
+
+    void end(size_t count = 1) {
+        std::lock_guard<std::mutex> lock(outstandingMutex);
+        outstanding -= count;
+        if (outstanding == 0) {
+            idle.notify_all();
+        }
+    }
+
+    void flush() {
+        // ÿ̵߳ʱռ䣺֤뱾ڵ֮临
+        thread_local SM2_BatchScratch scratch;
+        thread_local std::vector<PendingVerify> batch;
+        thread_local std::vector<SM2_BatchEntry> entries;
+        thread_local std::unique_ptr<bool[]> valid;
+        thread_local size_t validSize = 0;
+
+        batch.clear();
+        bool more = false;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            size_t n = std::min(maxBatch, waiting.size());
+            for (size_t i = 0; i < n; ++i) {
+                batch.push_back(std::move(waiting.front()));
+                waiting.pop_front();
+            }
+            more = !waiting.empty();
+            flushScheduled = more;
+        }
+        if (more) {
+            pool.submit([this] { flush(); });
+        }
+        if (batch.empty()) {
+            return;
+        }
+
+        entries.clear();
+        for (const PendingVerify& p : batch) {
+            entries.push_back(p.entry);
+        }
+        if (validSize < batch.size()) {
+            validSize = std::max(batch.size(), maxBatch);
+            valid.reset(new bool[validSize]);
+        }
+        sm2VerifyBatch(entries.data(), entries.size(), valid.get(), scratch);
+        batchCount++;
+        verifyCount += batch.size();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            batch[i].done(valid[i]);
+        }
+        size_t finished = batch.size();
+        batch.clear();
+        end(finished);
+    }
+};
+
+// ȴcountص
+class CompletionLatch {
+public:
+    explicit CompletionLatch(size_t count) : remaining(count) {}
+
+    void countDown() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--remaining == 0) {
+            done.notify_all();
+        }
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return remaining == 0; });
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining;
+};
+
+// countǩ֤signersǩǩ
+std::vector<SM2_BatchEntry> makeRequests(size_t count, size_t signers) {
+    std::vector<std::shared_ptr<SM2_SignerContext>> contexts;
+    const std::string id = "client@example.com";
+    for (size_t i = 0; i < signers; ++i) {
+        contexts.push_back(std::make_shared<SM2_SignerContext>(SM2_Key::generate(), (const unsigned char*)id.data(),
+            id.size()));
+    }
+    std::vector<SM2_BatchEntry> entries(count);
+    for (size_t i = 0; i < count; ++i) {
+        const SM2_SignerContext& signer = *contexts[i % signers];
+        std::string message = "POST /api/orders/" + std::to_string(i);
+        entries[i].pub = signer.signingKey().pub;
+        entries[i].e = signer.digest((const unsigned char*)message.data(), message.size());
+        entries[i].sig = signer.sign((const unsigned char*)message.data(), message.size());
+    }
+    return entries;
+}
+
+// ܲԣfutureʽǩ֤۸ĵǩܾ
+void testService() {
+    SM2_Service service(std::max(2u, std::thread::hardware_concurrency()));
+    std::vector<SM2_BatchEntry> entries = makeRequests(300, 4);
+    for (size_t i = 0; i < entries.size(); i += 7) {
+        entries[i].sig.s = SM2_Fn::add(entries[i].sig.s, SM2_Fn::one());
+    }
+    std::vector<std::future<bool>> results;
+    for (const SM2_BatchEntry& e : entries) {
+        results.push_back(service.submitVerify(e));
+    }
+    int bad = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        bad += results[i].get() != (i % 7 != 0);
+    }
+
+    SM2_Key key = SM2_Key::generate();
+    const std::string id = "alice@example.com";
+    auto signer = std::make_shared<const SM2_SignerContext>(key, (const unsigned char*)id.data(), id.size());
+    SM2_VerifierContext verifier((const unsigned char*)id.data(), id.size(), key.pub);
+    std::vector<std::future<SM2_Signature>> sigs;
+    for (int i = 0; i < 50; ++i) {
+        sigs.push_back(service.submitSign(signer, "message " + std::to_string(i)));
+    }
+    for (int i = 0; i < 50; ++i) {
+        std::string message = "message " + std::to_string(i);
+        bad += !service.submitVerify(verifier, (const unsigned char*)message.data(), message.size(), sigs[i].get())
+            .get();
+    }
+    std::cout << "Service results: " << (bad == 0 ? "all correct" : "FAILED") << " (" << service.batches()
+        << " batches for " << service.batchedVerifies() << " verifies)" << std::endl;
+
+    // threads = 0ʹȫ
+    SM2_Service allCores(0);
+    std::string message = "message 0";
+    SM2_Signature sig = allCores.submitSign(signer, message).get();
+    bool ok = allCores.submitVerify(verifier, (const unsigned char*)message.data(), message.size(), sig).get();
+    std::cout << "Service with 0 threads (all cores): " << (ok ? "ok" : "FAILED") << std::endl;
+}
+
+// ߳ı仯һύȫ󣬵ȴ
+void scalingTest() {
+    std::vector<SM2_BatchEntry> entries = makeRequests(4096, 64);
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Hardware threads: " << cores << std::endl;
+    // ߳ȡ1, 2, 4, ...ֱ
+    std::vector<unsigned> counts;
+    for (unsigned threads = 1; threads < cores; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(cores);
+    double base = 0;
+    for (unsigned threads : counts) {
+        SM2_Service service(threads);
+        CompletionLatch latch(entries.size());
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const SM2_BatchEntry& e : entries) {
+            service.verify(e, [&latch](bool) { latch.countDown(); });
+        }
+        latch.wait();
+        auto end = std::chrono::high_resolution_clock::now();
+        double rate = entries.size() / std::chrono::duration<double>(end - start).count();
+        if (threads == 1) {
+            base = rate;
+        }
+        std::cout << threads << " thread(s): " << rate << " verifications/s (" << rate / base << "x), "
+            << service.batches() << " batches, " << service.steals() << " steals" << std::endl;
+    }
+}
+
+// ͻµβӳ٣ÿintervalһԵburst֤󣬼¼ÿύصʱ
+void burstLatencyTest() {
+    const size_t burst = 128;
+    const int bursts = 16;
+    std::vector<SM2_BatchEntry> entries = makeRequests(burst, 16);
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t maxBatch : { (size_t)1, (size_t)256 }) {
+        SM2_Service service(threads, maxBatch);
+        std::vector<double> latencies(burst * bursts);
+        CompletionLatch latch(latencies.size());
+        // ͻ֤ĺʱ㣬ʹƽԼΪ֤߳һ
+        auto interval = std::chrono::microseconds(burst * 400 / threads);
+        auto start = std::chrono::steady_clock::now();
+        for (int b = 0; b < bursts; ++b) {
+            std::this_thread::sleep_until(start + b * interval);
+            for (size_t i = 0; i < burst; ++i) {
+                size_t slot = b * burst + i;
+                auto submitted = std::chrono::steady_clock::now();
+                service.verify(entries[i], [&latencies, &latch, slot, submitted](bool) {
+                    latencies[slot] = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - submitted).count();
+                    latch.countDown();
+                });
+            }
+        }
+        latch.wait();
+        std::sort(latencies.begin(), latencies.end());
+        auto pct = [&latencies](double p) { return latencies[(size_t)(p * (latencies.size() - 1))]; };
+        std::cout << "Burst latency (max batch " << maxBatch << "): p50 " << pct(0.5) << " ms, p99 " << pct(0.99)
+            << " ms, max " << latencies.back() << " ms, " << service.batches() << " batches" << std::endl;
+    }
+}
+
+int main() {
+    testService();
+    scalingTest();
+    burstLatencyTest();
+    return 0;
+}
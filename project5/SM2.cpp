@@ -0,0 +1,3081 @@
+// SM4-DRBG.cppproject4SM3ʵ
+#define SM4_DRBG_NO_MAIN
+#include "../project1/SM4-DRBG.cpp"
+
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <dirent.h>
+#include <sys/wait.h>
+#ifdef SM2_CT_VALGRIND
+#include <valgrind/memcheck.h>
+#endif
+
+typedef unsigned __int128 uint128_t;
+
+// 256λĳ㣨С464λlimbڱƵMontgomery
+struct U256Const {
+    // -m^-1 mod 2^64ţٵ
+    static constexpr uint64_t negInv(uint64_t m) {
+        uint64_t x = 1;
+        for (int i = 0; i < 6; ++i) {
+            x *= 2 - m * x;
+        }
+        return 0 - x;
+    }
+
+    // 2^512 mod m2^256 - mʼ256
+    static constexpr std::array<uint64_t, 4> rSquared(const uint64_t m[4]) {
+        std::array<uint64_t, 4> r = {};
+        uint64_t borrow = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint128_t d = (uint128_t)0 - m[i] - borrow;
+            r[i] = (uint64_t)d;
+            borrow = (uint64_t)(d >> 64) & 1;
+        }
+        for (int k = 0; k < 256; ++k) {
+            uint64_t top = r[3] >> 63;
+            for (int i = 3; i > 0; --i) {
+                r[i] = (r[i] << 1) | (r[i - 1] >> 63);
+            }
+            r[0] <<= 1;
+            if (top || !lessThan(r.data(), m)) {
+                borrow = 0;
+                for (int i = 0; i < 4; ++i) {
+                    uint128_t d = (uint128_t)r[i] - m[i] - borrow;
+                    r[i] = (uint64_t)d;
+                    borrow = (uint64_t)(d >> 64) & 1;
+                }
+            }
+        }
+        return r;
+    }
+
+    static constexpr bool lessThan(const uint64_t a[4], const uint64_t b[4]) {
+        for (int i = 3; i >= 0; --i) {
+            if (a[i] != b[i]) {
+                return a[i] < b[i];
+            }
+        }
+        return false;
+    }
+};
+
+// SM2ƼߵpnСlimb
+// SPECIAL_FORMp = 2^256 - 2^224 - 2^96 + 2^64 - 1-p^-1 mod 2^64 = 1
+// Լʱm*pֻλӼɵõ
+struct SM2_P {
+    static constexpr bool SPECIAL_FORM = true;
+    static constexpr uint64_t MOD[4] = { 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFF00000000, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFEFFFFFFFF };
+};
+
+struct SM2_N {
+    static constexpr bool SPECIAL_FORM = false;
+    static constexpr uint64_t MOD[4] = { 0x53BBF40939D54123, 0x7203DF6B21C6052B, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFEFFFFFFFF };
+};
+
+// 256λMontgomery㣺ԪR = 2^256Montgomeryʽ464λlimb
+// -MOD^-1 mod 2^64R^2 mod MODڱӼԼѡ޷֧
+// 㶼constexprڣԤ__int128Ŀֲʵ֣
+// mulx/adcʵ֣512λ˻ԼSM2ԼҪ˷
+template <class Params>
+class MontField {
+public:
+    struct Elem {
+        uint64_t v[4];
+    };
+
+    static constexpr const uint64_t* MOD = Params::MOD;
+    static constexpr uint64_t N0 = U256Const::negInv(Params::MOD[0]);
+    static constexpr std::array<uint64_t, 4> RR = U256Const::rSquared(Params::MOD);
+
+    static constexpr Elem zero() {
+        return Elem{ { 0, 0, 0, 0 } };
+    }
+
+    static constexpr Elem one() {
+        return fromInt(1);
+    }
+
+    // ͨС2^256תΪMontgomeryʽ
+    static constexpr Elem fromInt(const uint64_t a[4]) {
+        Elem t = { { a[0], a[1], a[2], a[3] } };
+        t = reduceOnce(t, 0);
+        return mul(t, Elem{ { RR[0], RR[1], RR[2], RR[3] } });
+    }
+
+    static constexpr Elem fromInt(uint64_t a) {
+        const uint64_t t[4] = { a, 0, 0, 0 };
+        return fromInt(t);
+    }
+
+    static constexpr void toInt(const Elem& a, uint64_t out[4]) {
+        Elem t = mul(a, Elem{ { 1, 0, 0, 0 } });
+        for (int i = 0; i < 4; ++i) {
+            out[i] = t.v[i];
+        }
+    }
+
+    // 32ֽڴ˱룻Сģʱfalse
+    static bool fromBytes(const unsigned char in[32], Elem& out) {
+        uint64_t t[4];
+        for (int i = 0; i < 4; ++i) {
+            t[3 - i] = 0;
+            for (int j = 0; j < 8; ++j) {
+                t[3 - i] = (t[3 - i] << 8) | in[i * 8 + j];
+            }
+        }
+        if (!U256Const::lessThan(t, MOD)) {
+            return false;
+        }
+        out = fromInt(t);
+        return true;
+    }
+
+    // 32ֽڴģԼ򣨹ϣֵת
+    static Elem fromBytesReduce(const unsigned char in[32]) {
+        uint64_t t[4];
+        for (int i = 0; i < 4; ++i) {
+            t[3 - i] = 0;
+            for (int j = 0; j < 8; ++j) {
+                t[3 - i] = (t[3 - i] << 8) | in[i * 8 + j];
+            }
+        }
+        return fromInt(t);
+    }
+
+    static void toBytes(const Elem& a, unsigned char out[32]) {
+        uint64_t t[4];
+        toInt(a, t);
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 8; ++j) {
+                out[i * 8 + j] = (unsigned char)(t[3 - i] >> (56 - j * 8));
+            }
+        }
+    }
+
+    static constexpr Elem add(const Elem& a, const Elem& b) {
+        return __builtin_is_constant_evaluated() ? addPortable(a, b) : addFast(a, b);
+    }
+
+    static constexpr Elem sub(const Elem& a, const Elem& b) {
+        return __builtin_is_constant_evaluated() ? subPortable(a, b) : subFast(a, b);
+    }
+
+    static constexpr Elem neg(const Elem& a) {
+        return sub(zero(), a);
+    }
+
+    static constexpr Elem dbl(const Elem& a) {
+        return add(a, a);
+    }
+
+    // Montgomery˷ a*b*R^-1 mod MOD
+    static constexpr Elem mul(const Elem& a, const Elem& b) {
+        return __builtin_is_constant_evaluated() ? mulPortable(a, b) : mulFast(a, b);
+    }
+
+    static constexpr Elem sqr(const Elem& a) {
+        return __builtin_is_constant_evaluated() ? mulPortable(a, a) : sqrFast(a);
+    }
+
+    static constexpr Elem sqrN(Elem a, int n) {
+        for (int i = 0; i < n; ++i) {
+            a = sqr(a);
+        }
+        return a;
+    }
+
+    // a^eeΪָ4λ̶ڣֻe
+    static constexpr Elem pow(const Elem& a, const uint64_t e[4]) {
+        Elem table[16] = {};
+        table[0] = one();
+        for (int i = 1; i < 16; ++i) {
+            table[i] = mul(table[i - 1], a);
+        }
+        Elem r = one();
+        for (int i = 63; i >= 0; --i) {
+            r = sqrN(r, 4);
+            r = mul(r, table[(e[i / 16] >> ((i % 16) * 4)) & 15]);
+        }
+        return r;
+    }
+
+    // С a^(MOD-2)a = 0ʱΪ0
+    static constexpr Elem inv(const Elem& a) {
+        uint64_t e[4] = { MOD[0] - 2, MOD[1], MOD[2], MOD[3] };
+        return pow(a, e);
+    }
+
+    // ʱȽ
+    static constexpr bool isZero(const Elem& a) {
+        return ((a.v[0] | a.v[1] | a.v[2] | a.v[3]) == 0);
+    }
+
+    static constexpr bool equal(const Elem& a, const Elem& b) {
+        return ((a.v[0] ^ b.v[0]) | (a.v[1] ^ b.v[1]) | (a.v[2] ^ b.v[2]) | (a.v[3] ^ b.v[3])) == 0;
+    }
+
+    // maskȫ1ʱȡaȫ0ʱȡb
+    static constexpr Elem select(uint64_t mask, const Elem& a, const Elem& b) {
+        Elem r = {};
+        for (int i = 0; i < 4; ++i) {
+            r.v[i] = (a.v[i] & mask) | (b.v[i] & ~mask);
+        }
+        return r;
+    }
+
+private:
+    // ֲʵֵ֣
+    static constexpr Elem addPortable(const Elem& a, const Elem& b) {
+        Elem r = {};
+        uint64_t carry = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint128_t s = (uint128_t)a.v[i] + b.v[i] + carry;
+            r.v[i] = (uint64_t)s;
+            carry = (uint64_t)(s >> 64);
+        }
+        return reduceOnce(r, carry);
+    }
+
+    static constexpr Elem subPortable(const Elem& a, const Elem& b) {
+        Elem r = {};
+        uint64_t borrow = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint128_t d = (uint128_t)a.v[i] - b.v[i] - borrow;
+            r.v[i] = (uint64_t)d;
+            borrow = (uint64_t)(d >> 64) & 1;
+        }
+        // λʱӻģ
+        uint64_t mask = 0 - borrow;
+        uint64_t carry = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint128_t s = (uint128_t)r.v[i] + (MOD[i] & mask) + carry;
+            r.v[i] = (uint64_t)s;
+            carry = (uint64_t)(s >> 64);
+        }
+        return r;
+    }
+
+    // ˻ɨ裺ۼa_i*b_j4Լ
+    static constexpr Elem mulPortable(const Elem& a, const Elem& b) {
+        uint64_t t[9] = {};
+        uint128_t acc = 0;
+        uint64_t high = 0;
+        for (int k = 0; k < 7; ++k) {
+            for (int i = k < 4 ? 0 : k - 3; i <= k && i < 4; ++i) {
+                uint128_t p = (uint128_t)a.v[i] * b.v[k - i];
+                acc += p;
+                high += acc < p;
+            }
+            t[k] = (uint64_t)acc;
+            acc = (acc >> 64) | ((uint128_t)high << 64);
+            high = 0;
+        }
+        t[7] = (uint64_t)acc;
+        for (int i = 0; i < 4; ++i) {
+            uint64_t m = t[i] * N0;
+            uint64_t c = 0;
+            for (int j = 0; j < 4; ++j) {
+                uint128_t s = (uint128_t)m * MOD[j] + t[i + j] + c;
+                t[i + j] = (uint64_t)s;
+                c = (uint64_t)(s >> 64);
+            }
+            for (int j = i + 4; c != 0 && j < 9; ++j) {
+                uint128_t s = (uint128_t)t[j] + c;
+                t[j] = (uint64_t)s;
+                c = (uint64_t)(s >> 64);
+            }
+        }
+        return reduceOnce(Elem{ { t[4], t[5], t[6], t[7] } }, t[8]);
+    }
+
+    // ʵ֣˻Լ򴰿ڶھֲУ±굼µڴ
+    static inline __attribute__((always_inline)) Elem mulFast(const Elem& a, const Elem& b) {
+        unsigned long long t0, t1, t2, t3, t4, t5, t6, t7;
+        mul512(a, b, t0, t1, t2, t3, t4, t5, t6, t7);
+        return redc(t0, t1, t2, t3, t4, t5, t6, t7);
+    }
+
+    static inline __attribute__((always_inline)) Elem sqrFast(const Elem& a) {
+        unsigned long long t0, t1, t2, t3, t4, t5, t6, t7;
+        sqr512(a, t0, t1, t2, t3, t4, t5, t6, t7);
+        return redc(t0, t1, t2, t3, t4, t5, t6, t7);
+    }
+
+    // it[i..i+4] += a * b_i
+    static inline __attribute__((always_inline)) void mulRow(const Elem& a, unsigned long long bi,
+        unsigned long long& r0, unsigned long long& r1, unsigned long long& r2, unsigned long long& r3,
+        unsigned long long& r4) {
+        unsigned long long h0, h1, h2, h3;
+        unsigned long long l0 = _mulx_u64(a.v[0], bi, &h0);
+        unsigned long long l1 = _mulx_u64(a.v[1], bi, &h1);
+        unsigned long long l2 = _mulx_u64(a.v[2], bi, &h2);
+        unsigned long long l3 = _mulx_u64(a.v[3], bi, &h3);
+        unsigned char c = _addcarry_u64(0, l1, h0, &l1);
+        c = _addcarry_u64(c, l2, h1, &l2);
+        c = _addcarry_u64(c, l3, h2, &l3);
+        _addcarry_u64(c, h3, 0, &h3);
+        c = _addcarry_u64(0, r0, l0, &r0);
+        c = _addcarry_u64(c, r1, l1, &r1);
+        c = _addcarry_u64(c, r2, l2, &r2);
+        c = _addcarry_u64(c, r3, l3, &r3);
+        _addcarry_u64(c, h3, 0, &r4);
+    }
+
+    // 512λ˻
+    static inline __attribute__((always_inline)) void mul512(const Elem& a, const Elem& b,
+        unsigned long long& t0, unsigned long long& t1, unsigned long long& t2, unsigned long long& t3,
+        unsigned long long& t4, unsigned long long& t5, unsigned long long& t6, unsigned long long& t7) {
+        unsigned long long h0, h1, h2, h3;
+        t0 = _mulx_u64(a.v[0], b.v[0], &h0);
+        unsigned long long l1 = _mulx_u64(a.v[1], b.v[0], &h1);
+        unsigned long long l2 = _mulx_u64(a.v[2], b.v[0], &h2);
+        unsigned long long l3 = _mulx_u64(a.v[3], b.v[0], &h3);
+        unsigned char c = _addcarry_u64(0, l1, h0, &t1);
+        c = _addcarry_u64(c, l2, h1, &t2);
+        c = _addcarry_u64(c, l3, h2, &t3);
+        _addcarry_u64(c, h3, 0, &t4);
+        mulRow(a, b.v[1], t1, t2, t3, t4, t5);
+        mulRow(a, b.v[2], t2, t3, t4, t5, t6);
+        mulRow(a, b.v[3], t3, t4, t5, t6, t7);
+    }
+
+    // ƽ6ӱ4ƽ
+    static inline __attribute__((always_inline)) void sqr512(const Elem& a,
+        unsigned long long& t0, unsigned long long& t1, unsigned long long& t2, unsigned long long& t3,
+        unsigned long long& t4, unsigned long long& t5, unsigned long long& t6, unsigned long long& t7) {
+        unsigned long long h01, h02, h03, h12, h13, h23, x1, x2, x3, x4, x5, x6, hi;
+        unsigned char c;
+        x1 = _mulx_u64(a.v[0], a.v[1], &h01);
+        unsigned long long l02 = _mulx_u64(a.v[0], a.v[2], &h02);
+        unsigned long long l03 = _mulx_u64(a.v[0], a.v[3], &h03);
+        unsigned long long l12 = _mulx_u64(a.v[1], a.v[2], &h12);
+        unsigned long long l13 = _mulx_u64(a.v[1], a.v[3], &h13);
+        unsigned long long l23 = _mulx_u64(a.v[2], a.v[3], &h23);
+        // ֮ x1..x6Ȩ2^64..2^384
+        c = _addcarry_u64(0, l02, h01, &x2);
+        c = _addcarry_u64(c, l03, h02, &x3);
+        c = _addcarry_u64(c, l13, h03, &x4);
+        c = _addcarry_u64(c, l23, h13, &x5);
+        _addcarry_u64(c, h23, 0, &x6);
+        c = _addcarry_u64(0, x3, l12, &x3);
+        c = _addcarry_u64(c, x4, h12, &x4);
+        c = _addcarry_u64(c, x5, 0, &x5);
+        _addcarry_u64(c, x6, 0, &x6);
+        // ӱ
+        unsigned long long x7 = x6 >> 63;
+        x6 = (x6 << 1) | (x5 >> 63);
+        x5 = (x5 << 1) | (x4 >> 63);
+        x4 = (x4 << 1) | (x3 >> 63);
+        x3 = (x3 << 1) | (x2 >> 63);
+        x2 = (x2 << 1) | (x1 >> 63);
+        x1 <<= 1;
+        // ƽ
+        t0 = _mulx_u64(a.v[0], a.v[0], &hi);
+        c = _addcarry_u64(0, x1, hi, &t1);
+        unsigned long long lo = _mulx_u64(a.v[1], a.v[1], &hi);
+        c = _addcarry_u64(c, x2, lo, &t2);
+        c = _addcarry_u64(c, x3, hi, &t3);
+        lo = _mulx_u64(a.v[2], a.v[2], &hi);
+        c = _addcarry_u64(c, x4, lo, &t4);
+        c = _addcarry_u64(c, x5, hi, &t5);
+        lo = _mulx_u64(a.v[3], a.v[3], &hi);
+        c = _addcarry_u64(c, x6, lo, &t6);
+        _addcarry_u64(c, x7, hi, &t7);
+    }
+
+    // һԼx[0..4] += m*MODʹx0Ϊ0λдµx5
+    static inline __attribute__((always_inline)) void redcRound(unsigned long long& x0, unsigned long long& x1,
+        unsigned long long& x2, unsigned long long& x3, unsigned long long& x4, unsigned long long& x5) {
+        unsigned long long q0, q1, q2, q3, q4;
+        unsigned long long m = x0 * N0;
+        unsigned char c;
+        if constexpr (Params::SPECIAL_FORM) {
+            // m*p = m*2^256 + m*2^64 - m*2^224 - m*2^96 - m
+            unsigned long long ml = m << 32, mh = m >> 32;
+            c = _subborrow_u64(0, 0, m, &q0);
+            c = _subborrow_u64(c, m, ml, &q1);
+            c = _subborrow_u64(c, 0, mh, &q2);
+            c = _subborrow_u64(c, 0, ml, &q3);
+            _subborrow_u64(c, m, mh, &q4);
+        }
+        else {
+            unsigned long long h0, h1, h2, h3;
+            q0 = _mulx_u64(m, MOD[0], &h0);
+            q1 = _mulx_u64(m, MOD[1], &h1);
+            q2 = _mulx_u64(m, MOD[2], &h2);
+            q3 = _mulx_u64(m, MOD[3], &h3);
+            c = _addcarry_u64(0, q1, h0, &q1);
+            c = _addcarry_u64(c, q2, h1, &q2);
+            c = _addcarry_u64(c, q3, h2, &q3);
+            _addcarry_u64(c, h3, 0, &q4);
+        }
+        c = _addcarry_u64(0, x0, q0, &x0);
+        c = _addcarry_u64(c, x1, q1, &x1);
+        c = _addcarry_u64(c, x2, q2, &x2);
+        c = _addcarry_u64(c, x3, q3, &x3);
+        c = _addcarry_u64(c, x4, q4, &x4);
+        x5 = c;
+    }
+
+    // MontgomeryԼֻԼ256λõu <= MODټϸ256λС2*MOD
+    static inline __attribute__((always_inline)) Elem redc(unsigned long long t0, unsigned long long t1,
+        unsigned long long t2, unsigned long long t3, unsigned long long t4, unsigned long long t5,
+        unsigned long long t6, unsigned long long t7) {
+        unsigned long long u4 = 0, u5, u6, u7, u8;
+        redcRound(t0, t1, t2, t3, u4, u5);
+        redcRound(t1, t2, t3, u4, u5, u6);
+        redcRound(t2, t3, u4, u5, u6, u7);
+        redcRound(t3, u4, u5, u6, u7, u8);
+        unsigned long long r[4];
+        unsigned char c = _addcarry_u64(0, u4, t4, &r[0]);
+        c = _addcarry_u64(c, u5, t5, &r[1]);
+        c = _addcarry_u64(c, u6, t6, &r[2]);
+        c = _addcarry_u64(c, u7, t7, &r[3]);
+        return subModFast(r, u8 + c);
+    }
+
+    // (carry, t) < 2*MODʱ޷֧ؼȥһģ
+    static inline __attribute__((always_inline)) Elem subModFast(const unsigned long long t[4], unsigned long long carry) {
+        unsigned long long d0, d1, d2, d3;
+        unsigned char b = _subborrow_u64(0, t[0], MOD[0], &d0);
+        b = _subborrow_u64(b, t[1], MOD[1], &d1);
+        b = _subborrow_u64(b, t[2], MOD[2], &d2);
+        b = _subborrow_u64(b, t[3], MOD[3], &d3);
+        uint64_t keep = 0 - (uint64_t)(b & (carry ^ 1));
+        return Elem{ { (t[0] & keep) | (d0 & ~keep), (t[1] & keep) | (d1 & ~keep),
+            (t[2] & keep) | (d2 & ~keep), (t[3] & keep) | (d3 & ~keep) } };
+    }
+
+    static inline __attribute__((always_inline)) Elem addFast(const Elem& a, const Elem& b) {
+        unsigned long long t[4];
+        unsigned char c = _addcarry_u64(0, a.v[0], b.v[0], &t[0]);
+        c = _addcarry_u64(c, a.v[1], b.v[1], &t[1]);
+        c = _addcarry_u64(c, a.v[2], b.v[2], &t[2]);
+        c = _addcarry_u64(c, a.v[3], b.v[3], &t[3]);
+        return subModFast(t, c);
+    }
+
+    static inline __attribute__((always_inline)) Elem subFast(const Elem& a, const Elem& b) {
+        unsigned long long t[4];
+        unsigned char c = _subborrow_u64(0, a.v[0], b.v[0], &t[0]);
+        c = _subborrow_u64(c, a.v[1], b.v[1], &t[1]);
+        c = _subborrow_u64(c, a.v[2], b.v[2], &t[2]);
+        c = _subborrow_u64(c, a.v[3], b.v[3], &t[3]);
+        uint64_t mask = 0 - (uint64_t)c;
+        c = _addcarry_u64(0, t[0], MOD[0] & mask, &t[0]);
+        c = _addcarry_u64(c, t[1], MOD[1] & mask, &t[1]);
+        c = _addcarry_u64(c, t[2], MOD[2] & mask, &t[2]);
+        _addcarry_u64(c, t[3], MOD[3] & mask, &t[3]);
+        return Elem{ { t[0], t[1], t[2], t[3] } };
+    }
+
+    // Ϊcarry*2^256 + r < 2*MOD޷֧ؼȥһģ
+    static constexpr Elem reduceOnce(const Elem& r, uint64_t carry) {
+        Elem d = {};
+        uint64_t borrow = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint128_t t = (uint128_t)r.v[i] - MOD[i] - borrow;
+            d.v[i] = (uint64_t)t;
+            borrow = (uint64_t)(t >> 64) & 1;
+        }
+        // нλδλ˵r >= MOD
+        uint64_t keep = 0 - (borrow & (carry ^ 1));
+        return select(keep, r, d);
+    }
+};
+
+using SM2_Fp = MontField<SM2_P>;
+using SM2_Fn = MontField<SM2_N>;
+using Fp = SM2_Fp::Elem;
+using Fn = SM2_Fn::Elem;
+
+// p - 2רüӷp - 2 = [311][0][1281][320][621][0][1]255ƽ + 14γ˷
+constexpr Fp fpInv(const Fp& a) {
+    Fp x1 = a;
+    Fp x2 = SM2_Fp::mul(SM2_Fp::sqr(x1), x1);
+    Fp x3 = SM2_Fp::mul(SM2_Fp::sqr(x2), x1);
+    Fp x6 = SM2_Fp::mul(SM2_Fp::sqrN(x3, 3), x3);
+    Fp x12 = SM2_Fp::mul(SM2_Fp::sqrN(x6, 6), x6);
+    Fp x15 = SM2_Fp::mul(SM2_Fp::sqrN(x12, 3), x3);
+    Fp x30 = SM2_Fp::mul(SM2_Fp::sqrN(x15, 15), x15);
+    Fp x31 = SM2_Fp::mul(SM2_Fp::sqr(x30), x1);
+    Fp x32 = SM2_Fp::mul(SM2_Fp::sqr(x31), x1);
+    Fp x64 = SM2_Fp::mul(SM2_Fp::sqrN(x32, 32), x32);
+    Fp x128 = SM2_Fp::mul(SM2_Fp::sqrN(x64, 64), x64);
+
+    Fp t = SM2_Fp::sqrN(x31, 1);
+    t = SM2_Fp::mul(SM2_Fp::sqrN(t, 128), x128);
+    t = SM2_Fp::sqrN(t, 32);
+    t = SM2_Fp::mul(SM2_Fp::sqrN(t, 32), x32);
+    t = SM2_Fp::mul(SM2_Fp::sqrN(t, 30), x30);
+    return SM2_Fp::mul(SM2_Fp::sqrN(t, 2), x1);
+}
+
+// p  3 (mod 4)ƽΪa^((p+1)/4)aǶʣʱfalse
+inline bool fpSqrt(const Fp& a, Fp& out) {
+    static const uint64_t e[4] = { 0x4000000000000000, 0xFFFFFFFFC0000000, 0xFFFFFFFFFFFFFFFF, 0x3FFFFFFFBFFFFFFF };
+    out = SM2_Fp::pow(a, e);
+    return SM2_Fp::equal(SM2_Fp::sqr(out), a);
+}
+
+// ߲ y^2 = x^3 + ax + bMontgomeryʽ
+struct SM2_Curve {
+    static constexpr uint64_t A_INT[4] = { 0xFFFFFFFFFFFFFFFC, 0xFFFFFFFF00000000, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFEFFFFFFFF };
+    static constexpr uint64_t B_INT[4] = { 0xDDBCBD414D940E93, 0xF39789F515AB8F92, 0x4D5A9E4BCF6509A7, 0x28E9FA9E9D9F5E34 };
+    static constexpr uint64_t GX_INT[4] = { 0x715A4589334C74C7, 0x8FE30BBFF2660BE1, 0x5F9904466A39C994, 0x32C4AE2C1F198119 };
+    static constexpr uint64_t GY_INT[4] = { 0x02DF32E52139F0A0, 0xD0A9877CC62A4740, 0x59BDCEE36B692153, 0xBC3736A2F4F6779C };
+
+    static constexpr Fp A = SM2_Fp::fromInt(A_INT);
+    static constexpr Fp B = SM2_Fp::fromInt(B_INT);
+    static constexpr Fp GX = SM2_Fp::fromInt(GX_INT);
+    static constexpr Fp GY = SM2_Fp::fromInt(GY_INT);
+};
+
+// 㣨Ԥ빫ԿJacobian (X/Z^2, Y/Z^3)Z = 0ʾԶ
+struct AffinePoint {
+    Fp x;
+    Fp y;
+};
+
+struct JacobianPoint {
+    Fp X;
+    Fp Y;
+    Fp Z;
+};
+
+constexpr JacobianPoint infinityPoint() {
+    return JacobianPoint{ SM2_Fp::one(), SM2_Fp::one(), SM2_Fp::zero() };
+}
+
+constexpr JacobianPoint toJacobian(const AffinePoint& p) {
+    return JacobianPoint{ p.x, p.y, SM2_Fp::one() };
+}
+
+constexpr AffinePoint negate(const AffinePoint& p) {
+    return AffinePoint{ p.x, SM2_Fp::neg(p.y) };
+}
+
+constexpr JacobianPoint negate(const JacobianPoint& p) {
+    return JacobianPoint{ p.X, SM2_Fp::neg(p.Y), p.Z };
+}
+
+// 㣨a = -3dbl-2001-b3M + 5S
+constexpr JacobianPoint pointDouble(const JacobianPoint& p) {
+    Fp delta = SM2_Fp::sqr(p.Z);
+    Fp gamma = SM2_Fp::sqr(p.Y);
+    Fp beta = SM2_Fp::mul(p.X, gamma);
+    Fp t = SM2_Fp::mul(SM2_Fp::sub(p.X, delta), SM2_Fp::add(p.X, delta));
+    Fp alpha = SM2_Fp::add(SM2_Fp::dbl(t), t);
+    Fp beta4 = SM2_Fp::dbl(SM2_Fp::dbl(beta));
+    JacobianPoint r = {};
+    r.X = SM2_Fp::sub(SM2_Fp::sqr(alpha), SM2_Fp::dbl(beta4));
+    r.Z = SM2_Fp::sub(SM2_Fp::sub(SM2_Fp::sqr(SM2_Fp::add(p.Y, p.Z)), gamma), delta);
+    Fp gamma2 = SM2_Fp::sqr(gamma);
+    r.Y = SM2_Fp::sub(SM2_Fp::mul(alpha, SM2_Fp::sub(beta4, r.X)), SM2_Fp::dbl(SM2_Fp::dbl(SM2_Fp::dbl(gamma2))));
+    return r;
+}
+
+// ϼӷ Jacobian + 䣨madd-2007-bl7M + 4SԶͬ
+constexpr JacobianPoint pointAddMixed(const JacobianPoint& p, const AffinePoint& q) {
+    if (SM2_Fp::isZero(p.Z)) {
+        return toJacobian(q);
+    }
+    Fp z1z1 = SM2_Fp::sqr(p.Z);
+    Fp u2 = SM2_Fp::mul(q.x, z1z1);
+    Fp s2 = SM2_Fp::mul(q.y, SM2_Fp::mul(p.Z, z1z1));
+    Fp h = SM2_Fp::sub(u2, p.X);
+    Fp r = SM2_Fp::dbl(SM2_Fp::sub(s2, p.Y));
+    if (SM2_Fp::isZero(h)) {
+        return SM2_Fp::isZero(r) ? pointDouble(p) : infinityPoint();
+    }
+    Fp hh = SM2_Fp::sqr(h);
+    Fp i = SM2_Fp::dbl(SM2_Fp::dbl(hh));
+    Fp j = SM2_Fp::mul(h, i);
+    Fp v = SM2_Fp::mul(p.X, i);
+    JacobianPoint out = {};
+    out.X = SM2_Fp::sub(SM2_Fp::sub(SM2_Fp::sqr(r), j), SM2_Fp::dbl(v));
+    out.Y = SM2_Fp::sub(SM2_Fp::mul(r, SM2_Fp::sub(v, out.X)), SM2_Fp::dbl(SM2_Fp::mul(p.Y, j)));
+    out.Z = SM2_Fp::sub(SM2_Fp::sub(SM2_Fp::sqr(SM2_Fp::add(p.Z, h)), z1z1), hh);
+    return out;
+}
+
+// һӷadd-2007-bl11M + 5S
+constexpr JacobianPoint pointAdd(const JacobianPoint& p, const JacobianPoint& q) {
+    if (SM2_Fp::isZero(p.Z)) {
+        return q;
+    }
+    if (SM2_Fp::isZero(q.Z)) {
+        return p;
+    }
+    Fp z1z1 = SM2_Fp::sqr(p.Z);
+    Fp z2z2 = SM2_Fp::sqr(q.Z);
+    Fp u1 = SM2_Fp::mul(p.X, z2z2);
+    Fp u2 = SM2_Fp::mul(q.X, z1z1);
+    Fp s1 = SM2_Fp::mul(p.Y, SM2_Fp::mul(q.Z, z2z2));
+    Fp s2 = SM2_Fp::mul(q.Y, SM2_Fp::mul(p.Z, z1z1));
+    Fp h = SM2_Fp::sub(u2, u1);
+    Fp r = SM2_Fp::dbl(SM2_Fp::sub(s2, s1));
+    if (SM2_Fp::isZero(h)) {
+        return SM2_Fp::isZero(r) ? pointDouble(p) : infinityPoint();
+    }
+    Fp i = SM2_Fp::sqr(SM2_Fp::dbl(h));
+    Fp j = SM2_Fp::mul(h, i);
+    Fp v = SM2_Fp::mul(u1, i);
+    JacobianPoint out = {};
+    out.X = SM2_Fp::sub(SM2_Fp::sub(SM2_Fp::sqr(r), j), SM2_Fp::dbl(v));
+    out.Y = SM2_Fp::sub(SM2_Fp::mul(r, SM2_Fp::sub(v, out.X)), SM2_Fp::dbl(SM2_Fp::mul(s1, j)));
+    Fp zz = SM2_Fp::sqr(SM2_Fp::add(p.Z, q.Z));
+    out.Z = SM2_Fp::mul(SM2_Fp::sub(SM2_Fp::sub(zz, z1z1), z2z2), h);
+    return out;
+}
+
+// תΪ꣬Զ㷵false
+inline bool toAffine(const JacobianPoint& p, AffinePoint& out) {
+    if (SM2_Fp::isZero(p.Z)) {
+        return false;
+    }
+    Fp zInv = fpInv(p.Z);
+    Fp zInv2 = SM2_Fp::sqr(zInv);
+    out.x = SM2_Fp::mul(p.X, zInv2);
+    out.y = SM2_Fp::mul(p.Y, SM2_Fp::mul(zInv, zInv2));
+    return true;
+}
+
+inline bool isOnCurve(const AffinePoint& p) {
+    Fp rhs = SM2_Fp::add(SM2_Fp::mul(SM2_Fp::add(SM2_Fp::sqr(p.x), SM2_Curve::A), p.x), SM2_Curve::B);
+    return SM2_Fp::equal(SM2_Fp::sqr(p.y), rhs);
+}
+
+constexpr AffinePoint SM2_G = { SM2_Curve::GX, SM2_Curve::GY };
+
+// ̶ڱiΪ j * 16^i * Gj = 1..8꣩65Լ33KB
+// 4λз֣-7..8ֻֽ65λϼӷûб
+// ڱɣбӷõJacobian㣬һתΪ
+struct SM2_BaseTable {
+    static constexpr int ROWS = 65;
+    static constexpr int COLS = 8;
+    static constexpr int ROWS_PER_PART = 13;
+    AffinePoint rows[ROWS][COLS];
+    JacobianPoint next; // ֶʱһεĻ 16^i * G
+};
+
+// base = 16^first * PɵfirstROWS_PER_PARTУP = Gʱڱֵڣ
+// ֶΪÿεıֵڱĬ֮
+constexpr SM2_BaseTable makeBaseRows(JacobianPoint base, int first) {
+    constexpr int count = SM2_BaseTable::ROWS_PER_PART;
+    constexpr int total = count * SM2_BaseTable::COLS;
+    JacobianPoint points[total] = {};
+    for (int i = 0; i < count; ++i) {
+        // żɱõɼӷõһеĻΪ8B2
+        JacobianPoint* row = points + i * SM2_BaseTable::COLS;
+        row[0] = base;
+        for (int j = 2; j <= SM2_BaseTable::COLS; ++j) {
+            row[j - 1] = j % 2 ? pointAdd(row[j - 2], base) : pointDouble(row[j / 2 - 1]);
+        }
+        base = pointDouble(row[SM2_BaseTable::COLS - 1]);
+    }
+
+    // Montgomery棺prefix[i] = Z0*...*Zi
+    Fp prefix[total] = {};
+    prefix[0] = points[0].Z;
+    for (int i = 1; i < total; ++i) {
+        prefix[i] = SM2_Fp::mul(prefix[i - 1], points[i].Z);
+    }
+    Fp inv = SM2_Fp::inv(prefix[total - 1]);
+    SM2_BaseTable table = {};
+    table.next = base;
+    for (int i = total - 1; i >= 0; --i) {
+        Fp zInv = i > 0 ? SM2_Fp::mul(inv, prefix[i - 1]) : inv;
+        inv = SM2_Fp::mul(inv, points[i].Z);
+        Fp zInv2 = SM2_Fp::sqr(zInv);
+        table.rows[first + i / SM2_BaseTable::COLS][i % SM2_BaseTable::COLS] = AffinePoint{
+            SM2_Fp::mul(points[i].X, zInv2), SM2_Fp::mul(points[i].Y, SM2_Fp::mul(zInv, zInv2)) };
+    }
+    return table;
+}
+
+constexpr SM2_BaseTable SM2_BASE_PART0 = makeBaseRows(toJacobian(SM2_G), 0);
+constexpr SM2_BaseTable SM2_BASE_PART1 = makeBaseRows(SM2_BASE_PART0.next, 13);
+constexpr SM2_BaseTable SM2_BASE_PART2 = makeBaseRows(SM2_BASE_PART1.next, 26);
+constexpr SM2_BaseTable SM2_BASE_PART3 = makeBaseRows(SM2_BASE_PART2.next, 39);
+constexpr SM2_BaseTable SM2_BASE_PART4 = makeBaseRows(SM2_BASE_PART3.next, 52);
+
+constexpr SM2_BaseTable joinBaseRows() {
+    const SM2_BaseTable* parts[] = { &SM2_BASE_PART0, &SM2_BASE_PART1, &SM2_BASE_PART2, &SM2_BASE_PART3,
+        &SM2_BASE_PART4 };
+    SM2_BaseTable table = {};
+    for (int i = 0; i < SM2_BaseTable::ROWS; ++i) {
+        for (int j = 0; j < SM2_BaseTable::COLS; ++j) {
+            table.rows[i][j] = parts[i / SM2_BaseTable::ROWS_PER_PART]->rows[i][j];
+        }
+    }
+    return table;
+}
+
+constexpr SM2_BaseTable SM2_BASE_TABLE = joinBaseRows();
+
+// ͨС2^256ֽΪ654λз֣k = sum d_i * 16^id_i  [-7, 8]
+inline void recodeSigned4(const uint64_t k[4], int8_t digits[65]) {
+    int carry = 0;
+    for (int i = 0; i < 64; ++i) {
+        int d = (int)((k[i / 16] >> ((i % 16) * 4)) & 15) + carry;
+        carry = d > 8;
+        digits[i] = (int8_t)(d - (carry << 4));
+    }
+    digits[64] = (int8_t)carry;
+}
+
+// k*Gϼӷɱʱ䣬Ϊ0֣
+inline JacobianPoint baseMult(const uint64_t k[4]) {
+    int8_t digits[65];
+    recodeSigned4(k, digits);
+    JacobianPoint r = infinityPoint();
+    for (int i = 0; i < SM2_BaseTable::ROWS; ++i) {
+        int d = digits[i];
+        if (d > 0) {
+            r = pointAddMixed(r, SM2_BASE_TABLE.rows[i][d - 1]);
+        }
+        else if (d < 0) {
+            r = pointAddMixed(r, negate(SM2_BASE_TABLE.rows[i][-d - 1]));
+        }
+    }
+    return r;
+}
+
+// k*P4λ̶ڣɱʱ䣩
+inline JacobianPoint pointMult(const uint64_t k[4], const AffinePoint& p) {
+    JacobianPoint table[16];
+    table[0] = infinityPoint();
+    table[1] = toJacobian(p);
+    for (int i = 2; i < 16; ++i) {
+        table[i] = pointAddMixed(table[i - 1], p);
+    }
+    JacobianPoint r = infinityPoint();
+    for (int i = 63; i >= 0; --i) {
+        for (int j = 0; j < 4; ++j) {
+            r = pointDouble(r);
+        }
+        int d = (int)((k[i / 16] >> ((i % 16) * 4)) & 15);
+        if (d) {
+            r = pointAdd(r, table[d]);
+        }
+    }
+    return r;
+}
+
+//  P, 3P, ..., (2N-1)P ķ꣺Jacobian2Pһת
+// ڻ㣬ڹԿPϣΪnвԶ㣩
+template <int N>
+constexpr std::array<AffinePoint, N> oddMultiples(const AffinePoint& p) {
+    JacobianPoint points[N] = {};
+    points[0] = toJacobian(p);
+    JacobianPoint twice = pointDouble(points[0]);
+    for (int i = 1; i < N; ++i) {
+        points[i] = pointAdd(points[i - 1], twice);
+    }
+    Fp prefix[N] = {};
+    prefix[0] = points[0].Z;
+    for (int i = 1; i < N; ++i) {
+        prefix[i] = SM2_Fp::mul(prefix[i - 1], points[i].Z);
+    }
+    Fp inv = fpInv(prefix[N - 1]);
+    std::array<AffinePoint, N> out = {};
+    for (int i = N - 1; i >= 0; --i) {
+        Fp zInv = i > 0 ? SM2_Fp::mul(inv, prefix[i - 1]) : inv;
+        inv = SM2_Fp::mul(inv, points[i].Z);
+        Fp zInv2 = SM2_Fp::sqr(zInv);
+        out[i] = AffinePoint{ SM2_Fp::mul(points[i].X, zInv2), SM2_Fp::mul(points[i].Y, SM2_Fp::mul(zInv, zInv2)) };
+    }
+    return out;
+}
+
+// ֤õĻwNAF8G, 3G, ..., 127G4KB
+constexpr int SM2_G_WNAF_WIDTH = 8;
+constexpr std::array<AffinePoint, 1 << (SM2_G_WNAF_WIDTH - 2)> SM2_G_ODD =
+    oddMultiples<1 << (SM2_G_WNAF_WIDTH - 2)>(SM2_G);
+
+// wNAFǾֵС2^(w-1)wһ㣻ָ257
+inline int recodeWnaf(const uint64_t k[4], int w, int8_t naf[257]) {
+    unsigned long long x[5] = { k[0], k[1], k[2], k[3], 0 };
+    const int mask = (1 << w) - 1;
+    int len = 0;
+    while (x[0] | x[1] | x[2] | x[3] | x[4]) {
+        int d = 0;
+        if (x[0] & 1) {
+            d = (int)(x[0] & mask);
+            if (d >= (1 << (w - 1))) {
+                // ȡ֣x2^w - dwλ㲢λλ
+                d -= 1 << w;
+                unsigned char c = _addcarry_u64(0, x[0], (unsigned long long)-d, &x[0]);
+                for (int i = 1; i < 5; ++i) {
+                    c = _addcarry_u64(c, x[i], 0, &x[i]);
+                }
+            }
+            else {
+                x[0] -= (unsigned long long)d;
+            }
+        }
+        naf[len++] = (int8_t)d;
+        for (int i = 0; i < 4; ++i) {
+            x[i] = (x[i] >> 1) | (x[i + 1] << 63);
+        }
+        x[4] >>= 1;
+    }
+    return len;
+}
+
+// е d*PdΪΪ
+inline JacobianPoint addOddMultiple(const JacobianPoint& r, const AffinePoint* odd, int d) {
+    return d > 0 ? pointAddMixed(r, odd[d >> 1]) : pointAddMixed(r, negate(odd[-d >> 1]));
+}
+
+inline JacobianPoint addOddMultiple(const JacobianPoint& r, const JacobianPoint* odd, int d) {
+    return d > 0 ? pointAdd(r, odd[d >> 1]) : pointAdd(r, negate(odd[-d >> 1]));
+}
+
+// s*G + t*P 㣨ShamirɣwNAFֽһ
+// sڵG8Լ28λϼӷtPoddPwidth
+template <class Point>
+inline JacobianPoint dualMult(const uint64_t s[4], const uint64_t t[4], const Point* oddP, int width) {
+    int8_t nafS[257], nafT[257];
+    int lenS = recodeWnaf(s, SM2_G_WNAF_WIDTH, nafS);
+    int lenT = recodeWnaf(t, width, nafT);
+    JacobianPoint r = infinityPoint();
+    for (int i = std::max(lenS, lenT) - 1; i >= 0; --i) {
+        if (!SM2_Fp::isZero(r.Z)) {
+            r = pointDouble(r);
+        }
+        if (i < lenS && nafS[i]) {
+            r = addOddMultiple(r, SM2_G_ODD.data(), nafS[i]);
+        }
+        if (i < lenT && nafT[i]) {
+            r = addOddMultiple(r, oddP, nafT[i]);
+        }
+    }
+    return r;
+}
+
+// ûԤʱ5 P, 3P, ..., 15PJacobian꣬棩
+inline JacobianPoint dualMult(const uint64_t s[4], const uint64_t t[4], const AffinePoint& p) {
+    JacobianPoint odd[8];
+    odd[0] = toJacobian(p);
+    JacobianPoint twice = pointDouble(odd[0]);
+    for (int i = 1; i < 8; ++i) {
+        odd[i] = pointAdd(odd[i - 1], twice);
+    }
+    return dualMult(s, t, odd, 5);
+}
+
+// ---------------- ʱˣ˽Կǩ ----------------
+// ôַֻݣûܵķ֧ѡ뽻
+
+// d != 0ʱȫ1ȫ0
+inline uint64_t nonZeroMask(int d) {
+    return 0 - (uint64_t)(((uint32_t)d | (uint32_t)-d) >> 31);
+}
+
+inline JacobianPoint selectPoint(uint64_t mask, const JacobianPoint& a, const JacobianPoint& b) {
+    return JacobianPoint{ SM2_Fp::select(mask, a.X, b.X), SM2_Fp::select(mask, a.Y, b.Y),
+        SM2_Fp::select(mask, a.Z, b.Z) };
+}
+
+// maskȫ1ʱab
+inline void condSwap(uint64_t mask, Fp& a, Fp& b) {
+    for (int i = 0; i < 4; ++i) {
+        uint64_t t = (a.v[i] ^ b.v[i]) & mask;
+        a.v[i] ^= t;
+        b.v[i] ^= t;
+    }
+}
+
+// жĻϼӷ7M + 4Sɵ÷֤pԶp  q
+inline JacobianPoint pointAddMixedUnchecked(const JacobianPoint& p, const AffinePoint& q) {
+    Fp z1z1 = SM2_Fp::sqr(p.Z);
+    Fp u2 = SM2_Fp::mul(q.x, z1z1);
+    Fp s2 = SM2_Fp::mul(q.y, SM2_Fp::mul(p.Z, z1z1));
+    Fp h = SM2_Fp::sub(u2, p.X);
+    Fp r = SM2_Fp::dbl(SM2_Fp::sub(s2, p.Y));
+    Fp hh = SM2_Fp::sqr(h);
+    Fp i = SM2_Fp::dbl(SM2_Fp::dbl(hh));
+    Fp j = SM2_Fp::mul(h, i);
+    Fp v = SM2_Fp::mul(p.X, i);
+    JacobianPoint out;
+    out.X = SM2_Fp::sub(SM2_Fp::sub(SM2_Fp::sqr(r), j), SM2_Fp::dbl(v));
+    out.Y = SM2_Fp::sub(SM2_Fp::mul(r, SM2_Fp::sub(v, out.X)), SM2_Fp::dbl(SM2_Fp::mul(p.Y, j)));
+    out.Z = SM2_Fp::sub(SM2_Fp::sub(SM2_Fp::sqr(SM2_Fp::add(p.Z, h)), z1z1), hh);
+    return out;
+}
+
+// һӷpqΪԶ㡢ͬΪ෴ʱҲȷĽѡûз֧
+// h = 0r  0ʱʽZ = 0
+inline JacobianPoint pointAddComplete(const JacobianPoint& p, const JacobianPoint& q) {
+    Fp z1z1 = SM2_Fp::sqr(p.Z);
+    Fp z2z2 = SM2_Fp::sqr(q.Z);
+    Fp u1 = SM2_Fp::mul(p.X, z2z2);
+    Fp u2 = SM2_Fp::mul(q.X, z1z1);
+    Fp s1 = SM2_Fp::mul(p.Y, SM2_Fp::mul(q.Z, z2z2));
+    Fp s2 = SM2_Fp::mul(q.Y, SM2_Fp::mul(p.Z, z1z1));
+    Fp h = SM2_Fp::sub(u2, u1);
+    Fp r = SM2_Fp::dbl(SM2_Fp::sub(s2, s1));
+    Fp i = SM2_Fp::sqr(SM2_Fp::dbl(h));
+    Fp j = SM2_Fp::mul(h, i);
+    Fp v = SM2_Fp::mul(u1, i);
+    JacobianPoint out;
+    out.X = SM2_Fp::sub(SM2_Fp::sub(SM2_Fp::sqr(r), j), SM2_Fp::dbl(v));
+    out.Y = SM2_Fp::sub(SM2_Fp::mul(r, SM2_Fp::sub(v, out.X)), SM2_Fp::dbl(SM2_Fp::mul(s1, j)));
+    Fp zz = SM2_Fp::sqr(SM2_Fp::add(p.Z, q.Z));
+    out.Z = SM2_Fp::mul(SM2_Fp::sub(SM2_Fp::sub(zz, z1z1), z2z2), h);
+
+    uint64_t same = 0 - (uint64_t)(SM2_Fp::isZero(h) & SM2_Fp::isZero(r));
+    uint64_t pInf = 0 - (uint64_t)SM2_Fp::isZero(p.Z);
+    uint64_t qInf = 0 - (uint64_t)SM2_Fp::isZero(q.Z);
+    out = selectPoint(same, pointDouble(p), out);
+    out = selectPoint(qInf, p, out);
+    return selectPoint(pInf, q, out);
+}
+
+// ʱɨУȡ|d|㣬d < 0ʱȡd = 0ʱȡĵ
+inline AffinePoint lookupSigned(const AffinePoint row[SM2_BaseTable::COLS], int d) {
+    int sign = d >> 31;
+    int abs = (d ^ sign) - sign;
+    AffinePoint r = {};
+    for (int j = 0; j < SM2_BaseTable::COLS; ++j) {
+        uint64_t hit = ~nonZeroMask(abs ^ (j + 1));
+        r.x = SM2_Fp::select(hit, row[j].x, r.x);
+        r.y = SM2_Fp::select(hit, row[j].y, r.y);
+    }
+    r.y = SM2_Fp::select(0 - (uint64_t)(sign & 1), SM2_Fp::neg(r.y), r.y);
+    return r;
+}
+
+// ̶ϵĳʱˣbaseMultͬ65зŴڣÿжһλϼӷ
+// Ϊ0ۼֵΪԶʱѡеıͬͬ
+inline JacobianPoint fixedBaseMultConst(const SM2_BaseTable& table, const uint64_t k[4]) {
+    int8_t digits[65];
+    recodeSigned4(k, digits);
+    JacobianPoint r = infinityPoint();
+    uint64_t atInfinity = ~(uint64_t)0;
+    for (int i = 0; i < SM2_BaseTable::ROWS; ++i) {
+        AffinePoint t = lookupSigned(table.rows[i], digits[i]);
+        uint64_t used = nonZeroMask(digits[i]);
+        JacobianPoint sum = pointAddMixedUnchecked(r, t);
+        r = selectPoint(used & ~atInfinity, sum, r);
+        r = selectPoint(used & atInfinity, toJacobian(t), r);
+        atInfinity &= ~used;
+    }
+    return r;
+}
+
+inline JacobianPoint baseMultConst(const uint64_t k[4]) {
+    return fixedBaseMultConst(SM2_BASE_TABLE, k);
+}
+
+// PĹ̶ڷֶɣԼ33KBͬһ㷴ʱʱk*Pk*Gһֻ65λϼӷ
+inline std::unique_ptr<SM2_BaseTable> makeFixedBaseTable(const AffinePoint& p) {
+    std::unique_ptr<SM2_BaseTable> table(new SM2_BaseTable());
+    std::unique_ptr<SM2_BaseTable> part(new SM2_BaseTable());
+    JacobianPoint base = toJacobian(p);
+    for (int first = 0; first < SM2_BaseTable::ROWS; first += SM2_BaseTable::ROWS_PER_PART) {
+        *part = makeBaseRows(base, first);
+        for (int i = first; i < first + SM2_BaseTable::ROWS_PER_PART; ++i) {
+            std::copy(part->rows[i], part->rows[i] + SM2_BaseTable::COLS, table->rows[i]);
+        }
+        base = part->next;
+    }
+    return table;
+}
+
+// ZӷXYCZ-ADDP = (x1, y1)Q = (x2, y2)ZQ <- P + QPµĹZ = Z*(x2 - x1)4M + 2S
+inline void coZAdd(Fp& x1, Fp& y1, Fp& x2, Fp& y2) {
+    Fp a = SM2_Fp::sqr(SM2_Fp::sub(x2, x1));
+    Fp b = SM2_Fp::mul(x1, a);
+    Fp c = SM2_Fp::mul(x2, a);
+    Fp dy = SM2_Fp::sub(y2, y1);
+    Fp e = SM2_Fp::mul(y1, SM2_Fp::sub(c, b));
+    x2 = SM2_Fp::sub(SM2_Fp::sub(SM2_Fp::sqr(dy), b), c);
+    y2 = SM2_Fp::sub(SM2_Fp::mul(dy, SM2_Fp::sub(b, x2)), e);
+    x1 = b;
+    y1 = e;
+}
+
+// ZӷXYCZ-ADDCQ <- P + QP <- P - Q߹µZ5M + 3S
+inline void coZAddConj(Fp& x1, Fp& y1, Fp& x2, Fp& y2) {
+    Fp a = SM2_Fp::sqr(SM2_Fp::sub(x2, x1));
+    Fp b = SM2_Fp::mul(x1, a);
+    Fp c = SM2_Fp::mul(x2, a);
+    Fp dy = SM2_Fp::sub(y2, y1);
+    Fp sy = SM2_Fp::add(y1, y2);
+    Fp e = SM2_Fp::mul(y1, SM2_Fp::sub(c, b));
+    Fp bc = SM2_Fp::add(b, c);
+    x2 = SM2_Fp::sub(SM2_Fp::sqr(dy), bc);
+    y2 = SM2_Fp::sub(SM2_Fp::mul(dy, SM2_Fp::sub(b, x2)), e);
+    x1 = SM2_Fp::sub(SM2_Fp::sqr(sy), bc);
+    y1 = SM2_Fp::sub(SM2_Fp::mul(sy, SM2_Fp::sub(x1, b)), e);
+}
+
+// k*PĳʱMontgomeryӣZʽRivain 2011k  [1, n-1]P
+// Ȱkk' = k + nk + 2nе256λΪ1Ǹѭ̶256Σÿλ뽻ADDCADD
+// 2λʱR_b - R_1-b = Pɴ˻ָZλӷϣk  [1, n-1]
+inline AffinePoint ladderMult(const uint64_t k[4], const AffinePoint& p) {
+    // ʽҪx(P)  0жϣʱ (k/2)*(2P)
+    if (SM2_Fp::isZero(p.x)) {
+        static const uint64_t half[4] = { 0xA9DDFA049CEAA092, 0xB901EFB590E30295, 0xFFFFFFFFFFFFFFFF,
+            0x7FFFFFFF7FFFFFFF };
+        uint64_t kHalf[4];
+        SM2_Fn::toInt(SM2_Fn::mul(SM2_Fn::fromInt(k), SM2_Fn::fromInt(half)), kHalf);
+        AffinePoint twice;
+        toAffine(pointDouble(toJacobian(p)), twice);
+        return ladderMult(kHalf, twice);
+    }
+
+    unsigned long long k1[4], k2[4];
+    unsigned char c1 = 0, c2 = 0;
+    for (int i = 0; i < 4; ++i) {
+        c1 = _addcarry_u64(c1, k[i], SM2_N::MOD[i], &k1[i]);
+    }
+    for (int i = 0; i < 4; ++i) {
+        c2 = _addcarry_u64(c2, k1[i], SM2_N::MOD[i], &k2[i]);
+    }
+    uint64_t useFirst = 0 - (uint64_t)c1;
+    uint64_t scalar[4];
+    for (int i = 0; i < 4; ++i) {
+        scalar[i] = (k1[i] & useFirst) | (k2[i] & ~useFirst);
+    }
+
+    // ʼ㣨XYCZ-IDBLR1 = 2PR0 = PͬһZ = 2y
+    Fp yy = SM2_Fp::sqr(p.y);
+    Fp s = SM2_Fp::dbl(SM2_Fp::dbl(SM2_Fp::mul(p.x, yy)));
+    Fp e8 = SM2_Fp::dbl(SM2_Fp::dbl(SM2_Fp::dbl(SM2_Fp::sqr(yy))));
+    Fp xx1 = SM2_Fp::sub(SM2_Fp::sqr(p.x), SM2_Fp::one());
+    Fp m = SM2_Fp::add(SM2_Fp::dbl(xx1), xx1);
+    Fp bx = SM2_Fp::sub(SM2_Fp::sqr(m), SM2_Fp::dbl(s));
+    Fp by = SM2_Fp::sub(SM2_Fp::mul(m, SM2_Fp::sub(s, bx)), e8);
+    Fp ax = s;
+    Fp ay = e8;
+
+    // (a, b)ڽΪ(R_b, R_1-b)iλʱR_0 = j*Pj = floor(k'/2^(i+1)) < 2^(256-i)
+    // õıjj+12j+12j+2Сni >= 2ʱʽû
+    uint64_t prev = 0;
+    for (int i = 255; i >= 3; --i) {
+        uint64_t bit = (scalar[i / 64] >> (i % 64)) & 1;
+        uint64_t mask = 0 - (bit ^ prev);
+        condSwap(mask, ax, bx);
+        condSwap(mask, ay, by);
+        coZAddConj(ax, ay, bx, by);
+        coZAdd(bx, by, ax, ay);
+        prev = bit;
+    }
+    uint64_t bit = (scalar[0] >> 2) & 1;
+    uint64_t mask = 0 - (bit ^ prev);
+    condSwap(mask, ax, bx);
+    condSwap(mask, ay, by);
+    coZAddConj(ax, ay, bx, by);
+
+    // ʱa = R_b - R_1-b = (-1)^(1-b) * Pax = x*Z^2ay = y*Z^3ADDٳt = ax - bx
+    // Z' = x*ay*t / (y*ax)Jacobian갴s = y*axźҪ棺(X*s^2, Y*s^3, x*ay*t)
+    Fp t = SM2_Fp::sub(ax, bx);
+    Fp scale = SM2_Fp::mul(p.y, ax);
+    Fp z = SM2_Fp::mul(SM2_Fp::mul(p.x, ay), t);
+    z = SM2_Fp::select(bit - 1, SM2_Fp::neg(z), z);
+    coZAdd(bx, by, ax, ay);
+    condSwap(0 - bit, ax, bx);
+    condSwap(0 - bit, ay, by);
+    Fp scale2 = SM2_Fp::sqr(scale);
+    JacobianPoint quarter = { SM2_Fp::mul(ax, scale2), SM2_Fp::mul(ay, SM2_Fp::mul(scale, scale2)), z };
+
+    // λk*P = 4*R_0 + m*Pm = k' mod 44*R_0m*PͬΪ෴㣨k = 1n-1
+    // m = 0ʱm*PԶ㣬ӷP2P3PֻP
+    JacobianPoint p1 = toJacobian(p);
+    JacobianPoint p2 = pointDouble(p1);
+    JacobianPoint p3 = pointAdd(p2, p1);
+    int low = (int)(scalar[0] & 3);
+    JacobianPoint tail = infinityPoint();
+    tail = selectPoint(~nonZeroMask(low ^ 1), p1, tail);
+    tail = selectPoint(~nonZeroMask(low ^ 2), p2, tail);
+    tail = selectPoint(~nonZeroMask(low ^ 3), p3, tail);
+    AffinePoint result = {};
+    toAffine(pointAddComplete(pointDouble(pointDouble(quarter)), tail), result);
+    return result;
+}
+
+// ӱ̵߳SM4-CTR_DRBGȡ[1, n-1]ڵܾ
+inline void randomScalar(uint64_t k[4]) {
+    for (;;) {
+        unsigned char bytes[32];
+        threadCtrDrbg().read(bytes, sizeof(bytes));
+        for (int i = 0; i < 4; ++i) {
+            k[3 - i] = 0;
+            for (int j = 0; j < 8; ++j) {
+                k[3 - i] = (k[3 - i] << 8) | bytes[i * 8 + j];
+            }
+        }
+        memset(bytes, 0, sizeof(bytes));
+        if ((k[0] | k[1] | k[2] | k[3]) != 0 && U256Const::lessThan(k, SM2_N::MOD)) {
+            return;
+        }
+    }
+}
+
+// 32ֽڴ˱
+inline void pointToBytes(const AffinePoint& p, unsigned char out[64]) {
+    SM2_Fp::toBytes(p.x, out);
+    SM2_Fp::toBytes(p.y, out + 32);
+}
+
+// ԿԤ7 P, 3P, ..., 63P꣬2KB
+// Լ൱0.2֤֮t*Pȫ߻ϼӷҼӷ٣ʺϷֵǩ
+struct SM2_PublicKeyTable {
+    static constexpr int WIDTH = 7;
+    AffinePoint pub;
+    std::array<AffinePoint, 1 << (WIDTH - 2)> odd;
+
+    explicit SM2_PublicKeyTable(const AffinePoint& p) : pub(p), odd(oddMultiples<1 << (WIDTH - 2)>(p)) {}
+};
+
+// ̰߳ȫĹ棺ĹϣƬƬʱ̭ֵ⹹죬
+// ߳ͬʱͬһʱȲǸ
+template <class Value>
+class SM2_SharedCache {
+public:
+    explicit SM2_SharedCache(size_t capacity, size_t shardCount = 16)
+        : shardCount(shardCount), shardCapacity(std::max<size_t>(1, (capacity + shardCount - 1) / shardCount)),
+          shards(new Shard[shardCount]) {}
+
+    template <class Make>
+    std::shared_ptr<const Value> get(const std::string& key, Make make) {
+        Shard& shard = shards[std::hash<std::string>()(key) % shardCount];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.items.find(key);
+            if (it != shard.items.end()) {
+                return it->second;
+            }
+        }
+        std::shared_ptr<const Value> value = make();
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto inserted = shard.items.emplace(key, value);
+        if (!inserted.second) {
+            return inserted.first->second;
+        }
+        shard.order.push_back(key);
+        if (shard.order.size() > shardCapacity) {
+            shard.items.erase(shard.order.front());
+            shard.order.pop_front();
+        }
+        return value;
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < shardCount; ++i) {
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            total += shards[i].items.size();
+        }
+        return total;
+    }
+
+private:
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<const Value>> items;
+        std::deque<std::string> order;
+    };
+
+    size_t shardCount;
+    size_t shardCapacity;
+    std::unique_ptr<Shard[]> shards;
+};
+
+// Կ棺64ֽڹԿΪ
+class SM2_PublicKeyCache {
+public:
+    explicit SM2_PublicKeyCache(size_t capacity = 1024) : tables(capacity) {}
+
+    std::shared_ptr<const SM2_PublicKeyTable> get(const AffinePoint& pub) {
+        unsigned char bytes[64];
+        pointToBytes(pub, bytes);
+        return tables.get(std::string((const char*)bytes, sizeof(bytes)),
+            [&pub] { return std::make_shared<const SM2_PublicKeyTable>(pub); });
+    }
+
+    size_t size() const {
+        return tables.size();
+    }
+
+private:
+    SM2_SharedCache<SM2_PublicKeyTable> tables;
+};
+
+// SM2Կ˽ԿdԿP = d*Gǩ(1 + d)^-1Ԥ
+struct SM2_Key {
+    uint64_t d[4];
+    Fn dMont;
+    Fn dPlusOneInv;
+    AffinePoint pub;
+
+    static SM2_Key generate() {
+        SM2_Key key;
+        do {
+            randomScalar(key.d);
+            // d = n - 1ʱ1 + d
+        } while (key.d[0] == SM2_N::MOD[0] - 1 && key.d[1] == SM2_N::MOD[1] && key.d[2] == SM2_N::MOD[2] &&
+            key.d[3] == SM2_N::MOD[3]);
+        key.init();
+        return key;
+    }
+
+    void init() {
+        dMont = SM2_Fn::fromInt(d);
+        dPlusOneInv = SM2_Fn::inv(SM2_Fn::add(dMont, SM2_Fn::one()));
+        toAffine(baseMultConst(d), pub);
+    }
+};
+
+// recoveryڱ׼룺ǩʱkGyżbit0x1 >= nbit1֤ݴ˻ָR
+constexpr uint8_t SM2_RECOVERY_UNKNOWN = 0xFF;
+
+struct SM2_Signature {
+    Fn r;
+    Fn s;
+    uint8_t recovery = SM2_RECOVERY_UNKNOWN;
+};
+
+// Z = SM3(ENTL || ID || a || b || Gx || Gy || xA || yA)
+inline void sm2ComputeZ(const unsigned char* id, size_t idLen, const AffinePoint& pub, unsigned char z[32]) {
+    unsigned char buf[2 + 6 * 32];
+    size_t bits = idLen * 8;
+    buf[0] = (unsigned char)(bits >> 8);
+    buf[1] = (unsigned char)bits;
+    SM2_Fp::toBytes(SM2_Curve::A, buf + 2);
+    SM2_Fp::toBytes(SM2_Curve::B, buf + 34);
+    SM2_Fp::toBytes(SM2_Curve::GX, buf + 66);
+    SM2_Fp::toBytes(SM2_Curve::GY, buf + 98);
+    pointToBytes(pub, buf + 130);
+    SM3_Optimized sm3;
+    sm3.update(buf, 2);
+    sm3.update(id, idLen);
+    sm3.update(buf + 2, sizeof(buf) - 2);
+    sm3.final(z);
+}
+
+// e = SM3(Z || M) mod n
+inline Fn sm2Digest(const unsigned char z[32], const unsigned char* msg, size_t len) {
+    unsigned char e[32];
+    SM3_Optimized sm3;
+    sm3.update(z, 32);
+    sm3.update(msg, len);
+    sm3.final(e);
+    return SM2_Fn::fromBytesReduce(e);
+}
+
+// ǩԤkx1 mod nMontgomeryʽrecoveryΪkGyżbit0x1 >= nbit1
+struct SM2_Nonce {
+    Fn k;
+    Fn x1;
+    uint8_t recovery;
+};
+
+// countһ㣺k*G߳ʱ·Jacobian꣬һתΪ
+inline void makeNonces(const uint64_t (*k)[4], size_t count, SM2_Nonce* out) {
+    std::vector<JacobianPoint> points(count);
+    std::vector<Fp> prefix(count);
+    for (size_t i = 0; i < count; ++i) {
+        points[i] = baseMultConst(k[i]);
+        prefix[i] = i ? SM2_Fp::mul(prefix[i - 1], points[i].Z) : points[i].Z;
+    }
+    Fp inv = fpInv(prefix[count - 1]);
+    for (size_t i = count; i-- > 0;) {
+        Fp zInv = i ? SM2_Fp::mul(inv, prefix[i - 1]) : inv;
+        inv = SM2_Fp::mul(inv, points[i].Z);
+        Fp zInv2 = SM2_Fp::sqr(zInv);
+        uint64_t x[4], y[4];
+        SM2_Fp::toInt(SM2_Fp::mul(points[i].X, zInv2), x);
+        SM2_Fp::toInt(SM2_Fp::mul(points[i].Y, SM2_Fp::mul(zInv, zInv2)), y);
+        out[i].k = SM2_Fn::fromInt(k[i]);
+        out[i].x1 = SM2_Fn::fromInt(x);
+        out[i].recovery = (uint8_t)((y[0] & 1) | (U256Const::lessThan(x, SM2_N::MOD) ? 0 : 2));
+    }
+}
+
+// Ԥǩr = (e + x1) mod ns = (1 + d)^-1 * (k - r*d) mod nֻģn˷Ҫʱfalse
+inline bool sm2SignNonce(const SM2_Key& key, const Fn& e, const SM2_Nonce& nonce, SM2_Signature& sig) {
+    sig.r = SM2_Fn::add(e, nonce.x1);
+    if (SM2_Fn::isZero(sig.r) || SM2_Fn::isZero(SM2_Fn::add(sig.r, nonce.k))) {
+        return false;
+    }
+    sig.s = SM2_Fn::mul(key.dPlusOneInv, SM2_Fn::sub(nonce.k, SM2_Fn::mul(sig.r, key.dMont)));
+    sig.recovery = nonce.recovery;
+    return !SM2_Fn::isZero(sig.s);
+}
+
+// ekǩ
+inline bool sm2SignDigest(const SM2_Key& key, const Fn& e, const uint64_t k[4], SM2_Signature& sig) {
+    SM2_Nonce nonce;
+    makeNonces((const uint64_t(*)[4])k, 1, &nonce);
+    return sm2SignNonce(key, e, nonce, sig);
+}
+
+inline SM2_Signature sm2Sign(const SM2_Key& key, const unsigned char* id, size_t idLen, const unsigned char* msg,
+    size_t len) {
+    unsigned char z[32];
+    sm2ComputeZ(id, idLen, key.pub, z);
+    Fn e = sm2Digest(z, msg, len);
+    SM2_Signature sig;
+    uint64_t k[4];
+    do {
+        randomScalar(k);
+    } while (!sm2SignDigest(key, e, k, sig));
+    return sig;
+}
+
+// countԿԣthreads = 0ʱȫ
+inline std::vector<SM2_Key> sm2GenerateKeys(size_t count, unsigned threads = 0) {
+    std::vector<SM2_Key> keys(count);
+    parallelFor(count, threads, [&](size_t i) { keys[i] = SM2_Key::generate(); });
+    return keys;
+}
+
+// ǩԤأ̴̨߳sourceȡk(k, x1)ζУVyukovнMPMCУ
+// ǩʱȡһֻģn˷ÿkֻܱȡһΣӵCAS֤һλֻһߣ
+// 㣻forkӽ̲ٴӳȡ̿ͬһkǩֱ
+class SM2_NoncePool {
+public:
+    struct Stats {
+        size_t depth;       // ǰõ
+        size_t capacity;
+        uint64_t produced;
+        uint64_t consumed;
+        uint64_t misses;    // ȡʱΪյĴ
+        double refillRate;  // ÿ벹̵߳æµʱƣ
+    };
+
+    static constexpr size_t BATCH = 16;
+
+    explicit SM2_NoncePool(size_t capacity = 4096, unsigned threads = 1,
+        std::function<void(uint64_t*)> source = randomScalar)
+        : slots(roundCapacity(capacity)), mask(slots.size() - 1), lowWater(slots.size() / 2),
+          source(std::move(source)), owner(getpid()) {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+        for (unsigned t = 0; t < std::max(1u, threads); ++t) {
+            producers.emplace_back([this] { produce(); });
+        }
+    }
+
+    ~SM2_NoncePool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& th : producers) {
+            th.join();
+        }
+        for (auto& slot : slots) {
+            memset(&slot.nonce, 0, sizeof(slot.nonce));
+        }
+    }
+
+    SM2_NoncePool(const SM2_NoncePool&) = delete;
+    SM2_NoncePool& operator=(const SM2_NoncePool&) = delete;
+
+    // ȡһԤΪʱfalse
+    bool take(SM2_Nonce& out) {
+        if (getpid() != owner) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos & mask];
+            size_t seq = slot->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                misses.fetch_add(1, std::memory_order_relaxed);
+                notifyProducers();
+                return false;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        out = slot->nonce;
+        memset(&slot->nonce, 0, sizeof(slot->nonce));
+        slot->seq.store(pos + mask + 1, std::memory_order_release);
+        consumed.fetch_add(1, std::memory_order_relaxed);
+        if (depth() < lowWater) {
+            notifyProducers();
+        }
+        return true;
+    }
+
+    // ȡһΪʱ
+    SM2_Nonce next() {
+        SM2_Nonce nonce;
+        if (!take(nonce)) {
+            uint64_t k[1][4];
+            source(k[0]);
+            makeNonces(k, 1, &nonce);
+            memset(k, 0, sizeof(k));
+        }
+        return nonce;
+    }
+
+    size_t depth() const {
+        size_t enq = enqueuePos.load(std::memory_order_relaxed);
+        size_t deq = dequeuePos.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    Stats stats() const {
+        Stats st;
+        st.depth = depth();
+        st.capacity = slots.size();
+        st.produced = produced.load(std::memory_order_relaxed);
+        st.consumed = consumed.load(std::memory_order_relaxed);
+        st.misses = misses.load(std::memory_order_relaxed);
+        uint64_t ns = busyNanos.load(std::memory_order_relaxed);
+        st.refillRate = ns ? st.produced * 1e9 / ns : 0.0;
+        return st;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<size_t> seq;
+        SM2_Nonce nonce;
+    };
+
+    static size_t roundCapacity(size_t capacity) {
+        size_t size = BATCH;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    bool push(const SM2_Nonce& nonce) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos & mask];
+            size_t seq = slot->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->nonce = nonce;
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    void notifyProducers() {
+        if (idle.load(std::memory_order_relaxed)) {
+            wake.notify_all();
+        }
+    }
+
+    // ̣߳ÿBATCHһתȫk*Gʱ˯ڰʱף©ѣ
+    void produce() {
+        uint64_t k[BATCH][4];
+        SM2_Nonce batch[BATCH];
+        for (;;) {
+            if (depth() + BATCH > slots.size()) {
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                idle.store(true, std::memory_order_relaxed);
+                wake.wait_for(lock, std::chrono::milliseconds(10),
+                    [this] { return stopping || depth() < lowWater; });
+                idle.store(false, std::memory_order_relaxed);
+                if (stopping) {
+                    break;
+                }
+                continue;
+            }
+            if (stopping) {
+                break;
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < BATCH; ++i) {
+                source(k[i]);
+            }
+            makeNonces(k, BATCH, batch);
+            size_t pushed = 0;
+            while (pushed < BATCH && push(batch[pushed])) {
+                ++pushed;
+            }
+            // ŲµֱӶһ
+            memset(k, 0, sizeof(k));
+            memset(batch, 0, sizeof(batch));
+            produced.fetch_add(pushed, std::memory_order_relaxed);
+            busyNanos.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<Slot> slots;
+    const size_t mask;
+    const size_t lowWater;
+    std::function<void(uint64_t*)> source;
+    const pid_t owner;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+    alignas(64) std::atomic<uint64_t> produced{0};
+    std::atomic<uint64_t> consumed{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> busyNanos{0};
+    std::atomic<bool> idle{false};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::vector<std::thread> producers;
+};
+
+// óеǩ
+inline SM2_Signature sm2Sign(const SM2_Key& key, SM2_NoncePool& pool, const Fn& e) {
+    SM2_Signature sig;
+    SM2_Nonce nonce;
+    do {
+        nonce = pool.next();
+    } while (!sm2SignNonce(key, e, nonce, sig));
+    memset(&nonce, 0, sizeof(nonce));
+    return sig;
+}
+
+// ֤ǰı飺r, s  [1, n-1]t = (r + s) mod n  0stͨʽ
+inline bool verifyScalars(const SM2_Signature& sig, uint64_t s[4], uint64_t t[4]) {
+    Fn tMont = SM2_Fn::add(sig.r, sig.s);
+    if (SM2_Fn::isZero(sig.r) || SM2_Fn::isZero(sig.s) || SM2_Fn::isZero(tMont)) {
+        return false;
+    }
+    SM2_Fn::toInt(sig.s, s);
+    SM2_Fn::toInt(tMont, t);
+    return true;
+}
+
+//  (e + x1) mod n == rx1Ϊqķx꣺x1 < p < 2nѡֵֻc = (r - e) mod nc + nСpʱ
+// ֱӱȽ X == c * Z^2ʡȥת
+inline bool verifyX(const JacobianPoint& q, const Fn& e, const Fn& r) {
+    if (SM2_Fp::isZero(q.Z)) {
+        return false;
+    }
+    uint64_t c[4];
+    SM2_Fn::toInt(SM2_Fn::sub(r, e), c);
+    Fp zz = SM2_Fp::sqr(q.Z);
+    if (SM2_Fp::equal(SM2_Fp::mul(SM2_Fp::fromInt(c), zz), q.X)) {
+        return true;
+    }
+    unsigned long long cn[4];
+    unsigned char carry = 0;
+    for (int i = 0; i < 4; ++i) {
+        carry = _addcarry_u64(carry, c[i], SM2_N::MOD[i], &cn[i]);
+    }
+    uint64_t sum[4] = { cn[0], cn[1], cn[2], cn[3] };
+    return !carry && U256Const::lessThan(sum, SM2_P::MOD) &&
+        SM2_Fp::equal(SM2_Fp::mul(SM2_Fp::fromInt(sum), zz), q.X);
+}
+
+// ֤t = (r + s) mod n(x1, y1) = s*G + t*P (e + x1) mod n == r
+inline bool sm2VerifyDigest(const AffinePoint& pub, const Fn& e, const SM2_Signature& sig) {
+    uint64_t s[4], t[4];
+    if (!isOnCurve(pub) || !verifyScalars(sig, s, t)) {
+        return false;
+    }
+    return verifyX(dualMult(s, t, pub), e, sig.r);
+}
+
+// ʹùԿԤ֤
+inline bool sm2VerifyDigest(const SM2_PublicKeyTable& table, const Fn& e, const SM2_Signature& sig) {
+    uint64_t s[4], t[4];
+    if (!isOnCurve(table.pub) || !verifyScalars(sig, s, t)) {
+        return false;
+    }
+    return verifyX(dualMult(s, t, table.odd.data(), SM2_PublicKeyTable::WIDTH), e, sig.r);
+}
+
+inline bool sm2Verify(const AffinePoint& pub, const unsigned char* id, size_t idLen, const unsigned char* msg,
+    size_t len, const SM2_Signature& sig) {
+    unsigned char z[32];
+    sm2ComputeZ(id, idLen, pub, z);
+    return sm2VerifyDigest(pub, sm2Digest(z, msg, len), sig);
+}
+
+// ȡԿ֤
+inline bool sm2Verify(SM2_PublicKeyCache& cache, const AffinePoint& pub, const unsigned char* id, size_t idLen,
+    const unsigned char* msg, size_t len, const SM2_Signature& sig) {
+    unsigned char z[32];
+    sm2ComputeZ(id, idLen, pub, z);
+    return sm2VerifyDigest(*cache.get(pub), sm2Digest(z, msg, len), sig);
+}
+
+// ZֻûID빫ԿԤòZ֮SM3м״̬
+// ÿϢʡȥZ4ѹENTL || ID || a || b || Gx || Gy || xA || yA
+inline SM3_Prefixed sm2ZHasher(const AffinePoint& pub, const unsigned char* id, size_t idLen) {
+    unsigned char z[32];
+    sm2ComputeZ(id, idLen, pub, z);
+    return SM3_Prefixed(z, sizeof(z));
+}
+
+// ǩģ˽ԿZ֮м״̬
+class SM2_SignerContext {
+public:
+    SM2_SignerContext(const SM2_Key& key, const unsigned char* id, size_t idLen)
+        : key(key), hasher(sm2ZHasher(key.pub, id, idLen)) {}
+
+    Fn digest(const unsigned char* msg, size_t len) const {
+        unsigned char e[32];
+        hasher.hash(msg, len, e);
+        return SM2_Fn::fromBytesReduce(e);
+    }
+
+    SM2_Signature sign(const unsigned char* msg, size_t len) const {
+        Fn e = digest(msg, len);
+        SM2_Signature sig;
+        uint64_t k[4];
+        do {
+            randomScalar(k);
+        } while (!sm2SignDigest(key, e, k, sig));
+        return sig;
+    }
+
+    SM2_Signature sign(const unsigned char* msg, size_t len, SM2_NoncePool& pool) const {
+        return sm2Sign(key, pool, digest(msg, len));
+    }
+
+    const SM2_Key& signingKey() const {
+        return key;
+    }
+
+private:
+    SM2_Key key;
+    SM3_Prefixed hasher;
+};
+
+// ֤ģZ֮SM3м״̬빫ԿwNAFԤͬһԿID
+class SM2_VerifierContext {
+public:
+    SM2_VerifierContext(const unsigned char* id, size_t idLen, const AffinePoint& pub,
+        std::shared_ptr<const SM2_PublicKeyTable> table = nullptr)
+        : hasher(sm2ZHasher(pub, id, idLen)),
+          table(table ? std::move(table) : std::make_shared<const SM2_PublicKeyTable>(pub)) {}
+
+    Fn digest(const unsigned char* msg, size_t len) const {
+        unsigned char e[32];
+        hasher.hash(msg, len, e);
+        return SM2_Fn::fromBytesReduce(e);
+    }
+
+    bool verify(const unsigned char* msg, size_t len, const SM2_Signature& sig) const {
+        return sm2VerifyDigest(*table, digest(msg, len), sig);
+    }
+
+    const AffinePoint& publicKey() const {
+        return table->pub;
+    }
+
+private:
+    SM3_Prefixed hasher;
+    std::shared_ptr<const SM2_PublicKeyTable> table;
+};
+
+// Ļ棺(ID, Կ)Ϊǩ֤ģԿԿ棬ͬһԿĲͬIDһű
+class SM2_ContextCache {
+public:
+    explicit SM2_ContextCache(size_t capacity = 4096) : tables(capacity), verifiers(capacity), signers(capacity) {}
+
+    std::shared_ptr<const SM2_VerifierContext> verifier(const unsigned char* id, size_t idLen,
+        const AffinePoint& pub) {
+        return verifiers.get(cacheKey(id, idLen, pub), [&] {
+            return std::make_shared<const SM2_VerifierContext>(id, idLen, pub, tables.get(pub));
+        });
+    }
+
+    std::shared_ptr<const SM2_SignerContext> signer(const SM2_Key& key, const unsigned char* id, size_t idLen) {
+        return signers.get(cacheKey(id, idLen, key.pub),
+            [&] { return std::make_shared<const SM2_SignerContext>(key, id, idLen); });
+    }
+
+    size_t size() const {
+        return verifiers.size() + signers.size();
+    }
+
+private:
+    SM2_PublicKeyCache tables;
+    SM2_SharedCache<SM2_VerifierContext> verifiers;
+    SM2_SharedCache<SM2_SignerContext> signers;
+
+    // Ϊ ID(2ֽ) || ID || Կ(64ֽ)ͬID빫Կϲ
+    static std::string cacheKey(const unsigned char* id, size_t idLen, const AffinePoint& pub) {
+        std::string key(2 + idLen + 64, '\0');
+        key[0] = (char)(idLen >> 8);
+        key[1] = (char)idLen;
+        memcpy(&key[2], id, idLen);
+        pointToBytes(pub, (unsigned char*)&key[2 + idLen]);
+        return key;
+    }
+};
+
+// ֤һԿe = SM3(Z || M) mod nǩ
+struct SM2_BatchEntry {
+    AffinePoint pub;
+    Fn e;
+    SM2_Signature sig;
+};
+
+// ȡkӵposλwidthλwidth <= 16256λĲΪ0
+inline int scalarBits(const uint64_t k[4], int pos, int width) {
+    if (pos >= 256) {
+        return 0;
+    }
+    int limb = pos / 64;
+    int shift = pos % 64;
+    uint64_t bits = k[limb] >> shift;
+    if (shift + width > 64 && limb < 3) {
+        bits |= k[limb + 1] << (64 - shift);
+    }
+    return (int)(bits & ((1u << width) - 1));
+}
+
+// ֤ʱռ䣺ڵ֮临ãclearͷͬһ̷֤߳ʱٷڴ
+struct SM2_BatchScratch {
+    std::vector<AffinePoint> points;
+    std::vector<std::array<uint64_t, 4>> scalars;
+    std::vector<int16_t> digits;
+    std::vector<JacobianPoint> buckets;
+    std::vector<unsigned char> random;
+    std::vector<int32_t> keySlots; // ѰַԿ -> keyScalars±꣬-1Ϊ
+    std::vector<Fn> keyScalars;
+    std::vector<size_t> keyPositions;
+    std::vector<size_t> batched;
+};
+
+//  sum k_i * P_iPippengerͰÿcλзŴڰѵ㰴ַ2^(c-1)Ͱ
+// Ͱûϼӷۼӣú׺һ sum j * B_j֮cα
+inline JacobianPoint multiScalarMult(const std::vector<AffinePoint>& points,
+    const std::vector<std::array<uint64_t, 4>>& scalars, SM2_BatchScratch& scratch) {
+    size_t count = points.size();
+    if (count == 0) {
+        return infinityPoint();
+    }
+    // ۹ƣÿcountλϼӷԼ11M2^cһӷԼ16M
+    int c = 2;
+    double best = 1e300;
+    for (int w = 2; w <= 16; ++w) {
+        double cost = ((256 + w - 1) / w + 1) * (count * 11.0 + (double)(1 << w) * 16.0);
+        if (cost < best) {
+            best = cost;
+            c = w;
+        }
+    }
+    const int windows = (256 + c - 1) / c + 1;
+    const int half = 1 << (c - 1);
+
+    // з d  [-2^(c-1), 2^(c-1)]recodeSigned4ͬĽλ
+    std::vector<int16_t>& digits = scratch.digits;
+    digits.resize(count * windows);
+    for (size_t i = 0; i < count; ++i) {
+        int carry = 0;
+        for (int w = 0; w < windows; ++w) {
+            int d = scalarBits(scalars[i].data(), w * c, c) + carry;
+            carry = d > half;
+            digits[i * windows + w] = (int16_t)(d - (carry << c));
+        }
+    }
+
+    std::vector<JacobianPoint>& buckets = scratch.buckets;
+    buckets.resize(half);
+    JacobianPoint result = infinityPoint();
+    for (int w = windows - 1; w >= 0; --w) {
+        for (int j = 0; j < c && !SM2_Fp::isZero(result.Z); ++j) {
+            result = pointDouble(result);
+        }
+        std::fill(buckets.begin(), buckets.end(), infinityPoint());
+        for (size_t i = 0; i < count; ++i) {
+            int d = digits[i * windows + w];
+            if (d > 0) {
+                buckets[d - 1] = pointAddMixed(buckets[d - 1], points[i]);
+            }
+            else if (d < 0) {
+                buckets[-d - 1] = pointAddMixed(buckets[-d - 1], negate(points[i]));
+            }
+        }
+        JacobianPoint running = infinityPoint();
+        JacobianPoint sum = infinityPoint();
+        for (int j = half - 1; j >= 0; --j) {
+            running = pointAdd(running, buckets[j]);
+            sum = pointAdd(sum, running);
+        }
+        result = pointAdd(result, sum);
+    }
+    return result;
+}
+
+// rerecoveryָ R = s*G + t*Px1 = (r - e) mod nbit1λʱټnyƽżȷ
+inline bool recoverR(const Fn& e, const SM2_Signature& sig, AffinePoint& point) {
+    if (sig.recovery > 3) {
+        return false;
+    }
+    uint64_t x[4];
+    SM2_Fn::toInt(SM2_Fn::sub(sig.r, e), x);
+    if (sig.recovery & 2) {
+        unsigned long long sum[4];
+        unsigned char carry = 0;
+        for (int i = 0; i < 4; ++i) {
+            carry = _addcarry_u64(carry, x[i], SM2_N::MOD[i], &sum[i]);
+        }
+        for (int i = 0; i < 4; ++i) {
+            x[i] = sum[i];
+        }
+        if (carry || !U256Const::lessThan(x, SM2_P::MOD)) {
+            return false;
+        }
+    }
+    point.x = SM2_Fp::fromInt(x);
+    Fp rhs = SM2_Fp::add(SM2_Fp::mul(SM2_Fp::add(SM2_Fp::sqr(point.x), SM2_Curve::A), point.x), SM2_Curve::B);
+    if (!fpSqrt(rhs, point.y)) {
+        return false;
+    }
+    uint64_t y[4];
+    SM2_Fp::toInt(point.y, y);
+    if ((y[0] & 1) != (uint64_t)(sig.recovery & 1)) {
+        point.y = SM2_Fp::neg(point.y);
+    }
+    return true;
+}
+
+// ֤ȡ128λϵz_i (sum z_i*s_i)*G + sum (z_i*t_i)*P_i - sum z_i*R_i = O
+// ͬԿϵȺϲG̶һζˡûrecovery޷ָR֤
+// ʽʱ֤ڸҳʧܵǩvalid[i]ÿһĽȫͨʱtrue
+inline bool sm2VerifyBatch(const SM2_BatchEntry* entries, size_t count, bool* valid, SM2_BatchScratch& scratch) {
+    std::vector<AffinePoint>& points = scratch.points;
+    std::vector<std::array<uint64_t, 4>>& scalars = scratch.scalars;
+    std::vector<Fn>& keyScalars = scratch.keyScalars;
+    std::vector<size_t>& keyPositions = scratch.keyPositions;
+    std::vector<size_t>& batched = scratch.batched;
+    points.clear();
+    scalars.clear();
+    keyScalars.clear();
+    keyPositions.clear();
+    batched.clear();
+    size_t slotCount = 16;
+    while (slotCount < count * 2) {
+        slotCount *= 2;
+    }
+    scratch.keySlots.assign(slotCount, -1);
+    Fn gScalar = SM2_Fn::zero();
+
+    std::vector<unsigned char>& random = scratch.random;
+    random.resize(count * 16);
+    threadCtrDrbg().read(random.data(), random.size());
+
+    bool all = true;
+    for (size_t i = 0; i < count; ++i) {
+        const SM2_BatchEntry& entry = entries[i];
+        uint64_t s[4], t[4];
+        AffinePoint r;
+        if (!isOnCurve(entry.pub) || !verifyScalars(entry.sig, s, t)) {
+            valid[i] = false;
+            all = false;
+            continue;
+        }
+        if (!recoverR(entry.e, entry.sig, r)) {
+            valid[i] = sm2VerifyDigest(entry.pub, entry.e, entry.sig);
+            all = all && valid[i];
+            continue;
+        }
+        batched.push_back(i);
+        uint64_t z[4] = { 0, 0, 0, 0 };
+        memcpy(z, random.data() + i * 16, 16);
+        z[0] |= 1; // ֤ϵ0
+        Fn zMont = SM2_Fn::fromInt(z);
+        gScalar = SM2_Fn::add(gScalar, SM2_Fn::mul(zMont, entry.sig.s));
+
+        // xĵλ̽⣬ҵͬԿʱϲϵ
+        Fn zt = SM2_Fn::mul(zMont, SM2_Fn::add(entry.sig.r, entry.sig.s));
+        size_t slot = (size_t)(entry.pub.x.v[0] ^ (entry.pub.x.v[0] >> 29)) & (slotCount - 1);
+        for (;;) {
+            int32_t index = scratch.keySlots[slot];
+            if (index < 0) {
+                scratch.keySlots[slot] = (int32_t)keyScalars.size();
+                keyScalars.push_back(zt);
+                keyPositions.push_back(points.size());
+                points.push_back(entry.pub);
+                scalars.push_back({ 0, 0, 0, 0 });
+                break;
+            }
+            const AffinePoint& known = points[keyPositions[index]];
+            if (SM2_Fp::equal(known.x, entry.pub.x) && SM2_Fp::equal(known.y, entry.pub.y)) {
+                keyScalars[index] = SM2_Fn::add(keyScalars[index], zt);
+                break;
+            }
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        // -z_i*R_iΪ z_i*(-R_i) 
+        points.push_back(negate(r));
+        scalars.push_back({ z[0], z[1], 0, 0 });
+    }
+    if (batched.empty()) {
+        return all;
+    }
+
+    for (size_t i = 0; i < keyScalars.size(); ++i) {
+        SM2_Fn::toInt(keyScalars[i], scalars[keyPositions[i]].data());
+    }
+    uint64_t g[4];
+    SM2_Fn::toInt(gScalar, g);
+    JacobianPoint total = pointAdd(baseMult(g), multiScalarMult(points, scalars, scratch));
+    if (SM2_Fp::isZero(total.Z)) {
+        for (size_t i : batched) {
+            valid[i] = true;
+        }
+        return all;
+    }
+    for (size_t i : batched) {
+        valid[i] = sm2VerifyDigest(entries[i].pub, entries[i].e, entries[i].sig);
+        all = all && valid[i];
+    }
+    return all;
+}
+
+inline bool sm2VerifyBatch(const SM2_BatchEntry* entries, size_t count, bool* valid) {
+    SM2_BatchScratch scratch;
+    return sm2VerifyBatch(entries, count, valid, scratch);
+}
+
+// ---------------- ԿܣGB/T 32918.4 ----------------
+// ĲC1 || C3 || C2C1 = 04 || x1 || y165ֽڣC3 = SM3(x2 || M || y2)C2 = M ^ KDF(x2 || y2, klen)
+constexpr size_t SM2_C1_SIZE = 65;
+constexpr size_t SM2_CIPHER_OVERHEAD = SM2_C1_SIZE + 32;
+
+// out = in ^ keyAVX2ÿδ32ֽڣkeyֽڵİλжԿǷȫΪ0
+inline unsigned char xorBytes(const unsigned char* in, const unsigned char* key, unsigned char* out, size_t len) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i k = _mm256_loadu_si256((const __m256i*)(key + i));
+        acc = _mm256_or_si256(acc, k);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(in + i)), k));
+    }
+    unsigned char any = _mm256_testz_si256(acc, acc) ? 0 : 1;
+    for (; i < len; ++i) {
+        any |= key[i];
+        out[i] = in[i] ^ key[i];
+    }
+    return any;
+}
+
+// SM3-KDFԿǰ׺x2 || y2ǡһ飬ֻѹһκ󱣴Ϊм״̬
+// ֮ÿΰһ飨Ϣ8飨໺ں˲ѹ
+class SM2_KdfStream {
+public:
+    void init(const unsigned char xy[64]) {
+        SM3_Optimized sm3;
+        sm3.update(xy, 64);
+        midstate = sm3.exportState();
+        counter = 1;
+        used = avail = 0;
+        total = 0;
+        nonZero = 0;
+    }
+
+    // out = in ^ Կoutinͬ
+    void apply(const unsigned char* in, unsigned char* out, size_t len) {
+        while (len) {
+            if (used == avail) {
+                refill(len);
+            }
+            size_t n = std::min(len, avail - used);
+            nonZero |= xorBytes(in, block + used, out, n);
+            used += n;
+            total += n;
+            in += n;
+            out += n;
+            len -= n;
+        }
+    }
+
+    // ùԿǷȫΪ0׼Ҫʱk¼ܣ򱨴Ϣ
+    bool allZero() const {
+        return total > 0 && nonZero == 0;
+    }
+
+private:
+    SM3State midstate;
+    uint32_t counter;
+    size_t used;
+    size_t avail;
+    uint64_t total;
+    unsigned char nonZero;
+    alignas(32) unsigned char block[SM3_MB::LANES * 32];
+
+    void refill(size_t want) {
+        unsigned char counters[SM3_MB::LANES][4];
+        const unsigned char* msg[SM3_MB::LANES];
+        int lanes = want <= 32 ? 1 : SM3_MB::LANES;
+        for (int l = 0; l < lanes; ++l, ++counter) {
+            counters[l][0] = (unsigned char)(counter >> 24);
+            counters[l][1] = (unsigned char)(counter >> 16);
+            counters[l][2] = (unsigned char)(counter >> 8);
+            counters[l][3] = (unsigned char)counter;
+            msg[l] = counters[l];
+        }
+        if (lanes == 1) {
+            SM3_Optimized sm3;
+            sm3.importState(midstate);
+            sm3.update(counters[0], 4);
+            sm3.final(block);
+        }
+        else {
+            SM3_MB::hash(midstate, msg, 4, (unsigned char(*)[32])block);
+        }
+        used = 0;
+        avail = (size_t)lanes * 32;
+    }
+};
+
+// ӽܹõ״̬ɹ(x2, y2)ʼԿC3Ĺϣx2
+struct SM2_CipherState {
+    SM2_KdfStream kdf;
+    SM3_Optimized c3;
+    unsigned char y2[32];
+
+    void init(const AffinePoint& shared) {
+        unsigned char xy[64];
+        pointToBytes(shared, xy);
+        kdf.init(xy);
+        c3.reset();
+        c3.update(xy, 32);
+        memcpy(y2, xy + 32, 32);
+        memset(xy, 0, sizeof(xy));
+    }
+
+    void finalC3(unsigned char out[32]) {
+        c3.update(y2, 32);
+        c3.final(out);
+        memset(y2, 0, sizeof(y2));
+    }
+};
+
+// ܽշԿѡĹ̶ͬһԿܣװԿʱk*Pk*Gһ
+struct SM2_Recipient {
+    AffinePoint pub;
+    bool valid;
+    std::unique_ptr<SM2_BaseTable> table;
+
+    explicit SM2_Recipient(const AffinePoint& p, bool precompute = true) : pub(p), valid(isOnCurve(p)) {
+        if (valid && precompute) {
+            table = makeFixedBaseTable(p);
+        }
+    }
+};
+
+// ʽܣbeginдC1updateμܲͬһаսC3finishC3
+// ˳ΪC1 || C3 || C2ʱ÷ΪC332ֽڣ
+class SM2_Encryptor {
+public:
+    // շԿϷʱfalse
+    bool begin(const SM2_Recipient& recipient, unsigned char c1[SM2_C1_SIZE]) {
+        if (!recipient.valid) {
+            return false;
+        }
+        uint64_t k[4];
+        randomScalar(k);
+        AffinePoint p1, shared;
+        toAffine(baseMultConst(k), p1);
+        if (recipient.table) {
+            toAffine(fixedBaseMultConst(*recipient.table, k), shared);
+        }
+        else {
+            shared = ladderMult(k, recipient.pub);
+        }
+        memset(k, 0, sizeof(k));
+        c1[0] = 0x04;
+        pointToBytes(p1, c1 + 1);
+        state.init(shared);
+        return true;
+    }
+
+    // outinͬȽC3Ĺϣٱ
+    void update(const unsigned char* in, unsigned char* out, size_t len) {
+        const size_t chunk = 4096;
+        for (size_t off = 0; off < len; off += chunk) {
+            size_t n = std::min(chunk, len - off);
+            state.c3.update(in + off, n);
+            state.kdf.apply(in + off, out + off, n);
+        }
+    }
+
+    // ԿȫΪ0ʱfalse軻k¼ܣֻܳڼ̵Ϣϣ
+    bool finish(unsigned char c3[32]) {
+        state.finalC3(c3);
+        return !state.kdf.allZero();
+    }
+
+private:
+    SM2_CipherState state;
+};
+
+// ʽܣC3ǰʱȽϣУ֮ͨǰĲʹ
+class SM2_Decryptor {
+public:
+    // C1ʱfalse
+    bool begin(const SM2_Key& key, const unsigned char c1[SM2_C1_SIZE], const unsigned char c3[32]) {
+        AffinePoint p1;
+        if (c1[0] != 0x04 || !SM2_Fp::fromBytes(c1 + 1, p1.x) || !SM2_Fp::fromBytes(c1 + 33, p1.y) ||
+            !isOnCurve(p1)) {
+            return false;
+        }
+        state.init(ladderMult(key.d, p1));
+        memcpy(expected, c3, 32);
+        return true;
+    }
+
+    void update(const unsigned char* in, unsigned char* out, size_t len) {
+        const size_t chunk = 4096;
+        for (size_t off = 0; off < len; off += chunk) {
+            size_t n = std::min(chunk, len - off);
+            state.kdf.apply(in + off, out + off, n);
+            state.c3.update(out + off, n);
+        }
+    }
+
+    // C3һԿȫΪ0ʱtrueȽϲǰ˳
+    bool finish() {
+        unsigned char c3[32];
+        state.finalC3(c3);
+        unsigned char diff = 0;
+        for (int i = 0; i < 32; ++i) {
+            diff |= c3[i] ^ expected[i];
+        }
+        return diff == 0 && !state.kdf.allZero();
+    }
+
+private:
+    SM2_CipherState state;
+    unsigned char expected[32];
+};
+
+// һԼܣoutҪlen + SM2_CIPHER_OVERHEADֽڣֱдC1 || C3 || C2
+inline bool sm2Encrypt(const SM2_Recipient& recipient, const unsigned char* msg, size_t len, unsigned char* out) {
+    for (;;) {
+        SM2_Encryptor enc;
+        if (!enc.begin(recipient, out)) {
+            return false;
+        }
+        enc.update(msg, out + SM2_CIPHER_OVERHEAD, len);
+        if (enc.finish(out + SM2_C1_SIZE)) {
+            return true;
+        }
+    }
+}
+
+// һԽܣoutҪlen - SM2_CIPHER_OVERHEADֽڣʧʱ
+inline bool sm2Decrypt(const SM2_Key& key, const unsigned char* cipher, size_t len, unsigned char* out) {
+    if (len < SM2_CIPHER_OVERHEAD) {
+        return false;
+    }
+    SM2_Decryptor dec;
+    if (!dec.begin(key, cipher, cipher + SM2_C1_SIZE)) {
+        return false;
+    }
+    size_t msgLen = len - SM2_CIPHER_OVERHEAD;
+    dec.update(cipher + SM2_CIPHER_OVERHEAD, out, msgLen);
+    if (!dec.finish()) {
+        memset(out, 0, msgLen);
+        return false;
+    }
+    return true;
+}
+
+// lenֽڣļβʱʵʶֽ-1
+inline ssize_t readFull(int fd, unsigned char* buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, buf + got, len - got);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        got += (size_t)n;
+    }
+    return (ssize_t)got;
+}
+
+inline bool writeFull(int fd, const unsigned char* buf, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, buf, len);
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// ļʽܣдC1ռλC31MBֿԭؼдC2pwriteC3ڴռļС޹
+inline bool sm2EncryptFile(const SM2_Recipient& recipient, const std::string& inPath, const std::string& outPath) {
+    const size_t chunk = 1 << 20;
+    std::unique_ptr<unsigned char[]> buf(new unsigned char[chunk]);
+    for (;;) {
+        int in = ::open(inPath.c_str(), O_RDONLY);
+        if (in < 0) {
+            return false;
+        }
+        int out = ::open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0) {
+            close(in);
+            return false;
+        }
+        SM2_Encryptor enc;
+        unsigned char header[SM2_CIPHER_OVERHEAD] = { 0 };
+        bool ok = enc.begin(recipient, header) && writeFull(out, header, sizeof(header));
+        ssize_t n = 0;
+        while (ok && (n = readFull(in, buf.get(), chunk)) > 0) {
+            enc.update(buf.get(), buf.get(), (size_t)n);
+            ok = writeFull(out, buf.get(), (size_t)n);
+        }
+        ok = ok && n == 0;
+        bool usable = enc.finish(header + SM2_C1_SIZE);
+        ok = ok && pwrite(out, header + SM2_C1_SIZE, 32, SM2_C1_SIZE) == 32;
+        close(in);
+        ok = close(out) == 0 && ok;
+        if (!ok || usable) {
+            if (!ok) {
+                unlink(outPath.c_str());
+            }
+            return ok;
+        }
+    }
+}
+
+// ļʽܣдͬһĿ¼mkstempʱļC3УͨfsyncrenameΪoutPath
+// ʧʱɾʱļoutPathԭеݲӰ죬ҲδУ
+inline bool sm2DecryptFile(const SM2_Key& key, const std::string& inPath, const std::string& outPath) {
+    int in = ::open(inPath.c_str(), O_RDONLY);
+    if (in < 0) {
+        return false;
+    }
+    std::string tmpPath = outPath + ".XXXXXX";
+    int out = mkstemp(&tmpPath[0]);
+    if (out < 0) {
+        close(in);
+        return false;
+    }
+    const size_t chunk = 1 << 20;
+    std::unique_ptr<unsigned char[]> buf(new unsigned char[chunk]);
+    unsigned char header[SM2_CIPHER_OVERHEAD];
+    SM2_Decryptor dec;
+    bool ok = readFull(in, header, sizeof(header)) == (ssize_t)sizeof(header) &&
+        dec.begin(key, header, header + SM2_C1_SIZE);
+    ssize_t n = 0;
+    while (ok && (n = readFull(in, buf.get(), chunk)) > 0) {
+        dec.update(buf.get(), buf.get(), (size_t)n);
+        ok = writeFull(out, buf.get(), (size_t)n);
+    }
+    ok = ok && n == 0 && dec.finish() && fsync(out) == 0;
+    close(in);
+    ok = close(out) == 0 && ok;
+    ok = ok && rename(tmpPath.c_str(), outPath.c_str()) == 0;
+    if (!ok) {
+        unlink(tmpPath.c_str());
+    }
+    return ok;
+}
+
+// ӡ256λʮƣ
+template <class Field>
+void printElem(const char* label, const typename Field::Elem& a) {
+    unsigned char bytes[32];
+    Field::toBytes(a, bytes);
+    std::cout << label;
+    for (int i = 0; i < 32; ++i) {
+        std::cout << std::hex << std::setw(2) << std::setfill('0') << (int)bytes[i];
+    }
+    std::cout << std::dec << std::endl;
+}
+
+// ԣ߷̣桢ƽӼ˵Ĵϵ
+void testField() {
+    std::mt19937_64 rng(2025);
+    Fp gx = SM2_Curve::GX;
+    Fp rhs = SM2_Fp::add(SM2_Fp::mul(SM2_Fp::add(SM2_Fp::sqr(gx), SM2_Curve::A), gx), SM2_Curve::B);
+    std::cout << "Base point on curve: " << (SM2_Fp::equal(SM2_Fp::sqr(SM2_Curve::GY), rhs) ? "yes" : "no") << std::endl;
+
+    int bad = 0;
+    const int rounds = 10000;
+    for (int i = 0; i < rounds; ++i) {
+        uint64_t x[4] = { rng(), rng(), rng(), rng() >> 1 };
+        uint64_t y[4] = { rng(), rng(), rng(), rng() >> 1 };
+        Fp a = SM2_Fp::fromInt(x);
+        Fp b = SM2_Fp::fromInt(y);
+        bad += !SM2_Fp::equal(SM2_Fp::sub(SM2_Fp::add(a, b), b), a);
+        bad += !SM2_Fp::equal(SM2_Fp::mul(fpInv(a), a), SM2_Fp::one());
+        bad += !SM2_Fp::equal(fpInv(a), SM2_Fp::inv(a));
+        bad += !SM2_Fp::equal(SM2_Fp::mul(SM2_Fp::add(a, b), SM2_Fp::sub(a, b)),
+            SM2_Fp::sub(SM2_Fp::sqr(a), SM2_Fp::sqr(b)));
+        Fp root;
+        bad += !fpSqrt(SM2_Fp::sqr(a), root) || !SM2_Fp::equal(SM2_Fp::sqr(root), SM2_Fp::sqr(a));
+
+        Fn c = SM2_Fn::fromInt(x);
+        bad += !SM2_Fn::equal(SM2_Fn::mul(SM2_Fn::inv(c), c), SM2_Fn::one());
+    }
+    std::cout << "Field identities over " << rounds << " random elements: " << (bad == 0 ? "all passed" : "FAILED")
+        << std::endl;
+
+    // (n - 1)^2 mod n = 1
+    uint64_t nm1[4] = { SM2_N::MOD[0] - 1, SM2_N::MOD[1], SM2_N::MOD[2], SM2_N::MOD[3] };
+    Fn m1 = SM2_Fn::fromInt(nm1);
+    std::cout << "(n-1)^2 mod n == 1: " << (SM2_Fn::equal(SM2_Fn::sqr(m1), SM2_Fn::one()) ? "yes" : "no") << std::endl;
+}
+
+// ܲ
+void fieldPerformanceTest() {
+    const int iterations = 10000000;
+    Fp a = SM2_Curve::GX;
+    Fp b = SM2_Curve::GY;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        a = SM2_Fp::mul(a, b);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double mulTime = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        b = SM2_Fp::add(b, a);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double addTime = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+
+    const int invIterations = 100000;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < invIterations; ++i) {
+        a = fpInv(a);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double invTime = std::chrono::duration<double, std::micro>(end - start).count() / invIterations;
+
+    Fn c = SM2_Fn::fromInt(12345);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < invIterations; ++i) {
+        c = SM2_Fn::inv(c);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double scalarInvTime = std::chrono::duration<double, std::micro>(end - start).count() / invIterations;
+
+    std::cout << "Fp multiplication: " << mulTime << " ns" << std::endl;
+    std::cout << "Fp addition: " << addTime << " ns" << std::endl;
+    std::cout << "Fp inversion (addition chain): " << invTime << " us" << std::endl;
+    std::cout << "Fn inversion (fixed window): " << scalarInvTime << " us" << std::endl;
+    // ֹѭŻ
+    std::cout << "Checksum: " << ((a.v[0] ^ b.v[0] ^ c.v[0]) & 0xFF) << std::endl;
+}
+
+// ǩԣn*GΪԶ㣬봰ڷһ£ǩ֤Ҵ۸ĺʧ
+void testSignature() {
+    uint64_t nm1[4] = { SM2_N::MOD[0] - 1, SM2_N::MOD[1], SM2_N::MOD[2], SM2_N::MOD[3] };
+    AffinePoint p;
+    bool finite = toAffine(pointAddMixed(baseMult(nm1), SM2_G), p);
+    std::cout << "n*G is the point at infinity: " << (!finite ? "yes" : "no") << std::endl;
+
+    int bad = 0;
+    for (int i = 0; i < 200; ++i) {
+        uint64_t k[4];
+        randomScalar(k);
+        AffinePoint a = {}, b = {};
+        toAffine(baseMult(k), a);
+        toAffine(pointMult(k, SM2_G), b);
+        bad += !isOnCurve(a) || !SM2_Fp::equal(a.x, b.x) || !SM2_Fp::equal(a.y, b.y);
+    }
+    std::cout << "Fixed-base table matches windowed multiplication: " << (bad == 0 ? "yes" : "no") << std::endl;
+
+    // wNAFֿ s*G + t*P һ£빫Կ·
+    bad = 0;
+    for (int i = 0; i < 100; ++i) {
+        uint64_t s[4], t[4], d[4];
+        randomScalar(s);
+        randomScalar(t);
+        randomScalar(d);
+        AffinePoint q = {}, a = {}, b = {}, c = {};
+        toAffine(baseMult(d), q);
+        SM2_PublicKeyTable table(q);
+        toAffine(pointAdd(baseMult(s), pointMult(t, q)), a);
+        toAffine(dualMult(s, t, q), b);
+        toAffine(dualMult(s, t, table.odd.data(), SM2_PublicKeyTable::WIDTH), c);
+        bad += !SM2_Fp::equal(a.x, b.x) || !SM2_Fp::equal(a.y, b.y) || !SM2_Fp::equal(a.x, c.x) ||
+            !SM2_Fp::equal(a.y, c.y);
+    }
+    std::cout << "Interleaved wNAF matches separate multiplication: " << (bad == 0 ? "yes" : "no") << std::endl;
+
+    SM2_Key key = SM2_Key::generate();
+    const std::string id = "alice@example.com";
+    const std::string message = "Hello, SM2!";
+    SM2_Signature sig = sm2Sign(key, (const unsigned char*)id.data(), id.size(),
+        (const unsigned char*)message.data(), message.size());
+    printElem<SM2_Fn>("Signature r: ", sig.r);
+    printElem<SM2_Fn>("Signature s: ", sig.s);
+    bool valid = sm2Verify(key.pub, (const unsigned char*)id.data(), id.size(),
+        (const unsigned char*)message.data(), message.size(), sig);
+    const std::string forged = "Hello, SM3!";
+    bool forgedValid = sm2Verify(key.pub, (const unsigned char*)id.data(), id.size(),
+        (const unsigned char*)forged.data(), forged.size(), sig);
+    std::cout << "Signature verified: " << (valid ? "true" : "false") << ", altered message rejected: "
+        << (!forgedValid ? "yes" : "no") << std::endl;
+
+    SM2_PublicKeyCache cache(2);
+    bool cachedValid = sm2Verify(cache, key.pub, (const unsigned char*)id.data(), id.size(),
+        (const unsigned char*)message.data(), message.size(), sig);
+    bool cachedForged = sm2Verify(cache, key.pub, (const unsigned char*)id.data(), id.size(),
+        (const unsigned char*)forged.data(), forged.size(), sig);
+    std::cout << "Cached table verification: " << (cachedValid && !cachedForged ? "passed" : "FAILED")
+        << " (" << cache.size() << " table cached)" << std::endl;
+}
+
+// ǩ֤ܲ
+void signPerformanceTest() {
+    SM2_Key key = SM2_Key::generate();
+    const std::string id = "alice@example.com";
+    const std::string message = "Hello, SM2!";
+
+    const int keys = 2000;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < keys; ++i) {
+        SM2_Key::generate();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double keyTime = std::chrono::duration<double>(end - start).count();
+
+    const int signatures = 20000;
+    std::vector<SM2_Signature> sigs(signatures);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < signatures; ++i) {
+        sigs[i] = sm2Sign(key, (const unsigned char*)id.data(), id.size(),
+            (const unsigned char*)message.data(), message.size());
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double signTime = std::chrono::duration<double>(end - start).count();
+
+    const int verifies = 5000;
+    int passed = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < verifies; ++i) {
+        passed += sm2Verify(key.pub, (const unsigned char*)id.data(), id.size(),
+            (const unsigned char*)message.data(), message.size(), sigs[i]);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double verifyTime = std::chrono::duration<double>(end - start).count();
+
+    SM2_PublicKeyCache cache;
+    int cachedPassed = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < verifies; ++i) {
+        cachedPassed += sm2Verify(cache, key.pub, (const unsigned char*)id.data(), id.size(),
+            (const unsigned char*)message.data(), message.size(), sigs[i]);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double cachedTime = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "Key generation: " << keys / keyTime << " keys/s" << std::endl;
+    std::cout << "Signing: " << signatures / signTime << " signatures/s" << std::endl;
+    std::cout << "Verification: " << verifies / verifyTime << " verifications/s (" << passed << " valid)" << std::endl;
+    std::cout << "Verification with cached key table: " << verifies / cachedTime << " verifications/s ("
+        << cachedPassed << " valid)" << std::endl;
+}
+
+// ʱ˲ԣɱʱ汾һ£x = 0ĵ㣩
+void testConstantTime() {
+    int bad = 0;
+    for (int i = 0; i < 100; ++i) {
+        uint64_t k[4], d[4];
+        randomScalar(k);
+        randomScalar(d);
+        AffinePoint q = {}, a = {}, b = {}, c = {}, e = {};
+        toAffine(baseMult(d), q);
+        toAffine(baseMult(k), a);
+        toAffine(baseMultConst(k), b);
+        c = ladderMult(k, q);
+        toAffine(pointMult(k, q), e);
+        bad += !SM2_Fp::equal(a.x, b.x) || !SM2_Fp::equal(a.y, b.y) || !SM2_Fp::equal(c.x, e.x) ||
+            !SM2_Fp::equal(c.y, e.y);
+    }
+    std::cout << "Constant-time paths match variable-time paths: " << (bad == 0 ? "yes" : "no") << std::endl;
+
+    // ߽k = 1234n-4 ... n-1ߵɱʱ·Ƚ
+    bad = 0;
+    const uint64_t small[] = { 1, 2, 3, 4 };
+    for (int i = 0; i < 8; ++i) {
+        uint64_t k[4] = { 0, 0, 0, 0 }, d[4];
+        if (i < 4) {
+            k[0] = small[i];
+        }
+        else {
+            memcpy(k, SM2_N::MOD, sizeof(k));
+            k[0] -= small[i - 4];
+        }
+        randomScalar(d);
+        AffinePoint q = {}, a = {}, b = {}, c = {}, e = {};
+        toAffine(baseMult(d), q);
+        toAffine(baseMult(k), a);
+        toAffine(baseMultConst(k), b);
+        c = ladderMult(k, q);
+        toAffine(pointMult(k, q), e);
+        bad += !SM2_Fp::equal(a.x, b.x) || !SM2_Fp::equal(a.y, b.y) || !SM2_Fp::equal(c.x, e.x) ||
+            !SM2_Fp::equal(c.y, e.y);
+        c = ladderMult(k, SM2_G);
+        bad += !SM2_Fp::equal(a.x, c.x) || !SM2_Fp::equal(a.y, c.y);
+    }
+    std::cout << "Constant-time paths at k = 1..4 and n-4..n-1: " << (bad == 0 ? "correct" : "WRONG") << std::endl;
+
+    // x = 0ĵ㣺y = sqrt(b)
+    AffinePoint zeroX = { SM2_Fp::zero(), SM2_Fp::zero() };
+    fpSqrt(SM2_Curve::B, zeroX.y);
+    uint64_t k[4];
+    randomScalar(k);
+    AffinePoint a = ladderMult(k, zeroX), b = {};
+    toAffine(pointMult(k, zeroX), b);
+    std::cout << "Ladder handles x = 0: " << (SM2_Fp::equal(a.x, b.x) && SM2_Fp::equal(a.y, b.y) ? "yes" : "no")
+        << std::endl;
+}
+
+// ͳƼʱԣdudectʽWelch t飩̶棬Ƚֲ
+// |t| > 4.5Ϊ֣ɱʱbaseMultڹ̶0ʱӦԿ
+template <class Mult>
+double timingTStatistic(Mult mult, int samples) {
+    // ̶ֻ4λ
+    const uint64_t fixedK[4] = { 0x10, 0, 0, 0x1000000000000000 };
+    std::mt19937_64 rng(7);
+    double sum[2] = { 0, 0 }, sumSq[2] = { 0, 0 };
+    int count[2] = { 0, 0 };
+    volatile uint64_t sink = 0;
+    for (int i = 0; i < samples; ++i) {
+        int cls = (int)(rng() & 1);
+        uint64_t k[4];
+        if (cls == 0) {
+            memcpy(k, fixedK, sizeof(k));
+        }
+        else {
+            randomScalar(k);
+        }
+        uint64_t start = __rdtsc();
+        sink = sink ^ mult(k);
+        double cycles = (double)(__rdtsc() - start);
+        sum[cls] += cycles;
+        sumSq[cls] += cycles * cycles;
+        ++count[cls];
+    }
+    double mean[2], var[2];
+    for (int c = 0; c < 2; ++c) {
+        mean[c] = sum[c] / count[c];
+        var[c] = sumSq[c] / count[c] - mean[c] * mean[c];
+    }
+    return (mean[0] - mean[1]) / std::sqrt(var[0] / count[0] + var[1] / count[1]);
+}
+
+// ʱ·ļʱԿɱʱ·ٶ
+void constantTimePerformanceTest() {
+    AffinePoint q = {};
+    uint64_t d[4];
+    randomScalar(d);
+    toAffine(baseMult(d), q);
+    auto variableBase = [](const uint64_t* k) { return baseMult(k).X.v[0]; };
+    auto constBase = [](const uint64_t* k) { return baseMultConst(k).X.v[0]; };
+    auto variablePoint = [&q](const uint64_t* k) { return pointMult(k, q).X.v[0]; };
+    auto ladder = [&q](const uint64_t* k) { return ladderMult(k, q).x.v[0]; };
+
+    std::cout << "Timing t-statistic (|t| < 4.5 passes): baseMult " << timingTStatistic(variableBase, 4000)
+        << ", baseMultConst " << timingTStatistic(constBase, 4000) << ", pointMult "
+        << timingTStatistic(variablePoint, 1000) << ", ladderMult " << timingTStatistic(ladder, 1000) << std::endl;
+
+    const int rounds = 2000;
+    uint64_t k[4];
+    randomScalar(k);
+    uint64_t sink = 0;
+    auto time = [&](auto mult, int n) {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < n; ++i) {
+            k[0] += i;
+            sink ^= mult(k);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::micro>(end - start).count() / n;
+    };
+    double vb = time(variableBase, rounds), cb = time(constBase, rounds);
+    double vp = time(variablePoint, rounds / 4), lp = time(ladder, rounds / 4);
+    std::cout << "k*G: variable " << vb << " us, constant-time " << cb << " us (" << cb / vb << "x)" << std::endl;
+    std::cout << "k*P: variable " << vp << " us, constant-time ladder " << lp << " us (" << lp / vp << "x)"
+        << std::endl;
+    std::cout << "Checksum: " << (sink & 0xFF) << std::endl;
+}
+
+#ifdef SM2_CT_VALGRIND
+// valgrindУܱΪδʼʱ·κķַ֧ᱻmemcheck
+void valgrindSecretCheck() {
+    uint64_t k[4];
+    randomScalar(k);
+    AffinePoint q = SM2_G;
+    VALGRIND_MAKE_MEM_UNDEFINED(k, sizeof(k));
+    JacobianPoint a = baseMultConst(k);
+    AffinePoint b = ladderMult(k, q);
+    VALGRIND_MAKE_MEM_DEFINED(k, sizeof(k));
+    VALGRIND_MAKE_MEM_DEFINED(&a, sizeof(a));
+    VALGRIND_MAKE_MEM_DEFINED(&b, sizeof(b));
+    std::cout << "Secret-as-uninitialized run finished" << std::endl;
+}
+#endif
+
+// ܲԣֶԿsm3KDFһ£ӽ·۸ĺʧܣļʽ
+void testEncryption() {
+    std::mt19937_64 rng(41);
+    unsigned char xy[64];
+    for (auto& b : xy) {
+        b = (unsigned char)rng();
+    }
+    int bad = 0;
+    for (size_t len : { 1, 31, 32, 33, 255, 256, 257, 1000, 5000 }) {
+        std::vector<unsigned char> expected(len), zeros(len, 0), got(len);
+        sm3KDF(xy, 64, expected.data(), len);
+        SM2_KdfStream kdf;
+        kdf.init(xy);
+        for (size_t off = 0; off < len;) {
+            size_t n = std::min<size_t>(len - off, 1 + rng() % 300);
+            kdf.apply(zeros.data() + off, got.data() + off, n);
+            off += n;
+        }
+        bad += got != expected;
+    }
+    std::cout << "Streamed KDF matches sm3KDF: " << (bad == 0 ? "yes" : "no") << std::endl;
+
+    SM2_Key key = SM2_Key::generate();
+    SM2_Recipient withTable(key.pub), withLadder(key.pub, false);
+    bad = 0;
+    for (size_t len : { 0, 1, 16, 32, 100, 4097, 70000 }) {
+        std::vector<unsigned char> msg(len), cipher(len + SM2_CIPHER_OVERHEAD), plain(len);
+        for (auto& b : msg) {
+            b = (unsigned char)rng();
+        }
+        for (const SM2_Recipient* r : { &withTable, &withLadder }) {
+            bad += !sm2Encrypt(*r, msg.data(), len, cipher.data());
+            bad += !sm2Decrypt(key, cipher.data(), cipher.size(), plain.data()) || plain != msg;
+            cipher[cipher.size() - 1 - len / 2] ^= 1;
+            bad += sm2Decrypt(key, cipher.data(), cipher.size(), plain.data());
+        }
+    }
+    std::cout << "Encryption round trips, tampered ciphertexts rejected: " << (bad == 0 ? "yes" : "no") << std::endl;
+
+    // ߽˽Կd = 12n-2ʱd*C1Ӽ
+    bad = 0;
+    for (int i = 0; i < 3; ++i) {
+        SM2_Key edge;
+        memset(edge.d, 0, sizeof(edge.d));
+        if (i < 2) {
+            edge.d[0] = (uint64_t)i + 1;
+        }
+        else {
+            memcpy(edge.d, SM2_N::MOD, sizeof(edge.d));
+            edge.d[0] -= 2;
+        }
+        edge.init();
+        std::vector<unsigned char> msg(100), cipher(msg.size() + SM2_CIPHER_OVERHEAD), plain(msg.size());
+        for (auto& b : msg) {
+            b = (unsigned char)rng();
+        }
+        SM2_Recipient r(edge.pub, false);
+        bad += !sm2Encrypt(r, msg.data(), msg.size(), cipher.data());
+        bad += !sm2Decrypt(edge, cipher.data(), cipher.size(), plain.data()) || plain != msg;
+    }
+    std::cout << "Round trips with d = 1, 2, n-2: " << (bad == 0 ? "yes" : "no") << std::endl;
+
+    char dirTemplate[] = "/tmp/sm2-fileXXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        std::cout << "File streaming: cannot create a temporary directory" << std::endl;
+        return;
+    }
+    const std::string dir = dirTemplate;
+    const std::string plainPath = dir + "/plain", cipherPath = dir + "/cipher", outPath = dir + "/out";
+    std::vector<unsigned char> data(3 * (1 << 20) + 123);
+    for (auto& b : data) {
+        b = (unsigned char)rng();
+    }
+    int fd = ::open(plainPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    bool ok = fd >= 0 && writeFull(fd, data.data(), data.size());
+    if (fd >= 0) {
+        close(fd);
+    }
+    ok = ok && sm2EncryptFile(withTable, plainPath, cipherPath) && sm2DecryptFile(key, cipherPath, outPath);
+    std::vector<unsigned char> back(data.size() + 1);
+    fd = ::open(outPath.c_str(), O_RDONLY);
+    ok = ok && fd >= 0 && readFull(fd, back.data(), back.size()) == (ssize_t)data.size() &&
+        std::equal(data.begin(), data.end(), back.begin());
+    if (fd >= 0) {
+        close(fd);
+    }
+    std::cout << "File streaming round trip: " << (ok ? "yes" : "no") << std::endl;
+
+    // ۸ĵģʧܣеoutPathֲ䣬Ҳʱļ
+    fd = ::open(cipherPath.c_str(), O_RDWR);
+    unsigned char byte = 0;
+    bool rejected = fd >= 0 && pread(fd, &byte, 1, SM2_CIPHER_OVERHEAD + 1000) == 1;
+    byte ^= 1;
+    rejected = rejected && pwrite(fd, &byte, 1, SM2_CIPHER_OVERHEAD + 1000) == 1;
+    if (fd >= 0) {
+        close(fd);
+    }
+    rejected = rejected && !sm2DecryptFile(key, cipherPath, outPath);
+    fd = ::open(outPath.c_str(), O_RDONLY);
+    bool kept = fd >= 0 && readFull(fd, back.data(), back.size()) == (ssize_t)data.size() &&
+        std::equal(data.begin(), data.end(), back.begin());
+    if (fd >= 0) {
+        close(fd);
+    }
+    int entries = 0;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* e = readdir(d)) {
+            entries += e->d_name[0] != '.';
+        }
+        closedir(d);
+    }
+    std::cout << "Tampered file rejected: " << (rejected ? "yes" : "no") << ", existing output kept: "
+        << (kept ? "yes" : "no") << ", temporary file removed: " << (entries == 3 ? "yes" : "no") << std::endl;
+    unlink(plainPath.c_str());
+    unlink(cipherPath.c_str());
+    unlink(outPath.c_str());
+    rmdir(dir.c_str());
+}
+
+// ܣװ32ֽԿϢ
+void encryptionPerformanceTest() {
+    SM2_Key key = SM2_Key::generate();
+    SM2_Recipient withTable(key.pub), withLadder(key.pub, false);
+    unsigned char dataKey[32] = { 1, 2, 3 };
+    unsigned char cipher[32 + SM2_CIPHER_OVERHEAD], plain[32];
+
+    auto rate = [](int n, auto fn) {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < n; ++i) {
+            fn();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        return n / std::chrono::duration<double>(end - start).count();
+    };
+    double wrapTable = rate(2000, [&] { sm2Encrypt(withTable, dataKey, 32, cipher); });
+    double wrapLadder = rate(500, [&] { sm2Encrypt(withLadder, dataKey, 32, cipher); });
+    double unwrap = rate(500, [&] { sm2Decrypt(key, cipher, sizeof(cipher), plain); });
+    std::cout << "Data key wrap: " << wrapTable << " ops/s (recipient table), " << wrapLadder
+        << " ops/s (ladder); unwrap: " << unwrap << " ops/s" << std::endl;
+
+    const size_t size = 64 << 20;
+    std::vector<unsigned char> msg(size, 0x5A), out(size + SM2_CIPHER_OVERHEAD);
+    auto start = std::chrono::high_resolution_clock::now();
+    sm2Encrypt(withTable, msg.data(), size, out.data());
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Bulk encryption: " << size / std::chrono::duration<double>(end - start).count() / (1 << 20)
+        << " MB/s" << std::endl;
+}
+
+// countǩsignersǩǩ
+std::vector<SM2_BatchEntry> makeBatch(size_t count, size_t signers) {
+    std::vector<SM2_Key> keys;
+    for (size_t i = 0; i < signers; ++i) {
+        keys.push_back(SM2_Key::generate());
+    }
+    const std::string id = "alice@example.com";
+    std::vector<SM2_BatchEntry> entries(count);
+    for (size_t i = 0; i < count; ++i) {
+        const SM2_Key& key = keys[i % signers];
+        std::string message = "firmware block " + std::to_string(i);
+        unsigned char z[32];
+        sm2ComputeZ((const unsigned char*)id.data(), id.size(), key.pub, z);
+        entries[i].pub = key.pub;
+        entries[i].e = sm2Digest(z, (const unsigned char*)message.data(), message.size());
+        uint64_t k[4];
+        do {
+            randomScalar(k);
+        } while (!sm2SignDigest(key, entries[i].e, k, entries[i].sig));
+    }
+    return entries;
+}
+
+// ĲԣμZĽӿڽһ£ͬһ󣬶̲߳ȡ
+void testContexts() {
+    SM2_ContextCache cache;
+    SM2_Key key = SM2_Key::generate();
+    const std::string id = "alice@example.com", other = "bob@example.com";
+    const std::string message = "GET /api/orders";
+    const unsigned char* idp = (const unsigned char*)id.data();
+    const unsigned char* msg = (const unsigned char*)message.data();
+
+    auto signer = cache.signer(key, idp, id.size());
+    SM2_Signature sig = signer->sign(msg, message.size());
+    bool ok = sm2Verify(key.pub, idp, id.size(), msg, message.size(), sig);
+    auto verifier = cache.verifier(idp, id.size(), key.pub);
+    ok = ok && verifier->verify(msg, message.size(), sig) && verifier == cache.verifier(idp, id.size(), key.pub);
+    // ͬһԿIDZͬǩЧ
+    auto otherVerifier = cache.verifier((const unsigned char*)other.data(), other.size(), key.pub);
+    ok = ok && !otherVerifier->verify(msg, message.size(), sig);
+
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 50; ++i) {
+                failures += !cache.verifier(idp, id.size(), key.pub)->verify(msg, message.size(), sig);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::cout << "Signer/verifier contexts: " << (ok && failures == 0 ? "passed" : "FAILED") << " ("
+        << cache.size() << " contexts cached)" << std::endl;
+}
+
+// ܣظǩߵǩ֤
+void contextPerformanceTest() {
+    SM2_ContextCache cache;
+    SM2_Key key = SM2_Key::generate();
+    const std::string id = "alice@example.com";
+    const std::string message = "GET /api/orders?page=1";
+    const unsigned char* idp = (const unsigned char*)id.data();
+    const unsigned char* msg = (const unsigned char*)message.data();
+
+    const int signatures = 10000;
+    std::vector<SM2_Signature> sigs(signatures);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < signatures; ++i) {
+        sigs[i] = cache.signer(key, idp, id.size())->sign(msg, message.size());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double signTime = std::chrono::duration<double>(end - start).count();
+
+    const int verifies = 3000;
+    int passed = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < verifies; ++i) {
+        passed += sm2Verify(key.pub, idp, id.size(), msg, message.size(), sigs[i]);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double plainTime = std::chrono::duration<double>(end - start).count();
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < verifies; ++i) {
+        passed += cache.verifier(idp, id.size(), key.pub)->verify(msg, message.size(), sigs[i]);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double contextTime = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "Signing with cached context: " << signatures / signTime << " signatures/s" << std::endl;
+    std::cout << "Verification: " << verifies / plainTime << " verifications/s without context, "
+        << verifies / contextTime << " with cached context (" << passed << " valid)" << std::endl;
+}
+
+// ȴ
+void waitForPool(const SM2_NoncePool& pool) {
+    while (pool.depth() + SM2_NoncePool::BATCH <= pool.stats().capacity) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// زԣǩ֤߳ͬʱȡʱûظkforkӽ̲ӳȡ
+void testNoncePool() {
+    SM2_Key key = SM2_Key::generate();
+    const std::string id = "alice@example.com", message = "transfer 100";
+    const unsigned char* idp = (const unsigned char*)id.data();
+    const unsigned char* msg = (const unsigned char*)message.data();
+    SM2_SignerContext signer(key, idp, id.size());
+
+    bool ok = true;
+    {
+        SM2_NoncePool pool(256);
+        waitForPool(pool);
+        for (int i = 0; i < 100; ++i) {
+            ok = ok && sm2Verify(key.pub, idp, id.size(), msg, message.size(), signer.sign(msg, message.size(), pool));
+        }
+    }
+
+    // ΪkԴÿkֻһΣȡkظ˵ͬһ
+    std::atomic<uint64_t> counter(1);
+    SM2_NoncePool pool(1024, 2, [&](uint64_t* k) {
+        k[0] = counter.fetch_add(1);
+        k[1] = k[2] = k[3] = 0;
+    });
+    const int perThread = 2000;
+    std::vector<std::vector<uint64_t>> taken(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            SM2_Nonce nonce;
+            while (taken[t].size() < perThread) {
+                if (pool.take(nonce)) {
+                    uint64_t k[4];
+                    SM2_Fn::toInt(nonce.k, k);
+                    taken[t].push_back(k[0]);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::vector<uint64_t> all;
+    for (auto& v : taken) {
+        all.insert(all.end(), v.begin(), v.end());
+    }
+    std::sort(all.begin(), all.end());
+    bool unique = std::adjacent_find(all.begin(), all.end()) == all.end();
+
+    pid_t child = fork();
+    if (child == 0) {
+        SM2_Nonce nonce;
+        _exit(pool.take(nonce) ? 1 : 0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    bool forkRefused = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+    std::vector<SM2_Key> keys = sm2GenerateKeys(8);
+    for (const auto& k : keys) {
+        ok = ok && isOnCurve(k.pub);
+    }
+    std::cout << "Nonce pool: signatures " << (ok ? "valid" : "INVALID") << ", " << all.size()
+        << " nonces taken by 4 threads " << (unique ? "without reuse" : "WITH REUSE")
+        << ", forked child " << (forkRefused ? "refused" : "NOT REFUSED") << std::endl;
+}
+
+// ܣʱǩֻʣģn㣬ÿk*GԱ
+void noncePoolPerformanceTest() {
+    SM2_Key key = SM2_Key::generate();
+    const std::string id = "alice@example.com", message = "transfer 100";
+    SM2_SignerContext signer(key, (const unsigned char*)id.data(), id.size());
+    const unsigned char* msg = (const unsigned char*)message.data();
+
+    const int signatures = 4000;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < signatures; ++i) {
+        signer.sign(msg, message.size());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double freshTime = std::chrono::duration<double>(end - start).count();
+
+    const int keyCount = 2000;
+    start = std::chrono::high_resolution_clock::now();
+    sm2GenerateKeys(keyCount);
+    end = std::chrono::high_resolution_clock::now();
+    double keyTime = std::chrono::duration<double>(end - start).count();
+
+    // ص߳ڵڰʱʼ䣬ʱCPU
+    SM2_NoncePool pool(signatures);
+    waitForPool(pool);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < signatures; ++i) {
+        signer.sign(msg, message.size(), pool);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double pooledTime = std::chrono::duration<double>(end - start).count();
+    SM2_NoncePool::Stats st = pool.stats();
+
+    std::cout << "Signing: " << signatures / freshTime << " signatures/s with fresh nonces, "
+        << signatures / pooledTime << " from a full pool" << std::endl;
+    std::cout << "Nonce pool: depth " << st.depth << "/" << st.capacity << ", produced " << st.produced
+        << ", consumed " << st.consumed << ", misses " << st.misses << ", refill " << st.refillRate
+        << " nonces/s" << std::endl;
+    std::cout << "Parallel key generation: " << keyCount / keyTime << " keys/s" << std::endl;
+}
+
+// ֤ԣȫϷ۸һȱٻrecovery
+void testBatchVerify() {
+    std::vector<SM2_BatchEntry> entries = makeBatch(100, 8);
+    std::unique_ptr<bool[]> valid(new bool[entries.size()]);
+    bool allValid = sm2VerifyBatch(entries.data(), entries.size(), valid.get());
+    std::cout << "Batch of " << entries.size() << " valid signatures accepted: " << (allValid ? "yes" : "no")
+        << std::endl;
+
+    std::vector<SM2_BatchEntry> tampered = entries;
+    tampered[37].sig.s = SM2_Fn::add(tampered[37].sig.s, SM2_Fn::one());
+    bool tamperedValid = sm2VerifyBatch(tampered.data(), tampered.size(), valid.get());
+    int rejected = 0;
+    for (size_t i = 0; i < tampered.size(); ++i) {
+        rejected += !valid[i];
+    }
+    std::cout << "Tampered batch rejected, failing entry located: "
+        << (!tamperedValid && rejected == 1 && !valid[37] ? "yes" : "no") << std::endl;
+
+    std::vector<SM2_BatchEntry> hints = entries;
+    hints[3].sig.recovery = SM2_RECOVERY_UNKNOWN;
+    hints[5].sig.recovery ^= 1;
+    bool hintsValid = sm2VerifyBatch(hints.data(), hints.size(), valid.get());
+    std::cout << "Missing or wrong recovery hints still verify: " << (hintsValid ? "yes" : "no") << std::endl;
+}
+
+// ֤ܣСƽÿ֤
+void batchPerformanceTest() {
+    std::vector<SM2_BatchEntry> entries = makeBatch(4096, 16);
+    std::unique_ptr<bool[]> valid(new bool[entries.size()]);
+
+    const size_t single = 512;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < single; ++i) {
+        sm2VerifyDigest(entries[i].pub, entries[i].e, entries[i].sig);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Single verification: " << single / std::chrono::duration<double>(end - start).count()
+        << " verifications/s" << std::endl;
+
+    SM2_BatchScratch scratch;
+    for (size_t size = 64; size <= entries.size(); size *= 4) {
+        size_t batches = entries.size() / size;
+        bool ok = true;
+        start = std::chrono::high_resolution_clock::now();
+        for (size_t b = 0; b < batches; ++b) {
+            ok = sm2VerifyBatch(entries.data() + b * size, size, valid.get(), scratch) && ok;
+        }
+        end = std::chrono::high_resolution_clock::now();
+        double time = std::chrono::duration<double>(end - start).count();
+        std::cout << "Batch of " << size << ": " << batches * size / time << " verifications/s"
+            << (ok ? "" : " (FAILED)") << std::endl;
+    }
+}
+
+// ļʱSM2_NO_MAIN
+#ifndef SM2_NO_MAIN
+int main() {
+#ifdef SM2_CT_VALGRIND
+    valgrindSecretCheck();
+    return 0;
+#endif
+    testField();
+    fieldPerformanceTest();
+    testSignature();
+    signPerformanceTest();
+    testContexts();
+    contextPerformanceTest();
+    testNoncePool();
+    noncePoolPerformanceTest();
+    testBatchVerify();
+    batchPerformanceTest();
+    testConstantTime();
+    constantTimePerformanceTest();
+    testEncryption();
+    encryptionPerformanceTest();
+    return 0;
+}
+#endif
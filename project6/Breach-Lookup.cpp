@@ -0,0 +1,445 @@
+// й¶ƾݲѯĹģʽ˽Կbй¶äһΣƾݹϣǰ׺ͰÿͰһXor
+// ȫдһļmmapṩ񡣿ͻ˲ѯƾcʱֻͰһäaH(c)baH(c)ͰĹ
+// ͻ˳a^-1õbH(c)ڹвҡÿβѯĴ۴O(й¶)ΪO(Ͱ)ֻ֪Ͱţ֪c
+#define PSI_STREAM_NO_MAIN
+#include "PSI-Stream.cpp"
+
+// XorGrafLemire 2019飬ÿÿӦһλã16λָƵڼָƣ
+// Լÿ19.7λ2^-16Ϊ64λäxǰ8ֽڣαģ
+struct XorFilterView {
+    uint64_t seed;
+    uint32_t blockLength;
+    const uint16_t* fingerprints;  // 3blockLength
+
+    static uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static uint16_t fingerprint(uint64_t hash) {
+        return (uint16_t)(hash ^ (hash >> 32));
+    }
+
+    // iеλã(32λƬΡblockLength) >> 32
+    static uint32_t position(uint64_t hash, int i, uint32_t blockLength) {
+        uint32_t r = (uint32_t)(i == 0 ? hash : (hash << (21 * i)) | (hash >> (64 - 21 * i)));
+        return (uint32_t)(((uint64_t)r * blockLength) >> 32) + (uint32_t)i * blockLength;
+    }
+
+    bool contains(uint64_t key) const {
+        if (blockLength == 0) {
+            return false;
+        }
+        uint64_t hash = mix(key + seed);
+        return fingerprint(hash) == (fingerprints[position(hash, 0, blockLength)] ^
+            fingerprints[position(hash, 1, blockLength)] ^ fingerprints[position(hash, 2, blockLength)]);
+    }
+};
+
+// 죺keysȥءֻһռõλãȫ෴˳λøֵ
+// ʧܣֻʱԣÿγɹĸԼΪ0.9
+inline void buildXorFilter(const std::vector<uint64_t>& keys, uint64_t& seed, uint32_t& blockLength,
+    std::vector<uint16_t>& fingerprints) {
+    if (keys.empty()) {
+        seed = 0;
+        blockLength = 0;
+        fingerprints.clear();
+        return;
+    }
+    blockLength = (uint32_t)((32 + 123 * keys.size() / 100 + 2) / 3);
+    const size_t capacity = (size_t)blockLength * 3;
+    std::vector<uint32_t> counts(capacity);
+    std::vector<uint64_t> xorMask(capacity);
+    std::vector<uint32_t> queue;
+    std::vector<std::pair<uint64_t, uint32_t>> stack;  // (Ĺϣ, λ)
+    for (;;) {
+        threadCtrDrbg().read((uint8_t*)&seed, sizeof(seed));
+        std::fill(counts.begin(), counts.end(), 0);
+        std::fill(xorMask.begin(), xorMask.end(), 0);
+        for (uint64_t key : keys) {
+            uint64_t hash = XorFilterView::mix(key + seed);
+            for (int i = 0; i < 3; ++i) {
+                uint32_t pos = XorFilterView::position(hash, i, blockLength);
+                ++counts[pos];
+                xorMask[pos] ^= hash;
+            }
+        }
+        queue.clear();
+        stack.clear();
+        for (uint32_t pos = 0; pos < capacity; ++pos) {
+            if (counts[pos] == 1) {
+                queue.push_back(pos);
+            }
+        }
+        while (!queue.empty()) {
+            uint32_t pos = queue.back();
+            queue.pop_back();
+            if (counts[pos] != 1) {
+                continue;
+            }
+            uint64_t hash = xorMask[pos];
+            stack.emplace_back(hash, pos);
+            for (int i = 0; i < 3; ++i) {
+                uint32_t other = XorFilterView::position(hash, i, blockLength);
+                xorMask[other] ^= hash;
+                if (--counts[other] == 1) {
+                    queue.push_back(other);
+                }
+            }
+        }
+        if (stack.size() == keys.size()) {
+            break;
+        }
+    }
+    fingerprints.assign(capacity, 0);
+    for (size_t i = stack.size(); i-- > 0;) {
+        uint64_t hash = stack[i].first;
+        uint32_t pos = stack[i].second;
+        uint16_t fp = XorFilterView::fingerprint(hash);
+        for (int j = 0; j < 3; ++j) {
+            uint32_t other = XorFilterView::position(hash, j, blockLength);
+            if (other != pos) {
+                fp ^= fingerprints[other];
+            }
+        }
+        fingerprints[pos] = fp;
+    }
+}
+
+// ƾڵͰSM3("SM2-PSI-BUCKET" || c)ǰprefixBitsλͻ˻ṫͰţprefixBitsԽСԽ
+inline uint32_t breachBucket(const std::string& credential, unsigned prefixBits) {
+    static const SM3_Prefixed prefix((const unsigned char*)"SM2-PSI-BUCKET", 14);
+    unsigned char digest[32];
+    prefix.hash((const unsigned char*)credential.data(), credential.size(), digest);
+    return prefixBits ? loadBE32(digest) >> (32 - prefixBits) : 0;
+}
+
+// ļäxǰ8ֽ
+inline uint64_t breachKey(const CompressedPoint& p) {
+    uint64_t key;
+    memcpy(&key, p.bytes + 1, sizeof(key));
+    return key;
+}
+
+// ļļͷ || ÿͰһĿ¼ || Ͱ16λָ飨Ͱ˳򣩡Ϊֽ򣬹ͬһܹķmmap
+struct BreachIndexHeader {
+    char magic[8];
+    uint32_t prefixBits;
+    uint32_t reserved;
+    uint64_t bucketCount;
+    uint64_t totalKeys;
+};
+
+struct BreachBucketEntry {
+    uint64_t offset;       // ָļеֽƫ
+    uint64_t seed;
+    uint32_t blockLength;
+    uint32_t keyCount;
+};
+
+static const char BREACH_INDEX_MAGIC[8] = { 'S', 'M', '2', 'B', 'R', 'F', '0', '1' };
+
+struct BreachIndexOptions {
+    unsigned prefixBits = 16;
+    size_t chunkSize = 4096;
+    size_t memoryBudget = 256 << 20;   // ⲿڴ
+    std::string tempDir = "/tmp";
+    unsigned threads = 0;
+};
+
+// Ԥ㣺й¶⣨ÿһƾݣkeyä(ͰŴ || )ⲿͰ۵һ
+// ÿͰȥغXor˳дpwriteĿ¼
+inline bool buildBreachIndex(const std::string& corpusPath, const std::string& indexPath, const uint64_t key[4],
+    const BreachIndexOptions& opt) {
+    if (opt.prefixBits > 24) {
+        throw std::invalid_argument("bucket prefix must be at most 24 bits");
+    }
+    DatasetReader reader(corpusPath);
+    if (!reader.good()) {
+        return false;
+    }
+    ExternalSorter sorter(12, 12, opt.memoryBudget, opt.tempDir);
+    std::vector<std::string> lines;
+    while (reader.next(lines, opt.chunkSize) > 0) {
+        std::vector<CompressedPoint> points = hashAndBlind(lines, key, opt.threads);
+        for (size_t i = 0; i < lines.size(); ++i) {
+            uint8_t record[12];
+            storeBE32(record, breachBucket(lines[i], opt.prefixBits));
+            uint64_t k = breachKey(points[i]);
+            memcpy(record + 4, &k, 8);
+            if (!sorter.add(record)) {
+                return false;
+            }
+        }
+    }
+    if (!sorter.finish()) {
+        return false;
+    }
+
+    int fd = ::open(indexPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    BreachIndexHeader header = {};
+    memcpy(header.magic, BREACH_INDEX_MAGIC, sizeof(header.magic));
+    header.prefixBits = opt.prefixBits;
+    header.bucketCount = (uint64_t)1 << opt.prefixBits;
+    std::vector<BreachBucketEntry> entries(header.bucketCount);
+    uint64_t offset = sizeof(header) + entries.size() * sizeof(BreachBucketEntry);
+    bool ok = lseek(fd, (off_t)offset, SEEK_SET) == (off_t)offset;
+
+    uint8_t record[12];
+    bool more = sorter.next(record);
+    std::vector<uint64_t> keys;
+    std::vector<uint16_t> fingerprints;
+    while (ok && more) {
+        uint32_t bucket = loadBE32(record);
+        keys.clear();
+        do {
+            uint64_t k;
+            memcpy(&k, record + 4, 8);
+            if (keys.empty() || keys.back() != k) {
+                keys.push_back(k);
+            }
+            more = sorter.next(record);
+        } while (more && loadBE32(record) == bucket);
+        BreachBucketEntry& entry = entries[bucket];
+        buildXorFilter(keys, entry.seed, entry.blockLength, fingerprints);
+        entry.offset = offset;
+        entry.keyCount = (uint32_t)keys.size();
+        header.totalKeys += keys.size();
+        ok = writeFull(fd, (const unsigned char*)fingerprints.data(), fingerprints.size() * sizeof(uint16_t));
+        offset += fingerprints.size() * sizeof(uint16_t);
+    }
+    // 鲢ʧʱnext()Ҳfalseܰѽضϵ
+    ok = ok && !sorter.failed();
+    ok = ok && pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    size_t dirBytes = entries.size() * sizeof(BreachBucketEntry);
+    ok = ok && pwrite(fd, entries.data(), dirBytes, sizeof(header)) == (ssize_t)dirBytes;
+    ok = close(fd) == 0 && ok;
+    if (!ok) {
+        unlink(indexPath.c_str());
+    }
+    return ok;
+}
+
+// ͻ˵ĲѯͰaH(c)
+struct BreachQuery {
+    uint32_t bucket;
+    CompressedPoint blinded;
+};
+
+// һδɵĲѯqueryֻڵ÷a^-1check()꼴
+struct BreachPending {
+    BreachQuery query;
+    uint64_t aInv[4];
+};
+
+// ӦbaH(c)Ͱֱָָmmapļ
+struct BreachResponse {
+    CompressedPoint doubleBlinded;
+    XorFilterView filter;
+
+    // 33ֽڵ || 8ֽ || 4ֽڿ鳤 || ָ鴫ʱֽ
+    size_t wireBytes() const {
+        return 33 + 8 + 4 + (size_t)filter.blockLength * 3 * sizeof(uint16_t);
+    }
+};
+
+// mmapļÿβѯһεˣkey뽨ʱͬ
+class BreachServer {
+public:
+    BreachServer(const std::string& indexPath, const uint64_t key[4]) {
+        memcpy(b, key, sizeof(b));
+        int fd = ::open(indexPath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::invalid_argument("cannot open breach index");
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BreachIndexHeader)) {
+            close(fd);
+            throw std::invalid_argument("breach index is truncated");
+        }
+        length = (size_t)st.st_size;
+        void* p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            throw std::invalid_argument("cannot map breach index");
+        }
+        base = (const uint8_t*)p;
+        header = (const BreachIndexHeader*)base;
+        entries = (const BreachBucketEntry*)(base + sizeof(BreachIndexHeader));
+        if (memcmp(header->magic, BREACH_INDEX_MAGIC, sizeof(header->magic)) != 0 || header->prefixBits > 24 ||
+            header->bucketCount != (uint64_t)1 << header->prefixBits ||
+            sizeof(BreachIndexHeader) + header->bucketCount * sizeof(BreachBucketEntry) > length) {
+            munmap(p, length);
+            throw std::invalid_argument("not a breach index");
+        }
+        for (uint64_t i = 0; i < header->bucketCount; ++i) {
+            if (entries[i].blockLength && entries[i].offset + entries[i].blockLength * 6ull > length) {
+                munmap(p, length);
+                throw std::invalid_argument("breach index is truncated");
+            }
+        }
+    }
+
+    ~BreachServer() {
+        munmap((void*)base, length);
+        memset(b, 0, sizeof(b));
+    }
+
+    BreachServer(const BreachServer&) = delete;
+    BreachServer& operator=(const BreachServer&) = delete;
+
+    unsigned prefixBits() const {
+        return header->prefixBits;
+    }
+
+    uint64_t totalKeys() const {
+        return header->totalKeys;
+    }
+
+    // ͰԽ㲻ʱfalse
+    bool answer(const BreachQuery& query, BreachResponse& response) const {
+        AffinePoint p;
+        if (query.bucket >= header->bucketCount || !decompressPoint(query.blinded, p)) {
+            return false;
+        }
+        response.doubleBlinded = compressPoint(ladderMult(b, p));
+        response.filter = bucketFilter(query.bucket);
+        return true;
+    }
+
+    XorFilterView bucketFilter(uint32_t bucket) const {
+        const BreachBucketEntry& e = entries[bucket];
+        return XorFilterView{ e.seed, e.blockLength, (const uint16_t*)(base + e.offset) };
+    }
+
+private:
+    uint64_t b[4];
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+    const BreachIndexHeader* header = nullptr;
+    const BreachBucketEntry* entries = nullptr;
+};
+
+// ͻˣÿβѯµaa^-1ѯһ𷵻ظ÷յӦa^-1
+// ͻ˱ܣͬʱжδɵĲѯ
+class BreachClient {
+public:
+    explicit BreachClient(unsigned prefixBits) : prefixBits(prefixBits) {}
+
+    BreachPending prepare(const std::string& credential) const {
+        uint64_t a[4];
+        randomScalar(a);
+        BreachPending pending;
+        SM2_Fn::toInt(SM2_Fn::inv(SM2_Fn::fromInt(a)), pending.aInv);
+        pending.query.bucket = breachBucket(credential, prefixBits);
+        pending.query.blinded = compressPoint(ladderMult(a, hashToCurve((const uint8_t*)credential.data(), credential.size())));
+        memset(a, 0, sizeof(a));
+        return pending;
+    }
+
+    // ƾй¶ʱtrue2^-16۽ζpendingеa^-1
+    // pendingùӦеĵ㲻ʱ׳쳣
+    bool check(BreachPending& pending, const BreachResponse& response) const {
+        uint64_t used = pending.aInv[0] | pending.aInv[1] | pending.aInv[2] | pending.aInv[3];
+        AffinePoint p;
+        bool onCurve = used != 0 && decompressPoint(response.doubleBlinded, p);
+        CompressedPoint unblinded = {};
+        if (onCurve) {
+            unblinded = compressPoint(ladderMult(pending.aInv, p));
+        }
+        memset(pending.aInv, 0, sizeof(pending.aInv));
+        if (used == 0) {
+            throw std::invalid_argument("pending query has already been checked");
+        }
+        if (!onCurve) {
+            throw std::invalid_argument("response point is not on the curve");
+        }
+        return response.filter.contains(breachKey(unblinded));
+    }
+
+private:
+    unsigned prefixBits;
+};
+
+// ģʽԣѯƾݣͳÿβѯĴͷäֵȽ
+void testBreachLookup(size_t corpusSize = 10000, unsigned prefixBits = 6) {
+    BreachIndexOptions opt;
+    opt.prefixBits = prefixBits;
+    opt.memoryBudget = 64 << 10;
+    std::string corpusPath = makeTempFile(opt.tempDir, "breach-corpus-");
+    std::string indexPath = makeTempFile(opt.tempDir, "breach-index-");
+    if (corpusPath.empty() || indexPath.empty()) {
+        std::cout << "Breach index: cannot create temporary files in " << opt.tempDir << std::endl;
+        unlink(corpusPath.c_str());
+        return;
+    }
+    {
+        std::ofstream corpus(corpusPath);
+        for (size_t i = 0; i < corpusSize; ++i) {
+            corpus << "user" << i << ":password" << i * 7919 % 100003 << "\n";
+        }
+    }
+    uint64_t key[4];
+    randomScalar(key);
+    auto start = std::chrono::high_resolution_clock::now();
+    bool built = buildBreachIndex(corpusPath, indexPath, key, opt);
+    auto end = std::chrono::high_resolution_clock::now();
+    double buildTime = std::chrono::duration<double>(end - start).count();
+    if (!built) {
+        std::cout << "Breach index: build FAILED" << std::endl;
+        unlink(corpusPath.c_str());
+        unlink(indexPath.c_str());
+        memset(key, 0, sizeof(key));
+        return;
+    }
+
+    BreachServer server(indexPath, key);
+    BreachClient client(prefixBits);
+    const int present = 100, absent = 1000;
+    int found = 0, falsePositives = 0;
+    size_t bytes = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < present + absent; ++i) {
+        // ǰpresentȡԿУͬ
+        size_t user = (size_t)i * 97 % corpusSize;
+        std::string credential = "user" + std::to_string(user) + ":password" +
+            std::to_string(i < present ? user * 7919 % 100003 : user * 7919 % 100003 + 1);
+        BreachResponse response = {};
+        BreachPending pending = client.prepare(credential);
+        bool hit = server.answer(pending.query, response) && client.check(pending, response);
+        memset(pending.aInv, 0, sizeof(pending.aInv));  // answerʧʱcheckδִ
+        bytes += response.wireBytes();
+        if (i < present) {
+            found += hit;
+        } else {
+            falsePositives += hit;
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double queryTime = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "Breach index: " << server.totalKeys() << " credentials in " << (1u << prefixBits)
+        << " buckets, built in " << buildTime << " s" << std::endl;
+    std::cout << "Breached found: " << found << "/" << present << ", false positives: " << falsePositives << "/"
+        << absent << ", " << (present + absent) / queryTime << " queries/s (client + server), "
+        << bytes / (present + absent) << " bytes per response vs " << corpusSize * 33
+        << " bytes for the full blinded set" << std::endl;
+    unlink(corpusPath.c_str());
+    unlink(indexPath.c_str());
+    memset(key, 0, sizeof(key));
+}
+
+// ļʱBREACH_LOOKUP_NO_MAIN
+#ifndef BREACH_LOOKUP_NO_MAIN
+int main() {
+    testBreachLookup();
+    return 0;
+}
+#endif
@@ -0,0 +1,786 @@
+// ʽ˽нͣ˫ݼӴ̶룬ϢԶ¼Ķ֡ܵ򱾵socket䣬
+// ڴռݼС޹ءЭPSI-Sum.cppֻͬǰϢɼ¼
+//   P2  P1  PUBLIC_KEY  Paillierģn
+//   P1  P2  ROUND1      k1H(v)
+//   P2  P1  DOUBLE      k2k1H(v)ֵ
+//   P2  P1  PAIR        k2H(w) || Enc(t)
+//   P1  P2  RESULT      Ľ
+// äֵȼң˳ֻȡαäֵ˳޹أ˿ⲿڴеshuffle
+#define PSI_SUM_NO_MAIN
+#include "PSI-Sum.cpp"
+#include <csignal>
+#include <fstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static_assert(sizeof(CompressedPoint) == 33, "compressed points are sent as raw 33-byte records");
+
+// ¼ⲿ򣺻ʱдһΣʱļunlink
+// Ը·鲢ûʱֱڴ
+class ExternalSorter {
+public:
+    ExternalSorter(size_t recordSize, size_t keySize, size_t memoryBudget, const std::string& tempDir)
+        : recordSize(recordSize), keySize(keySize),
+          capacity(std::max<size_t>(1, memoryBudget / (recordSize + sizeof(uint32_t)))), tempDir(tempDir) {}
+
+    ~ExternalSorter() {
+        for (Run& run : runs) {
+            close(run.fd);
+        }
+    }
+
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+    bool add(const uint8_t* record) {
+        buffer.insert(buffer.end(), record, record + recordSize);
+        return buffer.size() / recordSize < capacity || spill();
+    }
+
+    // ʱʣಿҲдһΣȻ׼鲢
+    bool finish() {
+        if (runs.empty()) {
+            sortBuffer();
+            return true;
+        }
+        if (!buffer.empty() && !spill()) {
+            return false;
+        }
+        const size_t readSize = std::max<size_t>(1, (64 << 10) / recordSize) * recordSize;
+        for (size_t i = 0; i < runs.size(); ++i) {
+            runs[i].buf.resize(readSize);
+            if (lseek(runs[i].fd, 0, SEEK_SET) != 0 || !fill(runs[i])) {
+                return false;
+            }
+            if (runs[i].pos < runs[i].len) {
+                heap.push_back(i);
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), [this](size_t a, size_t b) { return runGreater(a, b); });
+        return true;
+    }
+
+    // ȡһ¼ȡʧʱfalsefailed()
+    bool next(uint8_t* record) {
+        if (runs.empty()) {
+            if (cursor >= order.size()) {
+                return false;
+            }
+            memcpy(record, &buffer[(size_t)order[cursor++] * recordSize], recordSize);
+            return true;
+        }
+        if (heap.empty()) {
+            return false;
+        }
+        auto greater = [this](size_t a, size_t b) { return runGreater(a, b); };
+        std::pop_heap(heap.begin(), heap.end(), greater);
+        Run& run = runs[heap.back()];
+        memcpy(record, &run.buf[run.pos], recordSize);
+        run.pos += recordSize;
+        if (run.pos == run.len && !fill(run)) {
+            heap.clear();
+            error = true;
+            return false;
+        }
+        if (run.pos < run.len) {
+            std::push_heap(heap.begin(), heap.end(), greater);
+        } else {
+            heap.pop_back();
+        }
+        return true;
+    }
+
+    size_t runCount() const {
+        return runs.size();
+    }
+
+    // 鲢ʱļʧܣ˺next()ٷؼ¼ȡĽ
+    bool failed() const {
+        return error;
+    }
+
+private:
+    struct Run {
+        int fd;
+        std::vector<uint8_t> buf;
+        size_t pos = 0;
+        size_t len = 0;
+    };
+
+    const size_t recordSize;
+    const size_t keySize;
+    const size_t capacity;
+    const std::string tempDir;
+    std::vector<uint8_t> buffer;
+    std::vector<uint32_t> order;
+    size_t cursor = 0;
+    std::vector<Run> runs;
+    std::vector<size_t> heap;
+    bool error = false;
+
+    void sortBuffer() {
+        order.resize(buffer.size() / recordSize);
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = (uint32_t)i;
+        }
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return memcmp(&buffer[(size_t)a * recordSize], &buffer[(size_t)b * recordSize], keySize) < 0;
+        });
+    }
+
+    bool spill() {
+        sortBuffer();
+        std::string path = tempDir + "/psi-runXXXXXX";
+        int fd = mkstemp(&path[0]);
+        if (fd < 0) {
+            return false;
+        }
+        unlink(path.c_str());
+        runs.emplace_back();
+        runs.back().fd = fd;
+        std::vector<uint8_t> out;
+        out.reserve(1 << 20);
+        for (uint32_t i : order) {
+            out.insert(out.end(), &buffer[(size_t)i * recordSize], &buffer[(size_t)i * recordSize] + recordSize);
+            if (out.size() >= (1 << 20)) {
+                if (!writeFull(fd, out.data(), out.size())) {
+                    return false;
+                }
+                out.clear();
+            }
+        }
+        buffer.clear();
+        order.clear();
+        return writeFull(fd, out.data(), out.size());
+    }
+
+    bool fill(Run& run) {
+        ssize_t n = readFull(run.fd, run.buf.data(), run.buf.size());
+        run.pos = 0;
+        run.len = n > 0 ? (size_t)n : 0;
+        return n >= 0 && run.len % recordSize == 0;
+    }
+
+    // ѶΪС
+    bool runGreater(size_t a, size_t b) const {
+        return memcmp(&runs[a].buf[runs[a].pos], &runs[b].buf[runs[b].pos], keySize) > 0;
+    }
+};
+
+// ϵļȥأÿFENCEһָڴУʱڷָжֶλ飬mmapĿڶ
+class SortedRun {
+public:
+    static constexpr size_t FENCE = 256;
+
+    explicit SortedRun(size_t keySize) : keySize(keySize) {}
+
+    ~SortedRun() {
+        if (data) {
+            munmap((void*)data, count * keySize);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    SortedRun(const SortedRun&) = delete;
+    SortedRun& operator=(const SortedRun&) = delete;
+
+    // sorterĹ鲢дһļӳ
+    bool build(ExternalSorter& sorter, const std::string& tempDir) {
+        std::string path = tempDir + "/psi-sortedXXXXXX";
+        fd = mkstemp(&path[0]);
+        if (fd < 0) {
+            return false;
+        }
+        unlink(path.c_str());
+        std::vector<uint8_t> out, key(keySize), last;
+        out.reserve(1 << 20);
+        while (sorter.next(key.data())) {
+            if (!last.empty() && memcmp(last.data(), key.data(), keySize) == 0) {
+                continue;
+            }
+            if (count % FENCE == 0) {
+                fences.insert(fences.end(), key.begin(), key.end());
+            }
+            out.insert(out.end(), key.begin(), key.end());
+            last = key;
+            ++count;
+            if (out.size() >= (1 << 20)) {
+                if (!writeFull(fd, out.data(), out.size())) {
+                    return false;
+                }
+                out.clear();
+            }
+        }
+        if (sorter.failed() || !writeFull(fd, out.data(), out.size())) {
+            return false;
+        }
+        if (count == 0) {
+            return true;
+        }
+        void* p = mmap(nullptr, count * keySize, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        madvise(p, count * keySize, MADV_RANDOM);
+        data = (const uint8_t*)p;
+        return true;
+    }
+
+    bool contains(const uint8_t* key) const {
+        // һkeyķָ֮ǰһ
+        size_t lo = 0, hi = fences.size() / keySize;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (memcmp(&fences[mid * keySize], key, keySize) <= 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo == 0) {
+            return false;
+        }
+        lo = (lo - 1) * FENCE;
+        hi = std::min(count, lo + FENCE);
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            int c = memcmp(data + mid * keySize, key, keySize);
+            if (c == 0) {
+                return true;
+            }
+            if (c < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return false;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+private:
+    const size_t keySize;
+    int fd = -1;
+    const uint8_t* data = nullptr;
+    size_t count = 0;
+    std::vector<uint8_t> fences;
+};
+
+// P1˫äֵȷڴеĹϣٷͳڴʱеļⲿ
+// ֮ļҲֱӽⲿ鲢һϵ
+class BlindedValueStore {
+public:
+    BlindedValueStore(size_t memoryBudget, const std::string& tempDir)
+        : budget(memoryBudget), tempDir(tempDir), sorter(KEY_SIZE, KEY_SIZE, memoryBudget, tempDir), run(KEY_SIZE) {}
+
+    bool insert(const CompressedPoint& p) {
+        BlindedPointSet::Key key = BlindedPointSet::keyOf(p);
+        if (!spilled) {
+            if (!set.needsGrowth() || set.memoryBytes() * 2 <= budget) {
+                set.insert(key);
+                return true;
+            }
+            spilled = true;
+            for (const BlindedPointSet::Key& k : set.drain()) {
+                if (!sorter.add((const uint8_t*)k.data())) {
+                    return false;
+                }
+            }
+        }
+        return sorter.add((const uint8_t*)key.data());
+    }
+
+    bool seal() {
+        return !spilled || (sorter.finish() && run.build(sorter, tempDir));
+    }
+
+    bool contains(const CompressedPoint& p) const {
+        BlindedPointSet::Key key = BlindedPointSet::keyOf(p);
+        return spilled ? run.contains((const uint8_t*)key.data()) : set.contains(key);
+    }
+
+    bool isSpilled() const {
+        return spilled;
+    }
+
+private:
+    static constexpr size_t KEY_SIZE = sizeof(BlindedPointSet::Key);
+
+    const size_t budget;
+    const std::string tempDir;
+    bool spilled = false;
+    BlindedPointSet set;
+    ExternalSorter sorter;
+    SortedRun run;
+};
+
+// ֡(1) || ¼(4) || ¼(4) || ¼¼ֽڣΪˣ¼Ϊ0֡ʾϢ
+enum PSI_FrameType : uint8_t {
+    PSI_FRAME_PUBLIC_KEY = 1,
+    PSI_FRAME_ROUND1 = 2,
+    PSI_FRAME_DOUBLE = 3,
+    PSI_FRAME_PAIR = 4,
+    PSI_FRAME_RESULT = 5
+};
+
+struct PSI_Frame {
+    uint8_t type;
+    uint32_t count;
+    uint32_t recordSize;
+    std::vector<uint8_t> payload;
+
+    const uint8_t* record(size_t i) const {
+        return &payload[i * recordSize];
+    }
+};
+
+inline bool writeFrame(int fd, uint8_t type, const uint8_t* records, uint32_t count, uint32_t recordSize) {
+    uint8_t header[9] = { type };
+    storeBE32(header + 1, count);
+    storeBE32(header + 5, recordSize);
+    return writeFull(fd, header, sizeof(header)) && writeFull(fd, records, (size_t)count * recordSize);
+}
+
+// һ֡ͣrecordSizeΪ0ʱ¼ȡ֡ز64MB
+inline bool readFrame(int fd, uint8_t type, uint32_t recordSize, PSI_Frame& frame) {
+    uint8_t header[9];
+    if (readFull(fd, header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        return false;
+    }
+    frame.type = header[0];
+    frame.count = loadBE32(header + 1);
+    frame.recordSize = loadBE32(header + 5);
+    uint64_t bytes = (uint64_t)frame.count * frame.recordSize;
+    if (frame.type != type || (recordSize && frame.recordSize != recordSize) || bytes > (64 << 20)) {
+        return false;
+    }
+    frame.payload.resize((size_t)bytes);
+    return readFull(fd, frame.payload.data(), (size_t)bytes) == (ssize_t)bytes;
+}
+
+// ʽеĲ
+struct PSI_StreamOptions {
+    size_t chunkSize = 4096;             // ÿζҲÿ֡ļ¼
+    size_t memoryBudget = 256 << 20;     // Էäֵÿⲿ򻺳ڴ
+    std::string tempDir = "/tmp";
+    size_t paillierBits = 2048;
+    unsigned threads = 0;
+};
+
+// зֿݼ
+class DatasetReader {
+public:
+    explicit DatasetReader(const std::string& path) : in(path) {}
+
+    bool good() const {
+        return (bool)in;
+    }
+
+    size_t next(std::vector<std::string>& lines, size_t max) {
+        lines.clear();
+        std::string line;
+        while (lines.size() < max && std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                lines.push_back(line);
+            }
+        }
+        return lines.size();
+    }
+
+private:
+    std::ifstream in;
+};
+
+// Ѱļ¼֡¼Ϊʱֻ֡transformڷǰдһ¼P2ڴ˼ܣ
+inline bool sendSorted(int fd, uint8_t type, ExternalSorter& sorter, size_t recordSize, size_t chunkSize,
+    const std::function<bool(std::vector<uint8_t>&, size_t)>& transform, size_t outRecordSize) {
+    std::vector<uint8_t> block(chunkSize * recordSize);
+    for (;;) {
+        size_t n = 0;
+        while (n < chunkSize && sorter.next(&block[n * recordSize])) {
+            ++n;
+        }
+        // ʧʱܷͽ֡Էѽضϵ
+        if (sorter.failed()) {
+            return false;
+        }
+        if (n == 0) {
+            return writeFrame(fd, type, nullptr, 0, (uint32_t)outRecordSize);
+        }
+        std::vector<uint8_t> out(block.begin(), block.begin() + n * recordSize);
+        if (!transform(out, n) || !writeFrame(fd, type, out.data(), (uint32_t)n, (uint32_t)outRecordSize)) {
+            return false;
+        }
+    }
+}
+
+// P1ĽСԼԷäֵǷ˴
+struct PSI_Party1Result {
+    uint64_t intersectionSize = 0;
+    bool spilled = false;
+};
+
+// P1pathÿһʶ
+inline bool psiStreamParty1(int fd, const std::string& path, const PSI_StreamOptions& opt, PSI_Party1Result& result) {
+    uint64_t k1[4];
+    randomScalar(k1);
+    bool ok = false;
+    try {
+        ok = [&] {
+            PSI_Frame frame;
+            if (!readFrame(fd, PSI_FRAME_PUBLIC_KEY, 0, frame) || frame.count != 1) {
+                return false;
+            }
+            PaillierPublicKey pub(bnFromBytes(frame.record(0), frame.recordSize));
+            const size_t ctBytes = pub.ciphertextBytes();
+
+            // һ֣äֱӷP2ֻk1H(v)һᰴֵźٷأ
+            DatasetReader reader(path);
+            if (!reader.good()) {
+                return false;
+            }
+            std::vector<std::string> ids;
+            while (reader.next(ids, opt.chunkSize) > 0) {
+                std::vector<CompressedPoint> points = hashAndBlind(ids, k1, opt.threads);
+                if (!writeFrame(fd, PSI_FRAME_ROUND1, points[0].bytes, (uint32_t)points.size(), 33)) {
+                    return false;
+                }
+            }
+            if (!writeFrame(fd, PSI_FRAME_ROUND1, nullptr, 0, 33)) {
+                return false;
+            }
+
+            BlindedValueStore store(opt.memoryBudget, opt.tempDir);
+            for (;;) {
+                if (!readFrame(fd, PSI_FRAME_DOUBLE, 33, frame)) {
+                    return false;
+                }
+                if (frame.count == 0) {
+                    break;
+                }
+                for (uint32_t i = 0; i < frame.count; ++i) {
+                    CompressedPoint p;
+                    memcpy(p.bytes, frame.record(i), 33);
+                    if (!store.insert(p)) {
+                        return false;
+                    }
+                }
+            }
+            if (!store.seal()) {
+                return false;
+            }
+            result.spilled = store.isSpilled();
+
+            // ֣k1鼯ϣеİͺ۳
+            const BigNum& nSquared = pub.context().modulus();
+            BigNum acc = bnFromU64(1, nSquared.size());
+            for (;;) {
+                if (!readFrame(fd, PSI_FRAME_PAIR, (uint32_t)(33 + ctBytes), frame)) {
+                    return false;
+                }
+                if (frame.count == 0) {
+                    break;
+                }
+                std::vector<CompressedPoint> points(frame.count);
+                for (uint32_t i = 0; i < frame.count; ++i) {
+                    memcpy(points[i].bytes, frame.record(i), 33);
+                }
+                points = reblind(points, k1, opt.threads);
+                std::vector<BigNum> matched;
+                for (uint32_t i = 0; i < frame.count; ++i) {
+                    if (store.contains(points[i])) {
+                        matched.push_back(bnFromBytes(frame.record(i) + 33, ctBytes));
+                        if (bnCompare(matched.back(), nSquared) >= 0) {
+                            return false;
+                        }
+                    }
+                }
+                if (!matched.empty()) {
+                    acc = pub.add(acc, pub.sum(matched, opt.threads));
+                    result.intersectionSize += matched.size();
+                }
+            }
+            std::vector<uint8_t> out(ctBytes);
+            bnToBytes(pub.rerandomize(acc), out.data(), ctBytes);
+            return writeFrame(fd, PSI_FRAME_RESULT, out.data(), 1, (uint32_t)ctBytes);
+        }();
+    } catch (const std::invalid_argument&) {
+        ok = false;
+    }
+    memset(k1, 0, sizeof(k1));
+    return ok;
+}
+
+// P2pathÿ"ʶ,ֵ"õиֵ֮
+inline bool psiStreamParty2(int fd, const std::string& path, const PSI_StreamOptions& opt, uint64_t& sum) {
+    uint64_t k2[4];
+    randomScalar(k2);
+    bool ok = false;
+    try {
+        ok = [&] {
+            PaillierKey key = PaillierKey::generate(opt.paillierBits);
+            const size_t ctBytes = key.ciphertextBytes();
+            std::vector<uint8_t> modulus(key.modulus().size() * 8);
+            bnToBytes(key.modulus(), modulus.data(), modulus.size());
+            if (!writeFrame(fd, PSI_FRAME_PUBLIC_KEY, modulus.data(), 1, (uint32_t)modulus.size())) {
+                return false;
+            }
+
+            // ڶǰ룺P1ĵk2ⲿֵ˳򷢻
+            ExternalSorter doubled(33, 33, opt.memoryBudget, opt.tempDir);
+            PSI_Frame frame;
+            for (;;) {
+                if (!readFrame(fd, PSI_FRAME_ROUND1, 33, frame)) {
+                    return false;
+                }
+                if (frame.count == 0) {
+                    break;
+                }
+                std::vector<CompressedPoint> points(frame.count);
+                for (uint32_t i = 0; i < frame.count; ++i) {
+                    memcpy(points[i].bytes, frame.record(i), 33);
+                }
+                for (const CompressedPoint& p : reblind(points, k2, opt.threads)) {
+                    if (!doubled.add(p.bytes)) {
+                        return false;
+                    }
+                }
+            }
+            if (!doubled.finish() || !sendSorted(fd, PSI_FRAME_DOUBLE, doubled, 33, opt.chunkSize,
+                [](std::vector<uint8_t>&, size_t) { return true; }, 33)) {
+                return false;
+            }
+
+            // ڶֺ룺ԼԪk2H(w)(, ֵ)򣬷ǰֵ
+            ExternalSorter own(33 + 8, 33, opt.memoryBudget, opt.tempDir);
+            DatasetReader reader(path);
+            if (!reader.good()) {
+                return false;
+            }
+            std::vector<std::string> lines;
+            while (reader.next(lines, opt.chunkSize) > 0) {
+                std::vector<std::string> ids(lines.size());
+                std::vector<uint64_t> values(lines.size());
+                for (size_t i = 0; i < lines.size(); ++i) {
+                    size_t comma = lines[i].rfind(',');
+                    char* end = nullptr;
+                    if (comma == std::string::npos) {
+                        return false;
+                    }
+                    values[i] = strtoull(lines[i].c_str() + comma + 1, &end, 10);
+                    if (end == lines[i].c_str() + comma + 1 || *end) {
+                        return false;
+                    }
+                    ids[i] = lines[i].substr(0, comma);
+                }
+                std::vector<CompressedPoint> points = hashAndBlind(ids, k2, opt.threads);
+                uint8_t record[41];
+                for (size_t i = 0; i < points.size(); ++i) {
+                    memcpy(record, points[i].bytes, 33);
+                    memcpy(record + 33, &values[i], 8);
+                    if (!own.add(record)) {
+                        return false;
+                    }
+                }
+            }
+            const size_t pairSize = 33 + ctBytes;
+            auto encryptBlock = [&](std::vector<uint8_t>& block, size_t n) {
+                std::vector<uint64_t> values(n);
+                for (size_t i = 0; i < n; ++i) {
+                    memcpy(&values[i], &block[i * 41 + 33], 8);
+                }
+                std::vector<BigNum> ciphertexts = key.encryptBatch(values, opt.threads);
+                std::vector<uint8_t> out(n * pairSize);
+                for (size_t i = 0; i < n; ++i) {
+                    memcpy(&out[i * pairSize], &block[i * 41], 33);
+                    bnToBytes(ciphertexts[i], &out[i * pairSize + 33], ctBytes);
+                }
+                block.swap(out);
+                return true;
+            };
+            if (!own.finish() || !sendSorted(fd, PSI_FRAME_PAIR, own, 41, opt.chunkSize, encryptBlock, pairSize)) {
+                return false;
+            }
+
+            if (!readFrame(fd, PSI_FRAME_RESULT, (uint32_t)ctBytes, frame) || frame.count != 1) {
+                return false;
+            }
+            sum = key.decrypt(bnFromBytes(frame.record(0), ctBytes));
+            return true;
+        }();
+    } catch (const std::invalid_argument&) {
+        ok = false;
+    }
+    memset(k2, 0, sizeof(k2));
+    return ok;
+}
+
+// socketP1P2ӣP1δʱԼ10룩
+inline int listenUnix(const std::string& path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) {
+        return -1;
+    }
+    unlink(path.c_str());
+    int fd = -1;
+    if (bind(server, (sockaddr*)&addr, sizeof(addr)) == 0 && listen(server, 1) == 0) {
+        fd = accept(server, nullptr, nullptr);
+    }
+    close(server);
+    unlink(path.c_str());
+    return fd;
+}
+
+inline int connectUnix(const std::string& path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) {
+            return fd;
+        }
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return -1;
+}
+
+// ̾socketpairһЭ飺ΪP1forkӽΪP2ӽ˳뱨ܳĺǷexpectedSum
+inline bool runStreamingProcesses(const std::string& p1Path, const std::string& p2Path, const PSI_StreamOptions& opt,
+    uint64_t expectedSum, PSI_Party1Result& result) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        uint64_t sum = 0;
+        bool ok = psiStreamParty2(fds[1], p2Path, opt, sum);
+        _exit(ok && sum == expectedSum ? 0 : 1);
+    }
+    close(fds[1]);
+    bool ok = psiStreamParty1(fds[0], p1Path, opt, result);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// dirmkstempΨһĿļ·Ҫ·򿪵ʱļݣʹãʧʱؿմ
+inline std::string makeTempFile(const std::string& dir, const char* prefix) {
+    std::string path = dir + "/" + prefix + "XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        return std::string();
+    }
+    close(fd);
+    return path;
+}
+
+// ʽЭԣֱ̣㹻ڴ4KBڴޣԷäֵ̡ⲿι鲢
+void testStreamingPSI(size_t count = 1500) {
+    PSI_StreamOptions opt;
+    opt.chunkSize = 256;
+    opt.paillierBits = 1024;
+    std::string p1Path = makeTempFile(opt.tempDir, "psi-stream-p1-");
+    std::string p2Path = makeTempFile(opt.tempDir, "psi-stream-p2-");
+    if (p1Path.empty() || p2Path.empty()) {
+        std::cout << "Streaming PSI: cannot create temporary files in " << opt.tempDir << std::endl;
+        unlink(p1Path.c_str());
+        return;
+    }
+    uint64_t expected = 0;
+    {
+        std::ofstream p1(p1Path), p2(p2Path);
+        for (size_t i = 0; i < count; ++i) {
+            p1 << "user" << i << "\n";
+            // һص
+            size_t id = i + count / 2;
+            p2 << "user" << id << "," << i % 100 << "\n";
+            if (id < count) {
+                expected += i % 100;
+            }
+        }
+    }
+    for (size_t budget : { (size_t)64 << 20, (size_t)4 << 10 }) {
+        opt.memoryBudget = budget;
+        PSI_Party1Result result;
+        auto start = std::chrono::high_resolution_clock::now();
+        bool ok = runStreamingProcesses(p1Path, p2Path, opt, expected, result);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << count << " x " << count << " records, " << budget / 1024 << " KB budget ("
+            << (result.spilled ? "spilled to disk" : "in memory") << "): " << (ok ? "passed" : "FAILED")
+            << ", intersection " << result.intersectionSize << " (expected " << (count + 1) / 2 << "), "
+            << std::chrono::duration<double>(end - start).count() << " s" << std::endl;
+    }
+    unlink(p1Path.c_str());
+    unlink(p2Path.c_str());
+}
+
+// ļʱPSI_STREAM_NO_MAIN
+#ifndef PSI_STREAM_NO_MAIN
+// ʱвԣΪУ
+//   ./PSI-Stream party1 ids.txt /tmp/psi.sock
+//   ./PSI-Stream party2 data.csv /tmp/psi.sock
+int main(int argc, char** argv) {
+    if (argc == 4) {
+        signal(SIGPIPE, SIG_IGN);
+        PSI_StreamOptions opt;
+        std::string role = argv[1];
+        if (role == "party1") {
+            int fd = listenUnix(argv[3]);
+            PSI_Party1Result result;
+            bool ok = fd >= 0 && psiStreamParty1(fd, argv[2], opt, result);
+            if (fd >= 0) {
+                close(fd);
+            }
+            if (ok) {
+                std::cout << "Intersection size: " << result.intersectionSize << std::endl;
+            }
+            return ok ? 0 : 1;
+        }
+        if (role == "party2") {
+            int fd = connectUnix(argv[3]);
+            uint64_t sum = 0;
+            bool ok = fd >= 0 && psiStreamParty2(fd, argv[2], opt, sum);
+            if (fd >= 0) {
+                close(fd);
+            }
+            if (ok) {
+                std::cout << "Intersection sum: " << sum << std::endl;
+            }
+            return ok ? 0 : 1;
+        }
+        return 1;
+    }
+    testStreamingPSI();
+    return 0;
+}
+#endif
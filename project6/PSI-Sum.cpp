@@ -0,0 +1,416 @@
+// DDH˽нЭ飨IonȣPrivate Intersection-Sum-with-CardinalitySection 3.1
+// ȺSM2ߣH(v)^kдkH(v)33ֽѹʽ䣻ֵPaillier
+// project5SM2㣨ʱӣSM3project1DRBG
+#define SM2_NO_MAIN
+#include "../project5/SM2.cpp"
+#define PAILLIER_NO_MAIN
+#include "Paillier.cpp"
+
+// ѹ㣺02/03yż|| x
+struct CompressedPoint {
+    uint8_t bytes[33];
+
+    bool operator==(const CompressedPoint& other) const {
+        return memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+    }
+};
+
+inline CompressedPoint compressPoint(const AffinePoint& p) {
+    CompressedPoint c;
+    uint64_t y[4];
+    SM2_Fp::toInt(p.y, y);
+    c.bytes[0] = (uint8_t)(2 | (y[0] & 1));
+    SM2_Fp::toBytes(p.x, c.bytes + 1);
+    return c;
+}
+
+// ѹy = sqrt(x^3 + ax + b)ǰ׺ѡżϵĵʱfalse
+inline bool decompressPoint(const CompressedPoint& c, AffinePoint& p) {
+    if ((c.bytes[0] & 0xFE) != 2 || !SM2_Fp::fromBytes(c.bytes + 1, p.x)) {
+        return false;
+    }
+    Fp rhs = SM2_Fp::add(SM2_Fp::mul(SM2_Fp::add(SM2_Fp::sqr(p.x), SM2_Curve::A), p.x), SM2_Curve::B);
+    if (!fpSqrt(rhs, p.y)) {
+        return false;
+    }
+    uint64_t y[4];
+    SM2_Fp::toInt(p.y, y);
+    if ((y[0] & 1) != (uint64_t)(c.bytes[0] & 1)) {
+        p.y = SM2_Fp::neg(p.y);
+    }
+    return true;
+}
+
+// ʶϣߣtry-and-incrementx = SM3("SM2-PSI" || ctr || id)Сpx^3 + ax + bƽʱctr1ԣ
+// ƽΣSM2ߵΪ1õĵ㶼nȺСָǰ׺SM3м״ֻ̬һ
+inline AffinePoint hashToCurve(const uint8_t* id, size_t len) {
+    static const SM3_Prefixed prefix((const unsigned char*)"SM2-PSI", 7);
+    for (uint8_t ctr = 0;; ++ctr) {
+        SM3_Optimized sm3 = prefix.begin();
+        sm3.update(&ctr, 1);
+        sm3.update(id, len);
+        unsigned char digest[32];
+        sm3.final(digest);
+        AffinePoint p;
+        if (!SM2_Fp::fromBytes(digest, p.x)) {
+            continue;
+        }
+        Fp rhs = SM2_Fp::add(SM2_Fp::mul(SM2_Fp::add(SM2_Fp::sqr(p.x), SM2_Curve::A), p.x), SM2_Curve::B);
+        if (fpSqrt(rhs, p.y)) {
+            return p;
+        }
+    }
+}
+
+// ä㼯ϣѰַΪxǰ16ֽڡäĵϾȷֲ
+// ͬĵǰ128λͬĸԼΪ|||ѯ| / 2^128λ1ֿղ
+class BlindedPointSet {
+public:
+    typedef std::array<uint64_t, 2> Key;
+
+    explicit BlindedPointSet(size_t expected = 0) {
+        size_t size = 16;
+        while (size < expected * 2) {
+            size <<= 1;
+        }
+        slots.assign(size, Key{ { 0, 0 } });
+        mask = size - 1;
+    }
+
+    static Key keyOf(const CompressedPoint& p) {
+        Key key;
+        memcpy(key.data(), p.bytes + 1, 16);
+        key[0] |= 1;
+        return key;
+    }
+
+    void insert(const CompressedPoint& p) {
+        insert(keyOf(p));
+    }
+
+    // װʳ1/2ʱ
+    void insert(const Key& key) {
+        if (needsGrowth()) {
+            std::vector<Key> old;
+            old.swap(slots);
+            slots.assign(old.size() * 2, Key{ { 0, 0 } });
+            mask = slots.size() - 1;
+            count = 0;
+            for (const Key& k : old) {
+                if (k[0]) {
+                    place(k);
+                }
+            }
+        }
+        place(key);
+    }
+
+    bool contains(const CompressedPoint& p) const {
+        return contains(keyOf(p));
+    }
+
+    bool contains(const Key& key) const {
+        for (size_t i = key[1] & mask;; i = (i + 1) & mask) {
+            if (slots[i] == key) {
+                return true;
+            }
+            if (slots[i][0] == 0) {
+                return false;
+            }
+        }
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // һβǷñ
+    bool needsGrowth() const {
+        return (count + 1) * 2 > slots.size();
+    }
+
+    size_t memoryBytes() const {
+        return slots.size() * sizeof(Key);
+    }
+
+    // ȡȫͷű
+    std::vector<Key> drain() {
+        std::vector<Key> keys;
+        keys.reserve(count);
+        for (const Key& k : slots) {
+            if (k[0]) {
+                keys.push_back(k);
+            }
+        }
+        slots.assign(16, Key{ { 0, 0 } });
+        slots.shrink_to_fit();
+        mask = 15;
+        count = 0;
+        return keys;
+    }
+
+private:
+    std::vector<Key> slots;
+    size_t mask = 0;
+    size_t count = 0;
+
+    void place(const Key& key) {
+        for (size_t i = key[1] & mask;; i = (i + 1) & mask) {
+            if (slots[i] == key) {
+                return;
+            }
+            if (slots[i][0] == 0) {
+                slots[i] = key;
+                ++count;
+                return;
+            }
+        }
+    }
+};
+
+// DRBG˳
+struct DrbgRandom {
+    typedef uint64_t result_type;
+
+    static constexpr uint64_t min() {
+        return 0;
+    }
+
+    static constexpr uint64_t max() {
+        return ~(uint64_t)0;
+    }
+
+    uint64_t operator()() {
+        uint64_t v;
+        threadCtrDrbg().read((uint8_t*)&v, sizeof(v));
+        return v;
+    }
+};
+
+// д[0, count)ָthreadṣ߳˳ִ
+inline void parallelChunks(size_t count, unsigned threads, const std::function<void(size_t, size_t)>& fn) {
+    const size_t chunk = 256;
+    parallelFor((count + chunk - 1) / chunk, threads, [&](size_t c) {
+        fn(c * chunk, std::min(count, (c + 1) * chunk));
+    });
+}
+
+// kH(id)ѹ
+inline std::vector<CompressedPoint> hashAndBlind(const std::vector<std::string>& ids, const uint64_t k[4],
+    unsigned threads) {
+    std::vector<CompressedPoint> out(ids.size());
+    parallelChunks(ids.size(), threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            out[i] = compressPoint(ladderMult(k, hashToCurve((const uint8_t*)ids[i].data(), ids[i].size())));
+        }
+    });
+    return out;
+}
+
+// Էĵٳkյϵĵʱ׳쳣
+inline std::vector<CompressedPoint> reblind(const std::vector<CompressedPoint>& points, const uint64_t k[4],
+    unsigned threads) {
+    std::vector<CompressedPoint> out(points.size());
+    std::atomic<bool> invalid(false);
+    parallelChunks(points.size(), threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            AffinePoint p;
+            if (!decompressPoint(points[i], p)) {
+                invalid = true;
+                return;
+            }
+            out[i] = compressPoint(ladderMult(k, p));
+        }
+    });
+    if (invalid) {
+        throw std::invalid_argument("received point is not on the curve");
+    }
+    return out;
+}
+
+// ڶϢP1Ԫصk1k2˫äֵңP2Ԫصk2äֵӦֵPaillierģͬһûң
+struct PSI_Round2 {
+    std::vector<CompressedPoint> doubleBlinded;
+    std::vector<CompressedPoint> blinded;
+    std::vector<BigNum> ciphertexts;
+};
+
+// P1бʶϣõС뽻͵
+class PSI_Party1 {
+public:
+    explicit PSI_Party1(std::vector<std::string> ids, unsigned threads = 0) : ids(std::move(ids)), threads(threads) {
+        randomScalar(k1);
+    }
+
+    ~PSI_Party1() {
+        memset(k1, 0, sizeof(k1));
+    }
+
+    // һ֣k1H(v)Һ
+    std::vector<CompressedPoint> round1() const {
+        std::vector<CompressedPoint> msg = hashAndBlind(ids, k1, threads);
+        std::shuffle(msg.begin(), msg.end(), DrbgRandom());
+        return msg;
+    }
+
+    // ֣k1(k2H(w))˫äмڽӦ̬ͬӺ
+    void round3(const PSI_Round2& msg, const PaillierPublicKey& pub) {
+        if (msg.blinded.size() != msg.ciphertexts.size()) {
+            throw std::invalid_argument("round 2 points and ciphertexts differ in length");
+        }
+        BlindedPointSet set(msg.doubleBlinded.size());
+        for (const CompressedPoint& p : msg.doubleBlinded) {
+            set.insert(p);
+        }
+        std::vector<CompressedPoint> theirs = reblind(msg.blinded, k1, threads);
+        std::vector<BigNum> matched;
+        for (size_t i = 0; i < theirs.size(); ++i) {
+            if (set.contains(theirs[i])) {
+                matched.push_back(msg.ciphertexts[i]);
+            }
+        }
+        size = matched.size();
+        sum = pub.rerandomize(pub.sum(matched, threads));
+    }
+
+    size_t intersectionSize() const {
+        return size;
+    }
+
+    const BigNum& intersectionSum() const {
+        return sum;
+    }
+
+private:
+    std::vector<std::string> ids;
+    unsigned threads;
+    uint64_t k1[4];
+    size_t size = 0;
+    BigNum sum;
+};
+
+// P2(ʶ, ֵ)PaillierԿܽ
+class PSI_Party2 {
+public:
+    PSI_Party2(std::vector<std::pair<std::string, uint64_t>> data, size_t paillierBits = 2048, unsigned threads = 0)
+        : data(std::move(data)), threads(threads), key(PaillierKey::generate(paillierBits)) {
+        randomScalar(k2);
+    }
+
+    ~PSI_Party2() {
+        memset(k2, 0, sizeof(k2));
+    }
+
+    const PaillierPublicKey& publicKey() const {
+        return key;
+    }
+
+    // ڶ֣P1ĵk2ңԼԪk2H(w)ܶӦֵͬһû
+    PSI_Round2 round2(const std::vector<CompressedPoint>& round1) const {
+        PSI_Round2 msg;
+        msg.doubleBlinded = reblind(round1, k2, threads);
+        std::shuffle(msg.doubleBlinded.begin(), msg.doubleBlinded.end(), DrbgRandom());
+
+        std::vector<size_t> order(data.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), DrbgRandom());
+        std::vector<std::string> ids(data.size());
+        std::vector<uint64_t> values(data.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            ids[i] = data[order[i]].first;
+            values[i] = data[order[i]].second;
+        }
+        msg.blinded = hashAndBlind(ids, k2, threads);
+        // P2˽Կr^nCRT
+        msg.ciphertexts = key.encryptBatch(values, threads);
+        return msg;
+    }
+
+    uint64_t decryptSum(const BigNum& ciphertext) const {
+        return key.decrypt(ciphertext);
+    }
+
+private:
+    std::vector<std::pair<std::string, uint64_t>> data;
+    unsigned threads;
+    PaillierKey key;
+    uint64_t k2[4];
+};
+
+// ЭԣPython汾ͬݣuser1..3Ϊ60ټѹǷ
+void testPSI() {
+    AffinePoint h = hashToCurve((const uint8_t*)"user1", 5);
+    AffinePoint back;
+    bool pointsOk = isOnCurve(h) && decompressPoint(compressPoint(h), back) && SM2_Fp::equal(back.x, h.x) &&
+        SM2_Fp::equal(back.y, h.y);
+    CompressedPoint bad = compressPoint(h);
+    bad.bytes[0] = 0x04;
+    pointsOk = pointsOk && !decompressPoint(bad, back);
+
+    std::vector<std::string> p1 = { "user1", "user2", "user3", "user4", "user5" };
+    std::vector<std::pair<std::string, uint64_t>> p2 = {
+        { "user1", 10 }, { "user2", 20 }, { "user3", 30 }, { "user6", 40 }, { "user7", 50 }
+    };
+    PSI_Party1 party1(p1);
+    PSI_Party2 party2(p2);
+    PSI_Round2 msg = party2.round2(party1.round1());
+    party1.round3(msg, party2.publicKey());
+    uint64_t sum = party2.decryptSum(party1.intersectionSum());
+    std::cout << "Compressed points and hash-to-curve: " << (pointsOk ? "passed" : "FAILED") << std::endl;
+    std::cout << "Intersection size: " << party1.intersectionSize() << " (expected 3), sum: " << sum
+        << " (expected 60)" << std::endl;
+}
+
+// Эܣ׶μʱÿäݴ˹1000Ԫؼϵʱ
+void psiPerformanceTest(size_t count = 2000, size_t paillierBits = 1024) {
+    std::vector<std::string> p1(count);
+    std::vector<std::pair<std::string, uint64_t>> p2(count);
+    uint64_t expected = 0;
+    for (size_t i = 0; i < count; ++i) {
+        p1[i] = "user" + std::to_string(i);
+        // һص
+        size_t id = i + count / 2;
+        p2[i] = { "user" + std::to_string(id), i % 100 };
+        if (id < count) {
+            expected += i % 100;
+        }
+    }
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    PSI_Party1 party1(p1, threads);
+    PSI_Party2 party2(p2, paillierBits, threads);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<CompressedPoint> r1 = party1.round1();
+    auto t2 = std::chrono::high_resolution_clock::now();
+    PSI_Round2 msg = party2.round2(r1);
+    auto t3 = std::chrono::high_resolution_clock::now();
+    party1.round3(msg, party2.publicKey());
+    auto t4 = std::chrono::high_resolution_clock::now();
+    uint64_t sum = party2.decryptSum(party1.intersectionSum());
+    auto t5 = std::chrono::high_resolution_clock::now();
+
+    auto seconds = [](std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+        return std::chrono::duration<double>(b - a).count();
+    };
+    // һֻäݴ˵õÿЭ鹲4countε
+    double pointRate = count / seconds(t1, t2);
+    std::cout << count << " x " << count << " records, " << threads << " threads, " << paillierBits
+        << "-bit Paillier: key setup " << seconds(t0, t1) << " s, round 1 " << seconds(t1, t2) << " s, round 2 "
+        << seconds(t2, t3) << " s, round 3 " << seconds(t3, t4) << " s, decryption " << seconds(t4, t5) << " s"
+        << std::endl;
+    std::cout << "Intersection " << party1.intersectionSize() << " (expected " << (count + 1) / 2 << "), sum "
+        << sum << (sum == expected ? " (correct)" : " (WRONG)") << "; " << pointRate
+        << " blinded points/s, EC work for 10M x 10M: " << 4e7 / pointRate / 60 << " min" << std::endl;
+}
+
+// ļʱPSI_SUM_NO_MAIN
+#ifndef PSI_SUM_NO_MAIN
+int main() {
+    testPSI();
+    psiPerformanceTest();
+    return 0;
+}
+#endif
@@ -0,0 +1,1000 @@
+// Paillierӷ̬ͬܣg = n + 1Ϊ64λlimbС飬ģȫMontgomery˷Ҫ
+// ȡproject1SM4-CTR_DRBG
+#define SM4_DRBG_NO_MAIN
+#include "../project1/SM4-DRBG.cpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+typedef unsigned __int128 uint128_t;
+typedef std::vector<uint64_t> BigNum;
+
+// ȥλ0 limb
+inline void bnTrim(BigNum& a) {
+    while (a.size() > 1 && a.back() == 0) {
+        a.pop_back();
+    }
+}
+
+inline BigNum bnFromU64(uint64_t v, size_t limbs = 1) {
+    BigNum a(std::max<size_t>(limbs, 1), 0);
+    a[0] = v;
+    return a;
+}
+
+inline size_t bnBits(const BigNum& a) {
+    for (size_t i = a.size(); i-- > 0;) {
+        if (a[i]) {
+            return i * 64 + 64 - __builtin_clzll(a[i]);
+        }
+    }
+    return 0;
+}
+
+inline bool bnBit(const BigNum& a, size_t i) {
+    return i / 64 < a.size() && ((a[i / 64] >> (i % 64)) & 1);
+}
+
+inline bool bnIsZero(const BigNum& a) {
+    for (uint64_t v : a) {
+        if (v) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Ƚϣa < b-1ȷ0a > b1ȿԲͬ
+inline int bnCompare(const BigNum& a, const BigNum& b) {
+    for (size_t i = std::max(a.size(), b.size()); i-- > 0;) {
+        uint64_t x = i < a.size() ? a[i] : 0;
+        uint64_t y = i < b.size() ? b[i] : 0;
+        if (x != y) {
+            return x < y ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// a -= bҪa >= b
+inline void bnSubInPlace(BigNum& a, const BigNum& b) {
+    unsigned char borrow = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        unsigned long long d;
+        borrow = _subborrow_u64(borrow, a[i], i < b.size() ? b[i] : 0, &d);
+        a[i] = d;
+    }
+}
+
+// a += bλĽλ׷Ϊlimb
+inline void bnAddInPlace(BigNum& a, const BigNum& b) {
+    if (a.size() < b.size()) {
+        a.resize(b.size(), 0);
+    }
+    unsigned char carry = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        unsigned long long s;
+        carry = _addcarry_u64(carry, a[i], i < b.size() ? b[i] : 0, &s);
+        a[i] = s;
+    }
+    if (carry) {
+        a.push_back(1);
+    }
+}
+
+inline void bnAddWord(BigNum& a, uint64_t w) {
+    for (size_t i = 0; i < a.size() && w; ++i) {
+        a[i] += w;
+        w = a[i] < w;
+    }
+    if (w) {
+        a.push_back(w);
+    }
+}
+
+inline void bnSubWord(BigNum& a, uint64_t w) {
+    for (size_t i = 0; i < a.size() && w; ++i) {
+        uint64_t old = a[i];
+        a[i] -= w;
+        w = old < w;
+    }
+}
+
+// ˻Ϊ֮
+inline BigNum bnMul(const BigNum& a, const BigNum& b) {
+    BigNum r(a.size() + b.size(), 0);
+    for (size_t i = 0; i < a.size(); ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b.size(); ++j) {
+            uint128_t t = (uint128_t)a[i] * b[j] + r[i + j] + carry;
+            r[i + j] = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+        r[i + b.size()] = carry;
+    }
+    return r;
+}
+
+inline BigNum bnShiftRight(const BigNum& a, size_t bits) {
+    size_t words = bits / 64, shift = bits % 64;
+    BigNum r(a.size() > words ? a.size() - words : 1, 0);
+    for (size_t i = 0; i + words < a.size(); ++i) {
+        r[i] = a[i + words] >> shift;
+        if (shift && i + words + 1 < a.size()) {
+            r[i] |= a[i + words + 1] << (64 - shift);
+        }
+    }
+    return r;
+}
+
+// ֪aܱbʱa / bJebeleanȷlimbb^-1 mod 2^64ȥλ
+inline BigNum bnDivExact(BigNum a, const BigNum& b) {
+    uint64_t inv = 1;
+    for (int i = 0; i < 6; ++i) {
+        inv *= 2 - b[0] * inv;
+    }
+    size_t len = a.size() - b.size() + 1;
+    BigNum q(len, 0);
+    for (size_t i = 0; i < len; ++i) {
+        uint64_t qi = a[i] * inv;
+        q[i] = qi;
+        uint64_t carry = 0;
+        unsigned char borrow = 0;
+        for (size_t j = 0; j < b.size() && i + j < a.size(); ++j) {
+            uint128_t t = (uint128_t)qi * b[j] + carry;
+            carry = (uint64_t)(t >> 64);
+            unsigned long long d;
+            borrow = _subborrow_u64(borrow, a[i + j], (uint64_t)t, &d);
+            a[i + j] = d;
+        }
+        for (size_t j = i + b.size(); j < a.size() && (carry || borrow); ++j) {
+            unsigned long long d;
+            borrow = _subborrow_u64(borrow, a[j], carry, &d);
+            a[j] = d;
+            carry = 0;
+        }
+    }
+    bnTrim(q);
+    return q;
+}
+
+// ֽڴתtoBytes̶lenֽ
+inline BigNum bnFromBytes(const uint8_t* in, size_t len) {
+    BigNum a((len + 7) / 8, 0);
+    for (size_t i = 0; i < len; ++i) {
+        a[(len - 1 - i) / 8] |= (uint64_t)in[i] << (8 * ((len - 1 - i) % 8));
+    }
+    return a;
+}
+
+inline void bnToBytes(const BigNum& a, uint8_t* out, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        size_t bit = 8 * (len - 1 - i);
+        out[i] = bit / 64 < a.size() ? (uint8_t)(a[bit / 64] >> (bit % 64)) : 0;
+    }
+}
+
+// [0, bound)ڵľܾ
+inline BigNum bnRandomBelow(const BigNum& bound) {
+    size_t bits = bnBits(bound);
+    BigNum r((bits + 63) / 64, 0);
+    do {
+        threadCtrDrbg().read((uint8_t*)r.data(), r.size() * 8);
+        if (bits % 64) {
+            r.back() &= ((uint64_t)1 << (bits % 64)) - 1;
+        }
+    } while (bnCompare(r, bound) >= 0);
+    return r;
+}
+
+// ģmMontgomery㣺R = 2^(64L)ԪaR mod mLlimb
+class MontgomeryContext {
+public:
+    static constexpr size_t MAX_LIMBS = 128;
+
+    explicit MontgomeryContext(const BigNum& modulus) : m(modulus) {
+        bnTrim(m);
+        if (!(m[0] & 1) || m.size() > MAX_LIMBS) {
+            throw std::invalid_argument("Montgomery modulus must be odd and at most 8192 bits");
+        }
+        uint64_t inv = 1;
+        for (int i = 0; i < 6; ++i) {
+            inv *= 2 - m[0] * inv;
+        }
+        m0inv = 0 - inv;
+        // R^2 mod m1ʼ128L
+        r2 = bnFromU64(1, m.size());
+        for (size_t i = 0; i < 128 * m.size(); ++i) {
+            uint64_t top = r2.back() >> 63;
+            for (size_t j = r2.size(); j-- > 1;) {
+                r2[j] = (r2[j] << 1) | (r2[j - 1] >> 63);
+            }
+            r2[0] <<= 1;
+            if (top || bnCompare(r2, m) >= 0) {
+                bnSubInPlace(r2, m);
+            }
+        }
+        oneMont = toMont(bnFromU64(1, m.size()));
+    }
+
+    size_t limbs() const {
+        return m.size();
+    }
+
+    const BigNum& modulus() const {
+        return m;
+    }
+
+    const BigNum& one() const {
+        return oneMont;
+    }
+
+    // out = abR^-1 mod mCIOSoutabͬ
+    void mul(const uint64_t* a, const uint64_t* b, uint64_t* out) const {
+        const size_t L = m.size();
+        uint64_t t[MAX_LIMBS + 2] = { 0 };
+        for (size_t i = 0; i < L; ++i) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < L; ++j) {
+                uint128_t s = (uint128_t)a[j] * b[i] + t[j] + carry;
+                t[j] = (uint64_t)s;
+                carry = (uint64_t)(s >> 64);
+            }
+            uint128_t s = (uint128_t)t[L] + carry;
+            t[L] = (uint64_t)s;
+            t[L + 1] = (uint64_t)(s >> 64);
+
+            uint64_t q = t[0] * m0inv;
+            s = (uint128_t)q * m[0] + t[0];
+            carry = (uint64_t)(s >> 64);
+            for (size_t j = 1; j < L; ++j) {
+                s = (uint128_t)q * m[j] + t[j] + carry;
+                t[j - 1] = (uint64_t)s;
+                carry = (uint64_t)(s >> 64);
+            }
+            s = (uint128_t)t[L] + carry;
+            t[L - 1] = (uint64_t)s;
+            t[L] = t[L + 1] + (uint64_t)(s >> 64);
+        }
+        finalSubtract(t, out);
+    }
+
+    BigNum mul(const BigNum& a, const BigNum& b) const {
+        BigNum r(m.size());
+        mul(a.data(), b.data(), r.data());
+        return r;
+    }
+
+    // a < mRСmĳ˻a mod mREDC(a)R^2R^-1
+    BigNum reduce(const BigNum& a) const {
+        const size_t L = m.size();
+        uint64_t t[2 * MAX_LIMBS + 1] = { 0 };
+        std::copy(a.begin(), a.begin() + std::min(a.size(), 2 * L), t);
+        for (size_t i = 0; i < L; ++i) {
+            uint64_t q = t[i] * m0inv;
+            uint64_t carry = 0;
+            for (size_t j = 0; j < L; ++j) {
+                uint128_t s = (uint128_t)q * m[j] + t[i + j] + carry;
+                t[i + j] = (uint64_t)s;
+                carry = (uint64_t)(s >> 64);
+            }
+            for (size_t j = i + L; carry && j <= 2 * L; ++j) {
+                uint128_t s = (uint128_t)t[j] + carry;
+                t[j] = (uint64_t)s;
+                carry = (uint64_t)(s >> 64);
+            }
+        }
+        BigNum r(L);
+        finalSubtract(t + L, r.data());
+        return mul(r, r2);
+    }
+
+    BigNum toMont(const BigNum& a) const {
+        BigNum t(m.size(), 0);
+        std::copy(a.begin(), a.begin() + std::min(a.size(), m.size()), t.begin());
+        return mul(t, r2);
+    }
+
+    BigNum fromMont(const BigNum& a) const {
+        BigNum one = bnFromU64(1, m.size());
+        return mul(a, one);
+    }
+
+    // base^exp mod mͨʽ4λ̶ڣΪ0ĴڲֱӰֵ
+    // ֻڹָn
+    BigNum pow(const BigNum& base, const BigNum& exp) const {
+        return fromMont(powMont(toMont(base), exp));
+    }
+
+    // Montgomeryʽ
+    BigNum powMont(const BigNum& baseMont, const BigNum& exp) const {
+        const size_t L = m.size();
+        std::vector<uint64_t> table(16 * L);
+        std::copy(oneMont.begin(), oneMont.end(), table.begin());
+        std::copy(baseMont.begin(), baseMont.end(), table.begin() + L);
+        for (int i = 2; i < 16; ++i) {
+            mul(&table[(i - 1) * L], baseMont.data(), &table[i * L]);
+        }
+        BigNum r = oneMont;
+        size_t bits = bnBits(exp);
+        for (size_t i = (bits + 3) / 4; i-- > 0;) {
+            for (int s = 0; s < 4; ++s) {
+                mul(r.data(), r.data(), r.data());
+            }
+            unsigned digit = (unsigned)((exp[i * 4 / 64] >> (i * 4 % 64)) & 15);
+            if (digit) {
+                mul(r.data(), &table[digit * L], r.data());
+            }
+        }
+        return r;
+    }
+
+    // ָ˽Կеp-1p-2ȣݣڸֻexplimbÿڶһγ˷
+    // ɨȫȡ˷ôֵַָ
+    BigNum powSecret(const BigNum& base, const BigNum& exp) const {
+        return fromMont(powMontSecret(toMont(base), exp));
+    }
+
+    BigNum powMontSecret(const BigNum& baseMont, const BigNum& exp) const {
+        const size_t L = m.size();
+        std::vector<uint64_t> table(16 * L);
+        std::copy(oneMont.begin(), oneMont.end(), table.begin());
+        std::copy(baseMont.begin(), baseMont.end(), table.begin() + L);
+        for (int i = 2; i < 16; ++i) {
+            mul(&table[(i - 1) * L], baseMont.data(), &table[i * L]);
+        }
+        BigNum r = oneMont;
+        BigNum entry(L);
+        for (size_t i = exp.size() * 16; i-- > 0;) {
+            for (int s = 0; s < 4; ++s) {
+                mul(r.data(), r.data(), r.data());
+            }
+            uint64_t digit = (exp[i / 16] >> (i % 16 * 4)) & 15;
+            for (size_t j = 0; j < L; ++j) {
+                entry[j] = 0;
+            }
+            for (uint64_t k = 0; k < 16; ++k) {
+                uint64_t hit = 0 - (((k ^ digit) - 1) >> 63);
+                for (size_t j = 0; j < L; ++j) {
+                    entry[j] |= table[k * L + j] & hit;
+                }
+            }
+            mul(r.data(), entry.data(), r.data());
+        }
+        std::fill(entry.begin(), entry.end(), 0);
+        std::fill(table.begin(), table.end(), 0);
+        return r;
+    }
+
+    // countСmͨʽֱ֮˵õR^-(count-1)R^count mod mУ
+    // ÿֻһMontgomery˷תMontgomeryʽ
+    BigNum product(const BigNum* values, size_t count) const {
+        const size_t L = m.size();
+        BigNum acc = bnFromU64(1, L);
+        if (count == 0) {
+            return acc;
+        }
+        std::copy(values[0].begin(), values[0].begin() + std::min(values[0].size(), L), acc.begin());
+        BigNum padded(L);
+        for (size_t i = 1; i < count; ++i) {
+            const BigNum& v = values[i];
+            if (v.size() == L) {
+                mul(acc.data(), v.data(), acc.data());
+            } else {
+                std::fill(padded.begin(), padded.end(), 0);
+                std::copy(v.begin(), v.begin() + std::min(v.size(), L), padded.begin());
+                mul(acc.data(), padded.data(), acc.data());
+            }
+        }
+        // R mod mͨʽoneMont
+        return mul(acc, pow(oneMont, bnFromU64(count)));
+    }
+
+private:
+    BigNum m;
+    uint64_t m0inv;
+    BigNum r2;
+    BigNum oneMont;
+
+    // tL + 1limbt < 2mȥm󰴽λѡ
+    void finalSubtract(const uint64_t* t, uint64_t* out) const {
+        const size_t L = m.size();
+        uint64_t d[MAX_LIMBS];
+        unsigned char borrow = 0;
+        for (size_t j = 0; j < L; ++j) {
+            unsigned long long x;
+            borrow = _subborrow_u64(borrow, t[j], m[j], &x);
+            d[j] = x;
+        }
+        unsigned long long top;
+        borrow = _subborrow_u64(borrow, t[L], 0, &top);
+        uint64_t keep = 0 - (uint64_t)borrow;
+        for (size_t j = 0; j < L; ++j) {
+            out[j] = (t[j] & keep) | (d[j] & ~keep);
+        }
+    }
+};
+
+// Сɸ2ǰɸ
+inline const std::vector<uint32_t>& smallPrimes() {
+    static const std::vector<uint32_t> primes = [] {
+        std::vector<uint32_t> p;
+        std::vector<bool> composite(20000, false);
+        for (uint32_t i = 3; i < composite.size(); i += 2) {
+            if (!composite[i]) {
+                p.push_back(i);
+                for (uint32_t j = i * i; j < composite.size(); j += 2 * i) {
+                    composite[j] = true;
+                }
+            }
+        }
+        return p;
+    }();
+    return primes;
+}
+
+inline uint32_t bnModSmall(const BigNum& a, uint32_t d) {
+    uint64_t r = 0;
+    for (size_t i = a.size(); i-- > 0;) {
+        r = (uint64_t)((((uint128_t)r << 64) | a[i]) % d);
+    }
+    return (uint32_t)r;
+}
+
+// Miller-Rabinrounds
+inline bool isProbablePrime(const BigNum& n, int rounds) {
+    MontgomeryContext ctx(n);
+    BigNum nm1 = n;
+    bnSubWord(nm1, 1);
+    size_t s = 0;
+    while (!bnBit(nm1, s)) {
+        ++s;
+    }
+    BigNum d = bnShiftRight(nm1, s);
+    BigNum minusOne = ctx.toMont(nm1);
+    BigNum bound = nm1;
+    bnSubWord(bound, 2);
+    for (int r = 0; r < rounds; ++r) {
+        BigNum a = bnRandomBelow(bound);
+        bnAddWord(a, 2);
+        BigNum x = ctx.powMontSecret(ctx.toMont(a), d);
+        if (x == ctx.one() || x == minusOne) {
+            continue;
+        }
+        bool composite = true;
+        for (size_t i = 1; i < s && composite; ++i) {
+            ctx.mul(x.data(), x.data(), x.data());
+            composite = x != minusOne;
+        }
+        if (composite) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// bitsλλΪ1֮ǡΪ2bitsλ
+// 2СɸѡʣµMiller-Rabin
+inline BigNum generatePrime(size_t bits) {
+    const std::vector<uint32_t>& primes = smallPrimes();
+    for (;;) {
+        BigNum p((bits + 63) / 64, 0);
+        threadCtrDrbg().read((uint8_t*)p.data(), p.size() * 8);
+        if (bits % 64) {
+            p.back() &= ((uint64_t)1 << (bits % 64)) - 1;
+        }
+        for (size_t bit : { bits - 1, bits - 2 }) {
+            p[bit / 64] |= (uint64_t)1 << (bit % 64);
+        }
+        p[0] |= 1;
+        std::vector<uint32_t> residues(primes.size());
+        for (size_t i = 0; i < primes.size(); ++i) {
+            residues[i] = bnModSmall(p, primes[i]);
+        }
+        for (uint64_t delta = 0; delta < 1 << 20; delta += 2) {
+            bool divisible = false;
+            for (size_t i = 0; i < primes.size() && !divisible; ++i) {
+                divisible = (residues[i] + delta) % primes[i] == 0;
+            }
+            if (divisible) {
+                continue;
+            }
+            BigNum candidate = p;
+            bnAddWord(candidate, delta);
+            if (bnBits(candidate) == bits && isProbablePrime(candidate, 40)) {
+                return candidate;
+            }
+        }
+    }
+}
+
+// Կnģn^2MontgomeryġΪn^22LlimbLΪnlimb
+class PaillierPublicKey {
+public:
+    explicit PaillierPublicKey(const BigNum& modulus) : n(modulus), nSquared(bnMul(modulus, modulus)) {
+        bnTrim(n);
+        bnTrim(nSquared);
+        ctx.reset(new MontgomeryContext(nSquared));
+    }
+
+    virtual ~PaillierPublicKey() = default;
+
+    const BigNum& modulus() const {
+        return n;
+    }
+
+    const MontgomeryContext& context() const {
+        return *ctx;
+    }
+
+    // ĵĶֽ
+    size_t ciphertextBytes() const {
+        return nSquared.size() * 8;
+    }
+
+    // r^n mod n^2Montgomeryʽr[0, n)о
+    virtual BigNum randomFactor() const {
+        return ctx->powMont(ctx->toMont(bnRandomBelow(n)), n);
+    }
+
+    // Enc(m) = g^mr^n mod n^2g = n + 1ʱg^m = 1 + mn mod n^2ֻʣr^nһ
+    BigNum encrypt(uint64_t m) const {
+        return encryptWith(m, randomFactor());
+    }
+
+    // ør^nMontgomeryʽrandomFactor()ԤأܣͨʽMontgomeryʽõͨʽ
+    BigNum encryptWith(uint64_t m, const BigNum& factor) const {
+        return ctx->mul(plainTerm(m), factor);
+    }
+
+    // ܣָthreadṣ߳0ʾȫģ
+    std::vector<BigNum> encryptBatch(const std::vector<uint64_t>& values, unsigned threads = 0) const {
+        const size_t chunk = 16;
+        std::vector<BigNum> out(values.size());
+        parallelFor((values.size() + chunk - 1) / chunk, threads, [&](size_t c) {
+            for (size_t i = c * chunk; i < std::min(values.size(), (c + 1) * chunk); ++i) {
+                out[i] = encrypt(values[i]);
+            }
+        });
+        return out;
+    }
+
+    // ̬ͬӷEnc(a)Enc(b) = Enc(a + b)
+    BigNum add(const BigNum& a, const BigNum& b) const {
+        return ctx->reduce(bnMul(a, b));
+    }
+
+    // ̬ͬͣÿ64Ϊһ飨ÿһģˣĻˣڲ
+    BigNum sum(const std::vector<BigNum>& ciphertexts, unsigned threads = 1) const {
+        const size_t chunk = 64;
+        if (ciphertexts.empty()) {
+            return bnFromU64(1, nSquared.size());
+        }
+        std::vector<BigNum> partial((ciphertexts.size() + chunk - 1) / chunk);
+        parallelFor(partial.size(), threads, [&](size_t i) {
+            partial[i] = ctx->product(&ciphertexts[i * chunk], std::min(chunk, ciphertexts.size() - i * chunk));
+        });
+        while (partial.size() > 1) {
+            std::vector<BigNum> next((partial.size() + 1) / 2);
+            parallelFor(next.size(), threads, [&](size_t i) {
+                next[i] = 2 * i + 1 < partial.size() ? ctx->product(&partial[2 * i], 2) : partial[2 * i];
+            });
+            partial.swap(next);
+        }
+        return partial[0];
+    }
+
+    // Enc(0)벻ɹ
+    BigNum rerandomize(const BigNum& c) const {
+        return add(c, encrypt(0));
+    }
+
+protected:
+    BigNum n;
+    BigNum nSquared;
+    std::shared_ptr<const MontgomeryContext> ctx;
+
+    // 1 + mn
+    BigNum plainTerm(uint64_t m) const {
+        BigNum t = bnMul(n, bnFromU64(m));
+        t.resize(nSquared.size(), 0);
+        bnAddWord(t, 1);
+        return t;
+    }
+};
+
+// ˽ԿpqΪλͬĲͬܰйʣඨģp^2ģq^2·ֱ
+// m_p = L_p(c^(p-1) mod p^2)h_p mod pL_p(x) = (x - 1) / ph_p = L_p(g^(p-1) mod p^2)^-1 mod p
+// ģָ룬ԼΪֱӼc^ mod n^21/4˽Կһʱr^nҲģp^2ģq^2
+class PaillierKey : public PaillierPublicKey {
+public:
+    static PaillierKey generate(size_t bits = 2048) {
+        for (;;) {
+            BigNum p = generatePrime(bits / 2);
+            BigNum q = generatePrime(bits / 2);
+            if (bnCompare(p, q) != 0) {
+                return PaillierKey(p, q);
+            }
+        }
+    }
+
+    PaillierKey(const BigNum& p, const BigNum& q)
+        : PaillierPublicKey(bnMul(p, q)), p(p), q(q), pCtx(new MontgomeryContext(p)),
+          qCtx(new MontgomeryContext(q)), pSqCtx(new MontgomeryContext(bnMul(p, p))),
+          qSqCtx(new MontgomeryContext(bnMul(q, q))) {
+        if (bnBits(p) != bnBits(q) || bnCompare(p, q) == 0) {
+            throw std::invalid_argument("Paillier primes must be distinct and of equal bit length");
+        }
+        qInvP = invertPrime(*pCtx, q);
+        hp = decryptFactor(p, *pCtx, *pSqCtx);
+        hq = decryptFactor(q, *qCtx, *qSqCtx);
+        // r^n mod p^2ָ(p^2) = p(p-1)Լn mod p(p-1) = p(q mod (p-1))λͬʱq < 2(p-1)
+        expP = bnMul(p, reduceOnce(q, p));
+        expQ = bnMul(q, reduceOnce(p, q));
+        // q^2ģp^2棺a^((p^2) - 1)
+        BigNum phi = p;
+        bnSubWord(phi, 1);
+        phi = bnMul(phi, p);
+        bnSubWord(phi, 1);
+        qSqInvPSq = pSqCtx->powSecret(pSqCtx->reduce(qSqCtx->modulus()), phi);
+    }
+
+    // r^n mod n^2Montgomeryʽֱģp^2ģq^2ٺϲԼΪԿܵһ
+    BigNum randomFactor() const override {
+        BigNum r = bnRandomBelow(n);
+        BigNum a = pSqCtx->powSecret(pSqCtx->reduce(r), expP);
+        BigNum b = qSqCtx->powSecret(qSqCtx->reduce(r), expQ);
+        return ctx->toMont(crt(a, b, *pSqCtx, qSqCtx->modulus(), qSqInvPSq));
+    }
+
+    // ĵĵ64λԶСn
+    uint64_t decrypt(const BigNum& c) const {
+        return decryptFull(c)[0];
+    }
+
+    BigNum decryptFull(const BigNum& c) const {
+        if (bnCompare(c, nSquared) >= 0) {
+            throw std::invalid_argument("Paillier ciphertext out of range");
+        }
+        BigNum mp = decryptModPrime(c, p, *pCtx, *pSqCtx, hp);
+        BigNum mq = decryptModPrime(c, q, *qCtx, *qSqCtx, hq);
+        BigNum m = crt(mp, mq, *pCtx, q, qInvP);
+        m.resize(n.size(), 0);
+        return m;
+    }
+
+    PaillierPublicKey publicKey() const {
+        return PaillierPublicKey(*this);
+    }
+
+private:
+    BigNum p, q;
+    std::shared_ptr<const MontgomeryContext> pCtx, qCtx, pSqCtx, qSqCtx;
+    BigNum hp, hq;
+    BigNum qInvP;
+    BigNum expP, expQ;
+    BigNum qSqInvPSq;
+
+    // ģa^-1 = a^(m-2)
+    static BigNum invertPrime(const MontgomeryContext& c, const BigNum& a) {
+        BigNum e = c.modulus();
+        bnSubWord(e, 2);
+        return c.powSecret(c.reduce(a), e);
+    }
+
+    // a mod (p - 1)Ҫa < 2(p - 1)
+    static BigNum reduceOnce(const BigNum& a, const BigNum& p) {
+        BigNum pm1 = p, r = a;
+        bnSubWord(pm1, 1);
+        if (bnCompare(r, pm1) >= 0) {
+            bnSubInPlace(r, pm1);
+        }
+        return r;
+    }
+
+    // L_p(x) = (x - 1) / pΪplimb
+    static BigNum lFunction(BigNum x, const BigNum& p) {
+        bnSubWord(x, 1);
+        bnTrim(x);
+        BigNum l = x.size() >= p.size() ? bnDivExact(x, p) : bnFromU64(0);
+        l.resize(p.size(), 0);
+        return l;
+    }
+
+    // h_p = L_p(g^(p-1) mod p^2)^-1 mod p
+    BigNum decryptFactor(const BigNum& prime, const MontgomeryContext& primeCtx,
+        const MontgomeryContext& squareCtx) const {
+        BigNum g = n, pm1 = prime;
+        bnAddWord(g, 1);
+        bnSubWord(pm1, 1);
+        return invertPrime(primeCtx, lFunction(squareCtx.powSecret(squareCtx.reduce(g), pm1), prime));
+    }
+
+    // m mod p = L_p(c^(p-1) mod p^2)h_p mod p
+    static BigNum decryptModPrime(const BigNum& c, const BigNum& prime, const MontgomeryContext& primeCtx,
+        const MontgomeryContext& squareCtx, const BigNum& h) {
+        BigNum pm1 = prime;
+        bnSubWord(pm1, 1);
+        BigNum u = squareCtx.powSecret(squareCtx.reduce(c), pm1);
+        return primeCtx.reduce(bnMul(lFunction(u, prime), h));
+    }
+
+    // x  a (mod m1)x  b (mod m2)m2Inv = m2^-1 mod m1x = b + m2((a - b)m2Inv mod m1) < m1m2
+    static BigNum crt(const BigNum& a, const BigNum& b, const MontgomeryContext& m1Ctx, const BigNum& m2,
+        const BigNum& m2Inv) {
+        const BigNum& m1 = m1Ctx.modulus();
+        BigNum diff = a;
+        diff.resize(m1.size() + 1, 0);
+        BigNum bMod = m1Ctx.reduce(b);
+        if (bnCompare(diff, bMod) < 0) {
+            bnAddInPlace(diff, m1);
+        }
+        bnSubInPlace(diff, bMod);
+        diff.resize(m1.size());
+        BigNum x = bnMul(m2, m1Ctx.reduce(bnMul(diff, m2Inv)));
+        bnAddInPlace(x, b);
+        return x;
+    }
+};
+
+// r^nԤأ̨߳r^n mod n^2Уʱֻʣһģˡÿr^nֻһΣ
+// ȡ󼴴ӶƳʱʣģforkӽ̲ٴӳȡ̿ͬһr^n
+// r^nҪ뼶ûɡkeyȳشڵþã˽ԿʱCRT
+class PaillierRandomPool {
+public:
+    struct Stats {
+        size_t depth;       // ǰõr^n
+        size_t capacity;
+        uint64_t produced;
+        uint64_t consumed;
+        uint64_t misses;    // ȡʱΪյĴ
+        double refillRate;  // ÿ벹ĸ̵߳æµʱƣ
+    };
+
+    explicit PaillierRandomPool(const PaillierPublicKey& key, size_t capacity = 256, unsigned threads = 1)
+        : key(key), capacity(std::max<size_t>(capacity, 1)), owner(getpid()) {
+        for (unsigned t = 0; t < std::max(1u, threads); ++t) {
+            producers.emplace_back([this] { produce(); });
+        }
+    }
+
+    ~PaillierRandomPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& th : producers) {
+            th.join();
+        }
+        for (BigNum& factor : ready) {
+            std::fill(factor.begin(), factor.end(), 0);
+        }
+    }
+
+    PaillierRandomPool(const PaillierRandomPool&) = delete;
+    PaillierRandomPool& operator=(const PaillierRandomPool&) = delete;
+
+    // ȡһԤr^nΪʱfalse
+    bool take(BigNum& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (getpid() != owner || ready.empty()) {
+            ++misses;
+            return false;
+        }
+        out = std::move(ready.front());
+        ready.pop_front();
+        ++consumed;
+        wake.notify_one();
+        return true;
+    }
+
+    // ȡһr^nΪʱ
+    BigNum next() {
+        BigNum factor;
+        if (!take(factor)) {
+            factor = key.randomFactor();
+        }
+        return factor;
+    }
+
+    BigNum encrypt(uint64_t m) {
+        return key.encryptWith(m, next());
+    }
+
+    size_t depth() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return ready.size();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats st;
+        st.depth = ready.size();
+        st.capacity = capacity;
+        st.produced = produced;
+        st.consumed = consumed;
+        st.misses = misses;
+        st.refillRate = busyNanos ? produced * 1e9 / busyNanos : 0.0;
+        return st;
+    }
+
+private:
+    // ̣߳Уڼģδͼ㣬˵take()
+    void produce() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return stopping || ready.size() + computing < capacity; });
+            if (stopping) {
+                break;
+            }
+            ++computing;
+            lock.unlock();
+            auto start = std::chrono::steady_clock::now();
+            BigNum factor = key.randomFactor();
+            uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            lock.lock();
+            --computing;
+            ready.push_back(std::move(factor));
+            ++produced;
+            busyNanos += ns;
+        }
+    }
+
+    const PaillierPublicKey& key;
+    const size_t capacity;
+    const pid_t owner;
+    std::deque<BigNum> ready;
+    size_t computing = 0;
+    uint64_t produced = 0;
+    uint64_t consumed = 0;
+    uint64_t misses = 0;
+    uint64_t busyNanos = 0;
+    bool stopping = false;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::thread> producers;
+};
+
+// PaillierԣӽԿ˽ԿCRTܣ̬ͬӷ͡Ԥ
+void testPaillier() {
+    auto start = std::chrono::high_resolution_clock::now();
+    PaillierKey key = PaillierKey::generate(1024);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "1024-bit Paillier key generated in "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+    PaillierPublicKey pub = key.publicKey();
+
+    bool ok = true;
+    std::vector<BigNum> ciphertexts;
+    uint64_t expected = 0;
+    for (uint64_t m : { 0ull, 1ull, 42ull, 123456789ull, 0xFFFFFFFFull }) {
+        BigNum c = pub.encrypt(m);
+        ok = ok && key.decrypt(c) == m && key.decrypt(key.encrypt(m)) == m;
+        ciphertexts.push_back(c);
+        expected += m;
+    }
+    ok = ok && bnIsZero(key.decryptFull(pub.add(pub.encrypt(0), key.encrypt(0))));
+    bool homomorphic = key.decrypt(pub.add(ciphertexts[2], ciphertexts[3])) == 42 + 123456789 &&
+        key.decrypt(pub.sum(ciphertexts)) == expected;
+
+    // Ĳһ
+    std::vector<uint64_t> values(300);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = i * i;
+    }
+    std::vector<BigNum> batch = key.encryptBatch(values, 4);
+    BigNum sequential = batch[0];
+    for (size_t i = 1; i < batch.size(); ++i) {
+        sequential = pub.add(sequential, batch[i]);
+    }
+    BigNum parallel = pub.sum(batch, 4);
+    homomorphic = homomorphic && parallel == sequential && key.decrypt(parallel) == 299 * 300 * 599 / 6;
+
+    bool pooled = true;
+    {
+        PaillierRandomPool pool(pub, 8);
+        for (uint64_t m = 0; m < 20; ++m) {
+            pooled = pooled && key.decrypt(pool.encrypt(m)) == m;
+        }
+        PaillierRandomPool::Stats st = pool.stats();
+        pooled = pooled && st.consumed + st.misses == 20;
+    }
+    // ָɱʱݽͬλlimbΪ0ָ
+    {
+        MontgomeryContext c(pub.modulus());
+        for (int i = 0; i < 8; ++i) {
+            BigNum base = bnRandomBelow(pub.modulus());
+            BigNum exp = bnRandomBelow(pub.modulus());
+            if (i % 2) {
+                exp.back() = 0;
+            }
+            ok = ok && c.powSecret(base, exp) == c.pow(base, exp);
+        }
+    }
+    BigNum fresh = pub.rerandomize(ciphertexts[2]);
+    bool rerandomized = fresh != ciphertexts[2] && key.decrypt(fresh) == 42;
+    std::cout << "Paillier round trip: " << (ok ? "passed" : "FAILED") << ", homomorphic sum: "
+        << (homomorphic ? "passed" : "FAILED") << ", r^n pool: " << (pooled ? "passed" : "FAILED")
+        << ", re-randomization: " << (rerandomized ? "passed" : "FAILED") << std::endl;
+}
+
+// Paillierܣ2048λnļܣԿ˽ԿCRTԤأ̬ͬCRT
+void paillierPerformanceTest() {
+    auto seconds = [](std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+        return std::chrono::duration<double>(b - a).count();
+    };
+    auto start = std::chrono::high_resolution_clock::now();
+    PaillierKey key = PaillierKey::generate(2048);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "2048-bit key generation: " << seconds(start, end) << " s" << std::endl;
+    PaillierPublicKey pub = key.publicKey();
+
+    const int count = 20;
+    std::vector<BigNum> ciphertexts(count);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < count; ++i) {
+        ciphertexts[i] = pub.encrypt((uint64_t)i);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double publicRate = count / seconds(start, end);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < count; ++i) {
+        ciphertexts[i] = key.encrypt((uint64_t)i);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double crtRate = count / seconds(start, end);
+
+    // ֻʣһģ
+    double pooledRate, refillRate;
+    {
+        const size_t poolSize = 32;
+        PaillierRandomPool pool(key, poolSize);
+        while (pool.depth() < poolSize) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < poolSize; ++i) {
+            pool.encrypt(i);
+        }
+        end = std::chrono::high_resolution_clock::now();
+        pooledRate = poolSize / seconds(start, end);
+        refillRate = pool.stats().refillRate;
+    }
+    std::cout << "Encryption: public key " << publicRate << " /s, private key (CRT) " << crtRate
+        << " /s, from r^n pool " << pooledRate << " /s (pool refill " << refillRate << " /s per thread)" << std::endl;
+
+    // ͣͬһr^nģֻ̬ͬӷ
+    const size_t sumCount = 4096;
+    BigNum factor = key.randomFactor();
+    std::vector<BigNum> many(sumCount);
+    for (size_t i = 0; i < sumCount; ++i) {
+        many[i] = pub.encryptWith(i, factor);
+    }
+    start = std::chrono::high_resolution_clock::now();
+    BigNum total = pub.sum(many, 0);
+    end = std::chrono::high_resolution_clock::now();
+    double sumRate = sumCount / seconds(start, end);
+
+    const int decrypts = 20;
+    uint64_t check = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < decrypts; ++i) {
+        check += key.decrypt(ciphertexts[i]);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double decryptRate = decrypts / seconds(start, end);
+    std::cout << "Homomorphic sum: " << sumRate << " ciphertexts/s, CRT decryption: " << decryptRate << " /s (sum "
+        << (key.decrypt(total) == (uint64_t)sumCount * (sumCount - 1) / 2 && check == 190 ? "correct" : "WRONG")
+        << ")" << std::endl;
+}
+
+// ļʱPAILLIER_NO_MAIN
+#ifndef PAILLIER_NO_MAIN
+int main() {
+    testPaillier();
+    paillierPerformanceTest();
+    return 0;
+}
+#endif